@@ -1,175 +1,502 @@
-/**
- *@file wordpress.cpp
- *@brief wordpress算法的口令产生过程
- *@version 0.1
- */
-#include "../include/extra_info.h"
-#include "../include/bytevector.h"
-#include "../include/wordpress.h"
-#include <time.h>    //time(NULL)
-#include <stdio.h>
-#include <stdlib.h>    //atoi();
-#include <string.h>    //memset();
-
-#define _WORDPRESS_DEBUG
-
-//! wordpress算法的盐字符集
-static char wordpress_charset[256];
-
-/**
- *@brief wordpress算法的初始化
- *@param extra 算法的附加信息 
- */
-int wordpress_init_alg_desp(struct extra_info *extra)
-{
-	//! 1.清除所有extra信息
-	clear_extra_valid(extra);
-	//! 2.盐长度salt_len为64位或者32位，缺省为64为
-    set_extra_intarray(extra, SALT_LEN_INDEX, "salt_len", std::vector<int>{64, 32}); 
-	//! 3.迭代次数标识iter_pos，缺省为"B"
-	set_extra_chararray(extra, ITER_POS_INDEX, "iter_pos", std::string("B"));
-	//! 4.盐的字符集合为[a-z][0-9][A-Z][.-.][/-/]
-	set_extra_chararray(extra, SALT_CHARSET_INDEX, "salt_charset", std::string("09azAZ./"));
-	//! 5.扩展盐字符集合到wordpress_charset数组
-	expand_charset(wordpress_charset, extra, 5);    //09 az AZ . /共5个子字符集
-	
-	return 0;
-}
-/**
- *@brief 根据输入修改wordpress算法的配置
- *@param extra wordpress算法的附加信息
- *@param extra_name_value 输入配置的名称和数值对
- */
-int wordpress_check_cmdline(struct extra_info *extra, std::map<std::string, std::string> &extra_name_value)
-{
-	std::map<std::string, std::string>::iterator it;
-	//! 1. 遍历输入配置的名称和数值对
-	for (it = extra_name_value.begin(); it != extra_name_value.end(); ++it)
-	{
-		//! 1.1 设置盐长度salt_len
-		if (it->first == std::string("salt_len"))
-			extra[SALT_LEN_INDEX].cur_value.dint = atoi(it->second.c_str());
-		//! 1.2	设置迭代次数标识iter_pos
-		else if (it->first == std::string("iter_pos"))
-			strcpy(extra[ITER_POS_INDEX].cur_value.dchar, it->second.c_str());
-		//! 1.3	设置盐字符集salt_set
-		else if (it->first == std::string("salt_charset"))
-		{
-			memset(extra[SALT_CHARSET_INDEX].values[0].dchar, '\0', 32);
-			
-			//! 1.3.1 设置子字符集个数
-			extra[SALT_CHARSET_INDEX].optionvalue = it->second.size() / 2;
-			
-			//! 1.3.2 在extra_info.values[0].dchar[32]中设置每个子集，dchar[2n]代表下界，dchar[2n+1]代表上界
-			strcpy (extra[SALT_CHARSET_INDEX].values[0].dchar, it->second.c_str()); 
-			
-			//! 1.3.3 根据用户输入的字符集，更新wordpress字符集数组wordpress_charset
-			if (expand_charset(wordpress_charset, extra, extra[SALT_CHARSET_INDEX].optionvalue) != 0)
-			{
-				std::cout << "error: wordpress_check_cmdline().set_extra_charset() is wrong!" << std::endl;
-				return -1;
-			}
-		}
-		else
-		{
-			std::cout << "wordpress_check_cmdline(): " << it->first << " is not valid" << std::endl;
-			return -1;
-		}
-	}
-	
-	return 0;
-}
-/**
- *@brief 产生指定长度的随机盐
- *@param extra wordpress的附加信息，盐的位数由extra[SALT_LEN_INDEX].cur_value.dint决定
- *@return 二进制盐值，存储于Bytevector对象中
- */
-ByteVector wordpress_get_random_salt(struct extra_info *extra)
-{
-	ByteVector bv_salt;
-	//! 1. 根据字符集合产生盐
-	bv_salt = set_random_charset(extra[SALT_LEN_INDEX].cur_value.dint, wordpress_charset, strlen(wordpress_charset));
-	#ifdef _WORDPRESS_DEBUG
-		std::cout<<"salt_len_in_bit="<<extra[SALT_LEN_INDEX].cur_value.dint<<std::endl;
-		std::cout<<"bv_salt="<<bv_salt<<std::endl;
-	#endif
-	//! 2. 返回得到的盐
-	return bv_salt;
-	
-}
-/**
- *@brief 对口令进行预处理
- *@param pwd 输入的口令字符串
- *@return 二进制口令值，存储于自定义Bytevector对象中
- */
-ByteVector wordpress_prepare_pwd(std::string &pwd)
-{
-	ByteVector bv_pwd_raw;
-	//! 1. 将string类型的口令转为二进制值，wordpress口令二进制值为口令ASCII码
-	bv_pwd_raw = string2BV_raw(pwd);
-	
-	return bv_pwd_raw;
-}
-
-/**
- *@brief 根据pwd,salt(以字节为单位)，附加信息产生wordpress算法二进制hash值
- *@param pwd 二进制口令值
- *@param salt8 8个字节的二进制颜值
- *@param extra wordpress算法的附加信息
- *@return 16字节的二进制hash值，存储于ByteVector对象中
- */
-ByteVector wordpress_hash_pwd(ByteVector &pwd, ByteVector &salt8, struct extra_info *extra)
-{
-	ByteVector result16;
-	
-	//! 1. 根据extra[ITER_POS_INDEX].cur_value.dchar[0]获取迭代次数iter_count
-	uint32_t iter_count = 1u << tbl[extra[ITER_POS_INDEX].cur_value.dchar[0]];
-	if (iter_count > 0x80000000)
-	{
-		std::cout<<"error:iter_count is wrong in wordpress"<<std::endl;
-		return result16;
-	}
-	//! 2. result16=MD5(salt8+pwd);
-	result16 = MD5(salt8 + pwd);
-	//! 3. 循环iter_count次
-	while (iter_count--)
-		//! 3.1 result16 = MD5(result16 + pwd);
-		result16 = MD5(result16 + pwd);	
-    //! 4. 返回16字节的二进制hash值
-    return result16;		
-}
-/**
- *@brief 根据hash,salt,附加信息产生符合hashcat规范的密文字符串
- *@param hash16 16字节hash值
- *@param salt8 8字节salt值
- *@param extra wordpress算法的附加信息
- *@return wordpress的密文字符串
- */
-std::string wordpress_get_cipher(ByteVector &hash, ByteVector &salt, struct extra_info *extra)
-{
-	//$P$984478476IagS59wHZvyQMArzfx58u.
-	//$P$ iter_pos 8个任意字符的盐  22个base64编码字符
-	std::string cipher;
-	
-	std::string salt8(1, extra[ITER_POS_INDEX].cur_value.dchar[0]);    //string(size_t n, char c);
-	
-	//! 密文格式：$P$ 迭代次数标识 salt hash(base64编码)
-	cipher = "$P$" + salt8 + BV2string_raw(salt) + BV2string_base64(hash);
-	
-	#ifdef _WORDPRESS_DEBUG
-		std::cout<<"cipher="<<cipher<<std::endl;
-	#endif
-	
-	return cipher;
-}
-	
-//! wordpress算法的算法描述结构体定义
-struct alg_desp wordpress_alg_desp = {
-	wordpress_init_alg_desp,
-	wordpress_check_cmdline,
-	wordpress_get_random_salt,
-	wordpress_prepare_pwd,
-	wordpress_hash_pwd,
-	wordpress_get_cipher,
-	"wordpress"
-};
+/**
+ *@file wordpress.cpp
+ *@brief wordpress算法的口令产生过程
+ *@version 0.1
+ */
+#include "../include/extra_info.h"
+#include "../include/bytevector.h"
+#include "../include/wordpress.h"
+#include "../include/common.h"
+#include "../include/md5_mb.h"
+#include "../include/rng.h"
+#include <time.h>    //time(NULL)
+#include <stdio.h>
+#include <stdlib.h>    //atoi();
+#include <string.h>    //memset();
+
+#define WORDPRESS_CIPHER_FIXED 26    //密文中除盐之外的字节数："$P$" + 迭代次数标识 + 22个base64字符
+#define WORDPRESS_SALT_BYTES 8       //phpass的标准盐长度，编译期特化的实现只用于这一长度
+
+/**
+ *@brief 按附加信息salt_charset展开盐字符集，不保存在全局数组中，多个线程可以同时使用不同配置的算法描述
+ *@param extra wordpress的附加信息
+ *@param charset 输出展开后的字符集，至少256字节
+ *@return 字符集的字符个数
+ */
+static int wordpress_salt_charset(struct extra_info *extra, char *charset)
+{
+	expand_charset(charset, extra, strlen(extra[SALT_CHARSET_INDEX].values[0].dchar) / 2);    //每个子字符集由下界、上界2个字符表示
+	return strlen(charset);
+}
+
+/**
+ *@brief wordpress算法的初始化
+ *@param extra 算法的附加信息 
+ */
+int wordpress_init_alg_desp(struct extra_info *extra)
+{
+	//! 1.清除所有extra信息
+	clear_extra_valid(extra);
+	//! 2.盐长度salt_len为64位或者32位，缺省为64为
+    set_extra_intarray(extra, SALT_LEN_INDEX, "salt_len", std::vector<int>{64, 32}); 
+	//! 3.迭代次数标识iter_pos，缺省为"B"
+	set_extra_chararray(extra, ITER_POS_INDEX, "iter_pos", std::string("B"));
+	//! 4.盐的字符集合为[a-z][0-9][A-Z][.-.][/-/]
+	set_extra_chararray(extra, SALT_CHARSET_INDEX, "salt_charset", std::string("09azAZ./"));
+	//! 5.随机盐种子seed和产生方式salt_mode
+	set_extra_random(extra);
+	
+	return 0;
+}
+/**
+ *@brief 根据输入修改wordpress算法的配置
+ *@param extra wordpress算法的附加信息
+ *@param extra_name_value 输入配置的名称和数值对
+ */
+int wordpress_check_cmdline(struct extra_info *extra, std::map<std::string, std::string> &extra_name_value)
+{
+	std::map<std::string, std::string>::iterator it;
+	//! 1. 遍历输入配置的名称和数值对
+	for (it = extra_name_value.begin(); it != extra_name_value.end(); ++it)
+	{
+		//! 1.1 设置盐长度salt_len
+		if (it->first == std::string("salt_len"))
+			extra[SALT_LEN_INDEX].cur_value.dint = atoi(it->second.c_str());
+		//! 1.2	设置迭代次数标识iter_pos
+		else if (it->first == std::string("iter_pos"))
+			strcpy(extra[ITER_POS_INDEX].cur_value.dchar, it->second.c_str());
+		//! 1.3	设置盐字符集salt_set
+		else if (it->first == std::string("salt_charset"))
+		{
+			memset(extra[SALT_CHARSET_INDEX].values[0].dchar, '\0', 32);
+			
+			//! 1.3.1 设置子字符集个数
+			extra[SALT_CHARSET_INDEX].optionvalue = it->second.size() / 2;
+			
+			//! 1.3.2 在extra_info.values[0].dchar[32]中设置每个子集，dchar[2n]代表下界，dchar[2n+1]代表上界
+			strcpy (extra[SALT_CHARSET_INDEX].values[0].dchar, it->second.c_str()); 
+			
+			//! 1.3.3 检查展开后的字符集，产生盐时再按extra展开
+			char charset[256];
+			if (wordpress_salt_charset(extra, charset) <= 0)
+			{
+				std::cout << "error: wordpress_check_cmdline().set_extra_charset() is wrong!" << std::endl;
+				return -1;
+			}
+		}
+		//! 1.4 设置随机盐种子seed和产生方式salt_mode
+		else if (it->first == std::string("seed") || it->first == std::string("salt_mode"))
+		{
+			if (check_extra_random(extra, it->first, it->second) < 0)
+			{
+				std::cout << "wordpress_check_cmdline(): " << it->first << "=" << it->second << " is not valid" << std::endl;
+				return -1;
+			}
+		}
+		else
+		{
+			std::cout << "wordpress_check_cmdline(): " << it->first << " is not valid" << std::endl;
+			return -1;
+		}
+	}
+	
+	return 0;
+}
+/**
+ *@brief 产生指定长度的随机盐
+ *@param extra wordpress的附加信息，盐的位数由extra[SALT_LEN_INDEX].cur_value.dint决定
+ *@return 二进制盐值，存储于Bytevector对象中
+ */
+ByteVector wordpress_get_random_salt(struct extra_info *extra)
+{
+	ByteVector bv_salt;
+	//! 1. 根据字符集合产生盐
+	char charset[256];
+	int charset_size = wordpress_salt_charset(extra, charset);
+	bv_salt = set_random_charset(extra[SALT_LEN_INDEX].cur_value.dint, charset, charset_size);
+	if (alg_debug)
+	{
+		std::cout<<"salt_len_in_bit="<<extra[SALT_LEN_INDEX].cur_value.dint<<std::endl;
+		std::cout<<"bv_salt="<<bv_salt<<std::endl;
+	}
+	//! 2. 返回得到的盐
+	return bv_salt;
+	
+}
+/**
+ *@brief 批量产生n个指定长度的随机盐
+ * stream方式：整批盐来自由(seed, first_index)初始化的一段随机流；
+ * index方式：每个盐由(seed, 记录序号)单独初始化，结果与批大小、线程数无关
+ *@param salt 输出n个二进制盐值的视图
+ *@param n 盐的个数
+ *@param first_index 第一个盐对应记录的序号
+ *@param arena 本批的分配器，n个盐连续存放在其中
+ *@param extra wordpress的附加信息
+ *@return 0：正确，-1：出错
+ */
+int wordpress_get_random_salt_batch(ByteView *salt, int n, long long first_index, BatchArena &arena, struct extra_info *extra)
+{
+	//! 1. 盐的位数、字符集大小和随机数设置整批只取一次
+	int salt_len_in_bit = extra[SALT_LEN_INDEX].cur_value.dint;
+	int salt_bytes = salt_len_in_bit / 8;
+	char charset[256];
+	int charset_size = wordpress_salt_charset(extra, charset);
+	uint64_t seed = extra[SEED_INDEX].cur_value.dlong;
+	int salt_mode = extra[SALT_MODE_INDEX].cur_value.dint;
+	if (salt_bytes <= 0 || charset_size <= 0 || charset_size > 256)
+		return -1;
+	struct rng_state rng;
+	rng_seed(&rng, seed, first_index);
+	//! 2. 整批盐一次从arena中分配，根据字符集合产生n个盐
+	Byte *salt_buf = arena.alloc((size_t)salt_bytes * n, 1);
+	for (int i = 0; i < n; ++i)
+	{
+		if (salt_mode == RNG_MODE_INDEX)
+			rng_seed(&rng, seed, first_index + i);
+		rng_fill_charset(&rng, salt_buf + (size_t)i * salt_bytes, salt_bytes, charset, charset_size);
+		salt[i] = ByteView(salt_buf + (size_t)i * salt_bytes, salt_bytes);
+		if (alg_debug)
+		{
+			std::cout<<"salt_len_in_bit="<<salt_len_in_bit<<std::endl;
+			std::cout<<"bv_salt="<<ByteVector(salt[i].getByte_p(), salt_bytes)<<std::endl;
+		}
+	}
+	return 0;
+}
+/**
+ *@brief 对口令进行预处理
+ *@param pwd 输入的口令，指向口令文件映射内存的视图
+ *@param pwd_len 口令字节数
+ *@return 二进制口令值，存储于自定义Bytevector对象中
+ */
+ByteVector wordpress_prepare_pwd(const char *pwd, int pwd_len)
+{
+	ByteVector bv_pwd_raw;
+	//! 1. 将口令转为二进制值，wordpress口令二进制值为口令ASCII码
+	bv_pwd_raw = chararray2BV_raw(pwd, pwd_len);
+	
+	return bv_pwd_raw;
+}
+
+/**
+ *@brief 根据pwd,salt(以字节为单位)，附加信息产生wordpress算法二进制hash值
+ *@param pwd 二进制口令值
+ *@param salt8 8个字节的二进制颜值
+ *@param extra wordpress算法的附加信息
+ *@return 16字节的二进制hash值，存储于ByteVector对象中
+ */
+ByteVector wordpress_hash_pwd(ByteView pwd, ByteView salt8, struct extra_info *extra)
+{
+	ByteVector result16;
+	
+	//! 1. 根据extra[ITER_POS_INDEX].cur_value.dchar[0]获取迭代次数iter_count
+	uint32_t iter_count = 1u << tbl[extra[ITER_POS_INDEX].cur_value.dchar[0]];
+	if (iter_count > 0x80000000)
+	{
+		std::cout<<"error:iter_count is wrong in wordpress"<<std::endl;
+		return result16;
+	}
+	//! 2. result16=MD5(salt8+pwd);
+	unsigned char hash[MD5_DIGEST_SIZE];
+	uint32_t digest[4];
+	md5_concat(hash, salt8.getByte_p(), salt8.size(), pwd.getByte_p(), pwd.size());
+	md5_bytes2words(digest, hash);
+	//! 3. 循环iter_count次 result16 = MD5(result16 + pwd)，消息分组只构造一次，迭代过程不分配内存
+	struct md5_chain chain;
+	if (md5_chain_init(&chain, pwd.getByte_p(), pwd.size()) != 0)
+	{
+		std::cout<<"error:md5_chain_init() is wrong in wordpress"<<std::endl;
+		return result16;
+	}
+	md5_chain_iterate(&chain, digest, iter_count);
+	md5_chain_free(&chain);
+	md5_words2bytes(hash, digest);
+	result16.assign(hash, MD5_DIGEST_SIZE);
+    //! 4. 返回16字节的二进制hash值
+    return result16;		
+}
+/**
+ *@brief wordpress热点循环的运行时策略，迭代次数和盐长度每批从附加信息读取，由md5_mb_chain_iterate()按迭代次数选择内核
+ */
+struct wordpress_runtime_policy {
+	static int iter_log2(struct extra_info *extra) { return tbl[(uint8_t)extra[ITER_POS_INDEX].cur_value.dchar[0]]; }
+	static int salt_bytes(struct extra_info *extra) { return extra[SALT_LEN_INDEX].cur_value.dint / 8; }
+	static void iterate(struct md5_mb_lane *lanes, int n, uint32_t count) { md5_mb_chain_iterate(lanes, n, count); }
+};
+
+/**
+ *@brief wordpress热点循环的编译期策略，迭代次数和盐长度都是常量，直接调用迭代次数特化的MD5内核
+ *@param ITER_POS 迭代次数标识，如'B'，tbl[ITER_POS]必须有对应的md5_mb_chain_iterate_fixed实例
+ */
+template <char ITER_POS>
+struct wordpress_fixed_policy {
+	static constexpr int LOG2 = tbl[(uint8_t)ITER_POS];
+	static int iter_log2(struct extra_info *) { return LOG2; }
+	static int salt_bytes(struct extra_info *) { return WORDPRESS_SALT_BYTES; }
+	static void iterate(struct md5_mb_lane *lanes, int n, uint32_t) { md5_mb_chain_iterate_fixed<LOG2>(lanes, n); }
+};
+
+/**
+ *@brief 批量产生wordpress算法二进制hash值，n条迭代链交给多缓冲MD5内核同步推进
+ * 以策略类型Policy实例化，编译期策略的迭代次数和盐长度为常量，迭代时不再按迭代次数查找内核
+ *@param pwd n个二进制口令值
+ *@param salt n个8字节二进制盐值
+ *@param hash 输出n个16字节的二进制hash值的视图
+ *@param n 口令个数
+ *@param arena 本批的分配器，迭代链和hash值都从中分配
+ *@param extra wordpress算法的附加信息
+ *@return 0：正确，-1：出错
+ */
+template <class Policy>
+int wordpress_hash_pwd_batch_t(const ByteView *pwd, const ByteView *salt, ByteView *hash, int n, BatchArena &arena, struct extra_info *extra)
+{
+	//! 1. 由策略得到迭代次数iter_count，phpass的迭代次数最多为2^30
+	int iter_log2 = Policy::iter_log2(extra);
+	int salt_bytes = Policy::salt_bytes(extra);
+	if (iter_log2 > 30)
+	{
+		std::cout<<"error:iter_count is wrong in wordpress"<<std::endl;
+		return -1;
+	}
+	uint32_t iter_count = 1u << iter_log2;
+	//! 2. 每条链的初始摘要为MD5(salt8+pwd)，迭代链数组从arena中分配
+	struct md5_mb_lane *lanes = (struct md5_mb_lane *)arena.alloc(sizeof(struct md5_mb_lane) * n);
+	unsigned char result[MD5_DIGEST_SIZE];
+	for (int i = 0; i < n; ++i)
+	{
+		if (salt[i].size() != salt_bytes)
+		{
+			std::cout<<"error:salt length is wrong in wordpress"<<std::endl;
+			return -1;
+		}
+		lanes[i].pwd = pwd[i].getByte_p();
+		lanes[i].pwd_len = pwd[i].size();
+		md5_concat(result, salt[i].getByte_p(), salt_bytes, pwd[i].getByte_p(), pwd[i].size());
+		md5_bytes2words(lanes[i].digest, result);
+	}
+	//! 3. 所有链同步执行iter_count轮 result16 = MD5(result16 + pwd)
+	Policy::iterate(lanes, n, iter_count);
+	//! 4. n个16字节的二进制hash值连续存放在arena中
+	Byte *hash_buf = arena.alloc((size_t)MD5_DIGEST_SIZE * n);
+	for (int i = 0; i < n; ++i)
+	{
+		md5_words2bytes(hash_buf + (size_t)i * MD5_DIGEST_SIZE, lanes[i].digest);
+		hash[i] = ByteView(hash_buf + (size_t)i * MD5_DIGEST_SIZE, MD5_DIGEST_SIZE);
+	}
+	return 0;
+}
+
+//! 通用的批量hash接口，迭代次数和盐长度在运行时读取
+int wordpress_hash_pwd_batch(const ByteView *pwd, const ByteView *salt, ByteView *hash, int n, BatchArena &arena, struct extra_info *extra)
+{
+	return wordpress_hash_pwd_batch_t<wordpress_runtime_policy>(pwd, salt, hash, n, arena, extra);
+}
+
+/**
+ *@brief 编译期特化表，常用的iter_pos各有一个模板实例，与md5_mb中迭代次数特化的内核对应，只用于8字节的盐
+ */
+static const struct {
+	char iter_pos;
+	int (*hash_pwd_batch)(const ByteView *pwd, const ByteView *salt, ByteView *hash, int n, BatchArena &arena, struct extra_info *extra);
+} wordpress_specialized[] = {
+	{'9', wordpress_hash_pwd_batch_t<wordpress_fixed_policy<'9'> >},
+	{'A', wordpress_hash_pwd_batch_t<wordpress_fixed_policy<'A'> >},
+	{'B', wordpress_hash_pwd_batch_t<wordpress_fixed_policy<'B'> >},
+	{'C', wordpress_hash_pwd_batch_t<wordpress_fixed_policy<'C'> >},
+};
+
+/**
+ *@brief 根据当前的iter_pos选择编译期特化的批量hash实现，盐不是8字节或没有对应实例时使用通用实现
+ *@param desp wordpress算法描述
+ */
+int wordpress_specialize_alg_desp(struct alg_desp *desp)
+{
+	char iter_pos = desp->extra[ITER_POS_INDEX].cur_value.dchar[0];
+
+	desp->hash_pwd_batch = wordpress_hash_pwd_batch;
+	if (desp->extra[SALT_LEN_INDEX].cur_value.dint != WORDPRESS_SALT_BYTES * 8)
+		return 0;
+	for (size_t i = 0; i < sizeof(wordpress_specialized) / sizeof(wordpress_specialized[0]); ++i)
+	{
+		if (wordpress_specialized[i].iter_pos == iter_pos)
+		{
+			desp->hash_pwd_batch = wordpress_specialized[i].hash_pwd_batch;
+			break;
+		}
+	}
+	return 0;
+}
+/**
+ *@brief 把一个密文写入dst：$P$ 迭代次数标识 盐 22个base64字符，共WORDPRESS_CIPHER_FIXED + 盐长度个字节
+ *@param dst 输出位置，不以'\0'结尾
+ *@param iter_pos 迭代次数标识
+ *@param hash16 16字节hash值
+ *@param salt 盐
+ */
+static inline void wordpress_format_cipher(char *dst, char iter_pos, const Byte *hash16, ByteView salt)
+{
+	memcpy(dst, "$P$", 3);
+	dst[3] = iter_pos;
+	memcpy(dst + 4, salt.getByte_p(), salt.size());
+	encode64_md5(hash16, (unsigned char *)dst + 4 + salt.size());
+}
+/**
+ *@brief 根据hash,salt,附加信息产生符合hashcat规范的密文字符串
+ *@param hash16 16字节hash值
+ *@param salt8 8字节salt值
+ *@param extra wordpress算法的附加信息
+ *@return wordpress的密文字符串，hash值或盐长度不对时返回空字符串
+ */
+std::string wordpress_get_cipher(ByteView hash, ByteView salt, struct extra_info *extra)
+{
+	//$P$984478476IagS59wHZvyQMArzfx58u.
+	//$P$ iter_pos 8个任意字符的盐  22个base64编码字符
+	char cipher[WORDPRESS_CIPHER_FIXED + CIPHER_MAX_SALT];
+	if (hash.size() != MD5_DIGEST_SIZE || salt.size() > CIPHER_MAX_SALT)
+		return std::string();
+	wordpress_format_cipher(cipher, extra[ITER_POS_INDEX].cur_value.dchar[0], hash.getByte_p(), salt);
+	if (alg_debug)
+		std::cout<<"cipher="<<std::string(cipher, WORDPRESS_CIPHER_FIXED + salt.size())<<std::endl;
+	return std::string(cipher, WORDPRESS_CIPHER_FIXED + salt.size());
+}
+/**
+ *@brief 批量产生n个密文，直接写入输出缓冲区中，每个密文后加'\n'
+ * 盐长度相同时每条记录定长(8字节盐为34字节加'\n')，先计算总长度一次扩展out，再逐条写入各自的位置，
+ * 不经过临时字符串；hash值用向量化的encode64_md5编码
+ *@param hash n个16字节hash值
+ *@param salt n个8字节salt值
+ *@param n 密文个数
+ *@param extra wordpress算法的附加信息
+ *@param out 输出缓冲区
+ *@return 0：正确，-1：出错
+ */
+int wordpress_get_cipher_batch(const ByteView *hash, const ByteView *salt, int n, struct extra_info *extra, std::string &out)
+{
+	char iter_pos = extra[ITER_POS_INDEX].cur_value.dchar[0];
+	
+	//! 1. 检查hash值长度，计算本批密文的总字节数
+	size_t total = 0;
+	for (int i = 0; i < n; ++i)
+	{
+		if (hash[i].size() != MD5_DIGEST_SIZE)
+			return -1;
+		total += WORDPRESS_CIPHER_FIXED + salt[i].size() + 1;
+	}
+	//! 2. 一次扩展输出缓冲区，每个密文写入自己的位置
+	size_t begin = out.size();
+	out.resize(begin + total);
+	char *dst = &out[begin];
+	for (int i = 0; i < n; ++i)
+	{
+		//! 密文格式：$P$ 迭代次数标识 salt hash(base64编码)
+		wordpress_format_cipher(dst, iter_pos, hash[i].getByte_p(), salt[i]);
+		dst += WORDPRESS_CIPHER_FIXED + salt[i].size();
+		if (alg_debug)
+			std::cout<<"cipher="<<std::string(dst - WORDPRESS_CIPHER_FIXED - salt[i].size(), WORDPRESS_CIPHER_FIXED + salt[i].size())<<std::endl;
+		*dst++ = '\n';
+	}
+	return 0;
+}
+/**
+ *@brief 解析wordpress密文字符串，格式为 $P$ 迭代次数标识 8(或4)个字符的盐 22个base64编码字符
+ *@param cipher 密文字符串
+ *@param cipher_len 密文字节数
+ *@param salt 输出二进制盐值
+ *@param salt_len 输出盐的字节数
+ *@param hash 输出16字节的二进制hash值
+ *@param hash_len 输出hash值的字节数
+ *@param extra wordpress的附加信息，设置迭代次数标识iter_pos和盐长度salt_len的当前值
+ *@return 0：正确，-1：不是wordpress密文
+ */
+int wordpress_parse_cipher(const char *cipher, int cipher_len, unsigned char *salt, int &salt_len, unsigned char *hash, int &hash_len, struct extra_info *extra)
+{
+	//! 1. 检查前缀和长度，盐为8或4个字符
+	int salt_bytes = cipher_len - 4 - 22;
+	if ((salt_bytes != 8 && salt_bytes != 4) || memcmp(cipher, "$P$", 3) != 0)
+		return -1;
+	//! 2. 迭代次数标识必须是base64字符，phpass的迭代次数为2^7..2^30
+	char iter_pos = cipher[3];
+	if (iter_pos == '\0' || strchr((const char *)base64Char2, iter_pos) == NULL)
+		return -1;
+	if (tbl[(uint8_t)iter_pos] < 7 || tbl[(uint8_t)iter_pos] > 30)
+		return -1;
+	//! 3. 向量化解码hash值
+	if (decode64_md5((const unsigned char *)cipher + 4 + salt_bytes, hash) != 0)
+		return -1;
+	hash_len = MD5_DIGEST_SIZE;
+	memcpy(salt, cipher + 4, salt_bytes);
+	salt_len = salt_bytes;
+	//! 4. 密文自带的参数写入附加信息的当前值
+	memset(extra[ITER_POS_INDEX].cur_value.dchar, '\0', 32);
+	extra[ITER_POS_INDEX].cur_value.dchar[0] = iter_pos;
+	extra[SALT_LEN_INDEX].cur_value.dint = salt_bytes * 8;
+	return 0;
+}
+
+/**
+ *@brief 估计一条记录的MD5压缩次数：迭代次数乘以每轮MD5(hash16+pwd)的分组数
+ *@param pwd_len 预处理后口令的字节数
+ *@param params 按cipher_params顺序的参数值，params[0]为迭代次数标识
+ *@return MD5压缩次数
+ */
+long long wordpress_estimate_cost(int pwd_len, const union extra_data *params)
+{
+	long long iter_count = 1LL << tbl[(uint8_t)params[0].dchar[0]];
+	return iter_count * ((MD5_DIGEST_SIZE + pwd_len + 8) / MD5_BLOCK_SIZE + 1);
+}
+
+/**
+ *@brief 盐的位数是否是salt_len的可选值之一
+ */
+static bool wordpress_valid_salt_bits(const struct extra_info *extra, int bits)
+{
+	for (int i = 0; i < extra[SALT_LEN_INDEX].optionvalue; ++i)
+	{
+		if (extra[SALT_LEN_INDEX].values[i].dint == bits)
+			return true;
+	}
+	return false;
+}
+
+/**
+ *@brief 检查--records一行的盐长度和迭代次数标识，写入本行的参数值
+ *@param salt_len 本行盐的字节数，给定的盐或随机盐
+ *@param field 迭代次数标识字段，一个base64字符，phpass的迭代次数为2^7..2^30
+ *@param len 字段的字节数，为0时使用命令行的iter_pos
+ *@param extra wordpress的附加信息，只读
+ *@param params 按cipher_params顺序的参数值，params[0]为迭代次数标识，params[1]为盐的位数
+ *@return 0：正确，-1：盐长度或迭代次数标识不对
+ */
+int wordpress_parse_record_params(int salt_len, const char *field, int len, const struct extra_info *extra, union extra_data *params)
+{
+	if (!wordpress_valid_salt_bits(extra, salt_len * 8))
+		return -1;
+	params[1].dint = salt_len * 8;
+	if (len == 0)
+		return 0;
+	char iter_pos = field[0];
+	if (len != 1 || strchr((const char *)base64Char2, iter_pos) == NULL || tbl[(uint8_t)iter_pos] < 7 || tbl[(uint8_t)iter_pos] > 30)
+		return -1;
+	memset(params[0].dchar, '\0', sizeof(params[0].dchar));
+	params[0].dchar[0] = iter_pos;
+	return 0;
+}
+	
+//! wordpress算法的算法描述结构体定义
+struct alg_desp wordpress_alg_desp = {
+	wordpress_init_alg_desp,
+	wordpress_check_cmdline,
+	wordpress_get_random_salt,
+	wordpress_prepare_pwd,
+	wordpress_hash_pwd,
+	wordpress_get_cipher,
+	wordpress_get_random_salt_batch,
+	wordpress_hash_pwd_batch,
+	wordpress_get_cipher_batch,
+	wordpress_specialize_alg_desp,
+	wordpress_parse_cipher,
+	2, {ITER_POS_INDEX, SALT_LEN_INDEX},    //密文中的迭代次数标识和盐长度
+	wordpress_estimate_cost,
+	wordpress_parse_record_params,
+	"wordpress"
+};
@@ -0,0 +1,141 @@
+/**
+ *@file alg_registry.cpp
+ *@brief 算法名称表和附加信息解析的实现文件
+ *
+ * 名称表和附加信息值的正则表达式都是只读的静态数据，正则表达式在第一次使用时编译一次，
+ * 之后多个线程可以同时查找和解析
+ *@version 0.1
+ */
+#include "include/alg_registry.h"
+#include <regex>
+
+extern struct alg_desp wordpress_alg_desp;
+
+/**
+ *@brief 注册的算法名和对应的算法描述
+ */
+static const struct {
+	const char *name;
+	const struct alg_desp *desp;
+} registered_algs[] = {
+	{"wordpress", &wordpress_alg_desp},
+};
+
+/**
+ *@brief 附加信息的名称和值的格式
+ */
+static const struct {
+	const char *name;
+	const char *pattern;
+} extra_value_patterns[] = {
+	{"salt_len", "\\d+"},    //匹配任何一个数字字符
+	{"iter_pos", "\\S"},     //匹配任何一个可见字符
+	{"salt_charset", "(\\[[0-9A-Za-z\\./]{1}\\-[0-9A-Za-z\\./]{1}\\])+"},    //匹配[*-*]这样的1个或多个字符集
+	{"seed", "\\d{1,20}"},            //随机盐种子
+	{"salt_mode", "stream|index"},    //随机盐产生方式
+};
+
+/**
+ *@brief 编译所有附加信息值的正则表达式
+ */
+static std::map<std::string, std::regex> compile_extra_patterns()
+{
+	std::map<std::string, std::regex> patterns;
+	for (size_t i = 0; i < sizeof(extra_value_patterns) / sizeof(extra_value_patterns[0]); ++i)
+		patterns.insert(std::make_pair(std::string(extra_value_patterns[i].name), std::regex(extra_value_patterns[i].pattern)));
+	return patterns;
+}
+
+const struct alg_desp *find_alg_desp(const std::string &alg_name)
+{
+	for (size_t i = 0; i < sizeof(registered_algs) / sizeof(registered_algs[0]); ++i)
+	{
+		if (alg_name == registered_algs[i].name)
+			return registered_algs[i].desp;
+	}
+	return NULL;
+}
+
+/**
+ *@brief 检查一个"名称=值"形式的附加信息，同名的附加信息只保留第一个
+ *@param extra_arg 附加信息，如salt_len=32、salt_charset=[0-9][a-z]
+ *@param extra_name_value 名称-值map
+ *@param error 出错时的原因
+ *@return 0：正确，-1：格式不对
+ */
+int parse_extra_arg(const std::string &extra_arg, std::map<std::string, std::string> &extra_name_value, std::string &error)
+{
+	static const std::map<std::string, std::regex> patterns = compile_extra_patterns();
+
+	//! 1. 利用‘=’切割获取到附加信息名称和值
+	size_t index = extra_arg.find('=');
+	if (index == std::string::npos)
+	{
+		error = "[no '='], the format of extra_info" + extra_arg + " is wrong!";
+		return -1;
+	}
+	std::string extra_name = extra_arg.substr(0, index);
+	std::string extra_value = extra_arg.substr(index + 1);
+
+	//! 2. 检查附加信息名称是否存在，再检查值的格式是否正确
+	std::map<std::string, std::regex>::const_iterator it = patterns.find(extra_name);
+	if (it == patterns.end())
+	{
+		error = "extra_name: " + extra_name + " is not valid!";
+		return -1;
+	}
+	if (!std::regex_match(extra_value, it->second))
+	{
+		error = "extra_value: " + extra_value + " is not valid!";
+		return -1;
+	}
+
+	//! 3. 如果附加信息是salt_charset，就先把[0-9][a-z]处理成09az这种形式
+	if (extra_name == "salt_charset")
+	{
+		std::string charset;
+		for (size_t i = 0; i + 5 <= extra_value.size(); i += 5)    //每个子字符集为[x-y]共5个字符
+		{
+			charset.push_back(extra_value[i + 1]);
+			charset.push_back(extra_value[i + 3]);
+		}
+		extra_value = charset;
+	}
+	extra_name_value.insert(std::make_pair(extra_name, extra_value));
+	return 0;
+}
+
+/**
+ *@brief 根据算法名和附加信息得到初始化后的算法描述
+ *@param alg_name 算法名
+ *@param extra_name_value parse_extra_arg()得到的名称-值map
+ *@param desp 输出算法描述，之后由调用者按需特化
+ *@param error 出错时的原因
+ *@return 0：正确，-1：出错
+ */
+int init_named_alg(const std::string &alg_name, std::map<std::string, std::string> &extra_name_value, struct alg_desp *desp, std::string &error)
+{
+	//! 1. 根据算法名得到算法描述结构体
+	const struct alg_desp *registered = find_alg_desp(alg_name);
+	if (registered == NULL)
+	{
+		error = "alg_name:" + alg_name + " is not exist!";
+		return -1;
+	}
+	*desp = *registered;
+
+	//! 2. 初始化算法描述结构体
+	if (desp->init_alg_desp(desp->extra) != 0)
+	{
+		error = "init_alg_desp() is wrong!";
+		return -1;
+	}
+
+	//! 3. 再次检查用户输入的信息，设置算法描述结构体的当前值
+	if (desp->check_cmdline(desp->extra, extra_name_value) != 0)
+	{
+		error = "check_cmdline() is wrong!";
+		return -1;
+	}
+	return 0;
+}
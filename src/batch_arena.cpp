@@ -0,0 +1,84 @@
+/**
+ *@file batch_arena.cpp
+ *@brief 每批记录使用的线性分配器实现文件
+ *@version 0.1
+ */
+#include "include/batch_arena.h"
+#include <stdlib.h>
+#include <new>
+
+//! 每块开头的链表头占用的字节数，保持可用区按64字节对齐
+#define ARENA_HEADER_SIZE 64
+
+BatchArena::BatchArena(size_t block_size)
+	: head_block(NULL), head(NULL), head_size(0), head_used(0), retired_size(0), retired_used(0)
+{
+	if (block_size > 0)
+		alloc_slow(block_size, 1);
+	head_used = 0;
+}
+
+BatchArena::~BatchArena()
+{
+	while (head_block != NULL)
+	{
+		struct block *prev = head_block->prev;
+		free(head_block);
+		head_block = prev;
+	}
+}
+
+/**
+ *@brief 当前块不够时追加一个新块，新块至少为已占用内存的大小，块数按对数增长
+ *@param size 要分配的字节数
+ *@param align 对齐字节数
+ *@return 分配的地址
+ */
+Byte *BatchArena::alloc_slow(size_t size, size_t align)
+{
+	size_t block_size = size + align;
+	if (block_size < capacity())
+		block_size = capacity();
+	if (block_size < ARENA_MIN_BLOCK_SIZE)
+		block_size = ARENA_MIN_BLOCK_SIZE;
+
+	struct block *new_block = (struct block *)aligned_alloc(ARENA_HEADER_SIZE, ARENA_HEADER_SIZE + (block_size + ARENA_HEADER_SIZE - 1) / ARENA_HEADER_SIZE * ARENA_HEADER_SIZE);
+	if (new_block == NULL)
+		throw std::bad_alloc();
+	new_block->prev = head_block;
+	new_block->size = block_size;
+	if (head_block != NULL)
+	{
+		retired_size += head_size;
+		retired_used += head_used;
+	}
+	head_block = new_block;
+	head = (Byte *)new_block + ARENA_HEADER_SIZE;
+	head_size = block_size;
+	head_used = 0;
+	return alloc(size, align);
+}
+
+/**
+ *@brief 回收所有分配。只有一块时是O(1)；上一批用了多块时，释放所有块并分配一块能容纳上一批的内存
+ */
+void BatchArena::reset()
+{
+	if (head_block != NULL && head_block->prev != NULL)
+	{
+		size_t total = capacity();
+		while (head_block != NULL)
+		{
+			struct block *prev = head_block->prev;
+			free(head_block);
+			head_block = prev;
+		}
+		head = NULL;
+		head_size = 0;
+		retired_size = 0;
+		retired_used = 0;
+		alloc_slow(total, 1);
+	}
+	head_used = 0;
+	retired_used = 0;
+}
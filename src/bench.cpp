@@ -0,0 +1,606 @@
+/**
+ *@file bench.cpp
+ *@brief 吞吐量基准测试程序，由make bench生成
+ *@version 0.1
+ */
+/*
+ * 程序使用命令：
+ *   ./bench [-a alg_list] [-i iter_pos_list] [-p pwd_len_list] [-t thread_list] [-b batch_list] [-n record_num] [-r repeat] [-d tmp_dir] [-j json_file]
+ *   ./bench --check
+ * 输入：
+ *   -a          算法名称列表，逗号分隔，缺省为wordpress
+ *   -i          迭代次数标识列表，缺省为7,9,B
+ *   -p          口令长度列表，缺省为8,48,120，分别对应每轮1、2、3个MD5分组
+ *   -t          hash工作线程数列表，缺省为1和CPU核数
+ *   -b          每批口令个数列表，缺省为256
+ *   -n          每组参数计算的口令个数，缺省为2048
+ *   -r          每组参数重复次数，取最快的一次，缺省为1
+ *   -d          临时口令文件和密文文件所在的目录，缺省为/tmp
+ *   -j          结果另外以JSON格式写入json_file
+ *   --check     不测吞吐量，用随机数据对比向量化实现与标量实现：encode64_md5、decode64_md5对比encode64、decode64，
+ *               CPU支持的每个md5_mb内核(包括迭代轮数特化的内核)对比md5_chain_iterate，全部一致时返回0
+ * 输出：
+ *   对(算法, 迭代次数标识, 口令长度, 线程数, 批大小)的每个组合输出一行：
+ *   hashes/s    多线程流水线端到端(读口令文件到写密文文件)每秒产生的密文数
+ *   ns/md5      单线程hash阶段平均每次MD5压缩的纳秒数
+ *   salt prepare hash format io    单线程逐阶段计算时每条记录各阶段的纳秒数
+ * 环境变量MYJTR_MD5_KERNEL=avx512|avx2|sse2|scalar可以指定MD5内核，用于比较各内核
+ */
+
+#include "include/extra_info.h"
+#include "include/pipeline.h"
+#include "include/batch_arena.h"
+#include "include/common.h"
+#include "include/md5_mb.h"
+#include "include/wordpress.h"
+#include "include/rng.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <chrono>
+#include <streambuf>
+
+extern struct alg_desp wordpress_alg_desp;
+
+/**
+ *@brief 可测试的算法，与alg_registry.cpp中注册的算法相同
+ */
+static const struct {
+	const char *name;
+	struct alg_desp *desp;
+} bench_algs[] = {
+	{"wordpress", &wordpress_alg_desp},
+};
+
+#define BENCH_STAGE_NUM 5
+static const char *stage_names[BENCH_STAGE_NUM] = {"salt", "prepare", "hash", "format", "io"};
+
+/**
+ *@brief 一组参数的测试结果
+ */
+struct bench_result {
+	std::string alg_name;
+	char iter_pos;
+	int pwd_len;
+	int thread_num;
+	int batch_size;
+	double md5_per_record;                  //每条记录的MD5压缩次数，未知的算法为0
+	double seconds;                         //端到端最快一次的秒数
+	double hashes_per_s;
+	double ns_per_md5;
+	double stage_ns[BENCH_STAGE_NUM];       //每条记录各阶段的纳秒数
+};
+
+/**
+ *@brief 丢弃所有输出的缓冲区，测试期间替换std::cout，避免算法的调试输出影响结果
+ */
+class NullBuffer : public std::streambuf
+{
+	protected:
+		int overflow(int c) { return c; }
+};
+
+static double now_seconds()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ *@brief 解析逗号分隔的列表
+ */
+static std::vector<std::string> split_list(const char *s)
+{
+	std::vector<std::string> items;
+	std::string cur;
+	for (; ; ++s)
+	{
+		if (*s == ',' || *s == '\0')
+		{
+			if (!cur.empty())
+				items.push_back(cur);
+			cur.clear();
+			if (*s == '\0')
+				break;
+		}
+		else
+			cur += *s;
+	}
+	return items;
+}
+
+/**
+ *@brief 解析逗号分隔的整数列表，每个值都必须在[min_value, max_value]中
+ *@return 0：正确，-1：出错
+ */
+static int parse_int_list(const char *s, int min_value, int max_value, std::vector<int> &values)
+{
+	std::vector<std::string> items = split_list(s);
+	values.clear();
+	for (size_t i = 0; i < items.size(); ++i)
+	{
+		int value = atoi(items[i].c_str());
+		if (value < min_value || value > max_value)
+		{
+			printf("error: %s must be in [%d, %d]!\n", items[i].c_str(), min_value, max_value);
+			return -1;
+		}
+		values.push_back(value);
+	}
+	return values.empty() ? -1 : 0;
+}
+
+/**
+ *@brief 每条记录的MD5压缩次数，wordpress为初始的MD5(salt+pwd)加上2^n轮MD5(hash16+pwd)
+ *@return 压缩次数，不知道的算法返回0
+ */
+static double md5_per_record(struct alg_desp *desp, int pwd_len)
+{
+	if (desp->alg_name != "wordpress")
+		return 0;
+	int salt_bytes = desp->extra[SALT_LEN_INDEX].cur_value.dint / 8;
+	double iter_count = (double)(1u << tbl[(uint8_t)desp->extra[ITER_POS_INDEX].cur_value.dchar[0]]);
+	int init_blocks = (salt_bytes + pwd_len + 8) / 64 + 1;
+	int iter_blocks = (MD5_DIGEST_SIZE + pwd_len + 8) / 64 + 1;
+	return init_blocks + iter_count * iter_blocks;
+}
+
+/**
+ *@brief 产生n个长度为pwd_len的可打印字符口令，写入口令文件，内容只由口令长度决定
+ *@return 0：正确，-1：出错
+ */
+static int write_pwd_file(const char *path, int n, int pwd_len)
+{
+	static char charset[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+	CipherWriter out;
+	if (out.open(path) != 0)
+		return -1;
+	struct rng_state rng;
+	rng_seed(&rng, 0x62656e6368ULL, pwd_len);
+	std::string line(pwd_len + 1, '\n');
+	for (int i = 0; i < n; ++i)
+	{
+		rng_fill_charset(&rng, (unsigned char *)&line[0], pwd_len, charset, strlen(charset));
+		if (out.write(line.data(), line.size()) != 0)
+			return -1;
+	}
+	return out.close();
+}
+
+/**
+ *@brief 单线程按批依次执行各阶段，记录每个阶段的耗时
+ *@param desp 已初始化的算法描述
+ *@param pwd_path 口令文件
+ *@param cipher_path 密文文件
+ *@param batch_size 每批口令个数
+ *@param stage_seconds 输出各阶段的秒数
+ *@return 0：正确，-1：出错
+ */
+static int run_stages(struct alg_desp *desp, const char *pwd_path, const char *cipher_path, int batch_size, double *stage_seconds)
+{
+	PwdReader file_in;
+	CipherWriter file_out;
+	if (file_in.open(pwd_path) != 0 || file_out.open(cipher_path) != 0)
+		return -1;
+	std::vector<const char *> pwd(batch_size);
+	std::vector<int> pwd_len(batch_size);
+	std::vector<ByteView> salt(batch_size), pwd_view(batch_size), hash(batch_size);
+	BatchArena arena((size_t)batch_size * 128);
+	std::string cipher;
+	long long first_index = 0;
+	for (int k = 0; k < BENCH_STAGE_NUM; ++k)
+		stage_seconds[k] = 0;
+
+	while (true)
+	{
+		int n = 0;
+		while (n < batch_size && file_in.next(pwd[n], pwd_len[n]))
+			++n;
+		if (n == 0)
+			break;
+		arena.reset();
+		double t0 = now_seconds();
+		if (alg_get_random_salt_batch(desp, &salt[0], n, first_index, arena) != 0)
+			return -1;
+		double t1 = now_seconds();
+		for (int i = 0; i < n; ++i)
+		{
+			ByteVector bv_pwd = desp->prepare_pwd(pwd[i], pwd_len[i]);
+			if (bv_pwd.isEmpty())
+				return -1;
+			pwd_view[i] = arena.copy(bv_pwd.getByte_p(), bv_pwd.size());
+		}
+		double t2 = now_seconds();
+		if (alg_hash_pwd_batch(desp, &pwd_view[0], &salt[0], &hash[0], n, arena) != 0)
+			return -1;
+		double t3 = now_seconds();
+		cipher.clear();
+		if (alg_get_cipher_batch(desp, &hash[0], &salt[0], n, cipher) != 0)
+			return -1;
+		double t4 = now_seconds();
+		if (file_out.write(cipher.data(), cipher.size()) != 0)
+			return -1;
+		double t5 = now_seconds();
+		stage_seconds[0] += t1 - t0;
+		stage_seconds[1] += t2 - t1;
+		stage_seconds[2] += t3 - t2;
+		stage_seconds[3] += t4 - t3;
+		stage_seconds[4] += t5 - t4;
+		first_index += n;
+	}
+	double t0 = now_seconds();
+	int ret = file_out.close();
+	stage_seconds[4] += now_seconds() - t0;
+	file_in.close();
+	return ret;
+}
+
+/**
+ *@brief 多线程流水线端到端处理整个口令文件
+ *@param seconds 输出耗时
+ *@return 0：正确，-1：出错
+ */
+static int run_end_to_end(struct alg_desp *desp, const char *pwd_path, const char *cipher_path, int thread_num, int batch_size, double &seconds)
+{
+	struct pipeline_option option;
+	init_pipeline_option(&option);
+	option.thread_num = thread_num;
+	option.batch_size = batch_size;
+	PwdReader file_in;
+	CipherWriter file_out;
+	if (file_in.open(pwd_path) != 0 || file_out.open(cipher_path) != 0)
+		return -1;
+	double t0 = now_seconds();
+	int ret = run_pipeline(desp, file_in, file_out, &option);
+	if (file_out.close() != 0)
+		ret = -1;
+	seconds = now_seconds() - t0;
+	file_in.close();
+	return ret;
+}
+
+/**
+ *@brief 按指定算法名和迭代次数标识初始化算法描述，选择编译期特化的实现
+ *@return 0：正确，-1：出错
+ */
+static int setup_alg(const std::string &alg_name, char iter_pos, struct alg_desp &desp)
+{
+	for (size_t k = 0; k < sizeof(bench_algs) / sizeof(bench_algs[0]); ++k)
+	{
+		if (alg_name != bench_algs[k].name)
+			continue;
+		desp = *bench_algs[k].desp;
+		if (desp.init_alg_desp(desp.extra) != 0)
+			return -1;
+		std::map<std::string, std::string> extra_name_value;
+		extra_name_value["iter_pos"] = std::string(1, iter_pos);
+		extra_name_value["seed"] = "1";
+		if (desp.check_cmdline(desp.extra, extra_name_value) != 0)
+			return -1;
+		if (desp.specialize_alg_desp != NULL && desp.specialize_alg_desp(&desp) != 0)
+			return -1;
+		return 0;
+	}
+	printf("error: alg_name:%s is not exist!\n", alg_name.c_str());
+	return -1;
+}
+
+static void print_header()
+{
+	printf("%-10s %4s %7s %7s %6s %13s %8s", "alg", "iter", "pwd_len", "threads", "batch", "hashes/s", "ns/md5");
+	for (int k = 0; k < BENCH_STAGE_NUM; ++k)
+		printf(" %10s", stage_names[k]);
+	printf("\n");
+}
+
+static void print_result(const struct bench_result &r)
+{
+	printf("%-10s %4c %7d %7d %6d %13.1f %8.2f", r.alg_name.c_str(), r.iter_pos, r.pwd_len, r.thread_num, r.batch_size, r.hashes_per_s, r.ns_per_md5);
+	for (int k = 0; k < BENCH_STAGE_NUM; ++k)
+		printf(" %10.1f", r.stage_ns[k]);
+	printf("\n");
+	fflush(stdout);
+}
+
+/**
+ *@brief 把所有结果写成JSON文件
+ *@return 0：正确，-1：出错
+ */
+static int write_json(const char *path, int record_num, const std::vector<struct bench_result> &results)
+{
+	FILE *fp = fopen(path, "w");
+	if (fp == NULL)
+		return -1;
+	fprintf(fp, "{\n  \"kernel\": \"%s\",\n  \"kernel_lanes\": %d,\n  \"records\": %d,\n  \"results\": [\n",
+		md5_mb_kernel_name(), md5_mb_kernel_lanes(), record_num);
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		const struct bench_result &r = results[i];
+		fprintf(fp, "    {\"alg\": \"%s\", \"iter_pos\": \"%c\", \"pwd_len\": %d, \"threads\": %d, \"batch_size\": %d, "
+			"\"md5_per_record\": %.0f, \"seconds\": %.6f, \"hashes_per_s\": %.1f, \"ns_per_md5\": %.3f, \"stage_ns_per_record\": {",
+			r.alg_name.c_str(), r.iter_pos, r.pwd_len, r.thread_num, r.batch_size,
+			r.md5_per_record, r.seconds, r.hashes_per_s, r.ns_per_md5);
+		for (int k = 0; k < BENCH_STAGE_NUM; ++k)
+			fprintf(fp, "%s\"%s\": %.1f", k ? ", " : "", stage_names[k], r.stage_ns[k]);
+		fprintf(fp, "}}%s\n", i + 1 < results.size() ? "," : "");
+	}
+	fprintf(fp, "  ]\n}\n");
+	return fclose(fp) == 0 ? 0 : -1;
+}
+
+#define CHECK_CODEC_NUM 100000    //自检时对比的随机摘要和随机密文个数
+#define CHECK_SEED 0x6d796a7472ULL  //自检的随机数种子，结果可以复现
+
+/**
+ *@brief 对比encode64_md5、decode64_md5与通用的encode64、decode64，随机密文中约1/8含有非法字符
+ *@return 不一致的个数
+ */
+static int check_codec(struct rng_state *rng)
+{
+	int bad = 0;
+	for (int i = 0; i < CHECK_CODEC_NUM; ++i)
+	{
+		unsigned char hash[MD5_DIGEST_SIZE], code[32], ref_code[32];
+		for (int k = 0; k < MD5_DIGEST_SIZE; ++k)
+			hash[k] = rng_next(rng) & 0xff;
+		memset(code, 0, sizeof(code));
+		memset(ref_code, 0, sizeof(ref_code));
+		encode64_md5(hash, code);
+		encode64(hash, MD5_DIGEST_SIZE, ref_code);
+		if (memcmp(code, ref_code, sizeof(code)) != 0)
+			++bad;
+
+		rng_fill_charset(rng, code, 22, (const char *)base64Char2, 64);
+		if (rng_next(rng) % 8 == 0)
+			code[rng_next(rng) % 22] = "!:$* \n\0\xff"[rng_next(rng) % 8];
+		unsigned char out[MD5_DIGEST_SIZE], ref_out[MD5_DIGEST_SIZE];
+		int ret = decode64_md5(code, out), ref_ret = decode64(code, MD5_DIGEST_SIZE, ref_out);
+		if (ret != ref_ret || (ret == 0 && memcmp(out, ref_out, MD5_DIGEST_SIZE) != 0))
+			++bad;
+	}
+	printf("check: encode64_md5/decode64_md5 x %d: %s\n", CHECK_CODEC_NUM, bad ? "FAIL" : "ok");
+	return bad;
+}
+
+/**
+ *@brief 对比每个md5_mb内核与逐条的md5_chain_iterate
+ * 口令长度覆盖每轮1..MD5_MB_MAX_BLOCKS + 1个分组，迭代轮数包括普通轮数和各特化内核的2^11..2^14，
+ * 链的条数不是通道数的整数倍，分桶衔接处的混合组和不满的组都会执行
+ *@return 不一致的内核和轮数组合个数
+ */
+static int check_md5_mb(struct rng_state *rng)
+{
+	const int chain_num[] = {3, 37};
+	std::vector<uint32_t> counts;
+	counts.push_back(1);
+	counts.push_back(7);
+	for (int i = 0; i < MD5_MB_FIXED_NUM; ++i)
+		counts.push_back(1u << (MD5_MB_FIXED_MIN_LOG2 + i));
+	std::vector<int> kernel_bad(md5_mb_kernel_num(), 0);
+	int bad = 0;
+	for (size_t c = 0; c < sizeof(chain_num) / sizeof(chain_num[0]); ++c)
+	{
+		//! 1. 随机口令和初始摘要，标量实现的结果作为参考
+		int n = chain_num[c];
+		std::vector<std::vector<unsigned char> > pwd(n);
+		std::vector<struct md5_mb_lane> init(n);
+		for (int i = 0; i < n; ++i)
+		{
+			pwd[i].resize((i * 53) % ((MD5_MB_MAX_BLOCKS + 1) * MD5_BLOCK_SIZE - 8 - MD5_DIGEST_SIZE) + 1);
+			for (size_t k = 0; k < pwd[i].size(); ++k)
+				pwd[i][k] = rng_next(rng) & 0xff;
+			init[i].pwd = &pwd[i][0];
+			init[i].pwd_len = pwd[i].size();
+			for (int k = 0; k < 4; ++k)
+				init[i].digest[k] = (uint32_t)rng_next(rng);
+		}
+		for (size_t r = 0; r < counts.size(); ++r)
+		{
+			std::vector<struct md5_mb_lane> ref(init);
+			for (int i = 0; i < n; ++i)
+			{
+				struct md5_chain chain;
+				md5_chain_init(&chain, ref[i].pwd, ref[i].pwd_len);
+				md5_chain_iterate(&chain, ref[i].digest, counts[r]);
+				md5_chain_free(&chain);
+			}
+
+			//! 2. CPU支持的每个内核从相同的初始值开始，结果必须与参考相同
+			for (int k = 0; k < md5_mb_kernel_num(); ++k)
+			{
+				std::vector<struct md5_mb_lane> lanes(init);
+				if (md5_mb_chain_iterate_kernel(k, &lanes[0], n, counts[r]) != 0)
+					continue;
+				int diff = 0;
+				for (int i = 0; i < n; ++i)
+					diff += memcmp(lanes[i].digest, ref[i].digest, sizeof(ref[i].digest)) != 0;
+				if (diff > 0)
+				{
+					printf("check: md5_mb %s, %d chains x %u rounds: %d mismatches\n", md5_mb_kernel_name_at(k), n, counts[r], diff);
+					++kernel_bad[k];
+					++bad;
+				}
+			}
+		}
+	}
+	for (int k = 0; k < md5_mb_kernel_num(); ++k)
+	{
+		struct md5_mb_lane lane = {(const unsigned char *)"", 0, {0, 0, 0, 0}};
+		bool supported = md5_mb_chain_iterate_kernel(k, &lane, 1, 1) == 0;
+		printf("check: md5_mb %s: %s\n", md5_mb_kernel_name_at(k), supported ? (kernel_bad[k] ? "FAIL" : "ok") : "not supported by cpu");
+	}
+	return bad;
+}
+
+/**
+ *@brief --check：用随机数据对比向量化实现与标量实现
+ *@return 0：全部一致，-1：有不一致
+ */
+static int self_check()
+{
+	struct rng_state rng;
+	rng_seed(&rng, CHECK_SEED, 0);
+	int bad = check_codec(&rng);
+	bad += check_md5_mb(&rng);
+	printf("check: %s\n", bad ? "FAIL" : "ok");
+	return bad ? -1 : 0;
+}
+
+/**
+ *@brief main()函数，对每组参数先单线程逐阶段计时，再对每个线程数运行流水线
+ */
+int main(int argc, char **argv)
+{
+	//! 1. 解析命令行，缺省线程数为1和CPU核数
+	std::vector<std::string> alg_list(1, "wordpress");
+	std::vector<std::string> iter_list = split_list("7,9,B");
+	std::vector<int> pwd_len_list, thread_list, batch_list;
+	parse_int_list("8,48,120", 1, MD5_MB_MAX_BLOCKS * 64 - 25, pwd_len_list);
+	int cores = std::thread::hardware_concurrency();
+	thread_list.push_back(1);
+	if (cores > 1)
+		thread_list.push_back(cores > MAX_THREAD_NUM ? MAX_THREAD_NUM : cores);
+	batch_list.push_back(DEFAULT_BATCH_SIZE);
+	int record_num = 2048;
+	int repeat = 1;
+	std::string tmp_dir = "/tmp";
+	const char *json_path = NULL;
+
+	for (int argi = 1; argi < argc; ++argi)
+	{
+		std::string option = argv[argi];
+		if (option == "--check")
+			return self_check();
+		if (argi + 1 >= argc || option.size() != 2 || option[0] != '-')
+		{
+			printf("Usage: ./bench [-a alg_list] [-i iter_pos_list] [-p pwd_len_list] [-t thread_list] [-b batch_list] [-n record_num] [-r repeat] [-d tmp_dir] [-j json_file]\n");
+			printf("       ./bench --check\n");
+			return -1;
+		}
+		const char *value = argv[++argi];
+		int ret = 0;
+		switch (option[1])
+		{
+			case 'a': alg_list = split_list(value); break;
+			case 'i': iter_list = split_list(value); break;
+			case 'p': ret = parse_int_list(value, 1, MAX_PWD_LEN, pwd_len_list); break;
+			case 't': ret = parse_int_list(value, 1, MAX_THREAD_NUM, thread_list); break;
+			case 'b': ret = parse_int_list(value, 1, MAX_BATCH_SIZE, batch_list); break;
+			case 'n': record_num = atoi(value); ret = record_num < 1 ? -1 : 0; break;
+			case 'r': repeat = atoi(value); ret = repeat < 1 ? -1 : 0; break;
+			case 'd': tmp_dir = value; break;
+			case 'j': json_path = value; break;
+			default: ret = -1; break;
+		}
+		if (ret != 0)
+		{
+			printf("error: option %s %s is not valid!\n", option.c_str(), value);
+			return -1;
+		}
+	}
+	for (size_t i = 0; i < iter_list.size(); ++i)
+	{
+		if (iter_list[i].size() != 1 || strchr((const char *)base64Char2, iter_list[i][0]) == NULL
+			|| tbl[(uint8_t)iter_list[i][0]] < 7 || tbl[(uint8_t)iter_list[i][0]] > 30)
+		{
+			printf("error: iter_pos %s is not valid!\n", iter_list[i].c_str());
+			return -1;
+		}
+	}
+
+	std::string pwd_path = tmp_dir + "/bench_pwd_" + std::to_string(getpid()) + ".txt";
+	std::string cipher_path = tmp_dir + "/bench_cipher_" + std::to_string(getpid()) + ".txt";
+	printf("kernel %s (%d lanes), %d records per run, best of %d\n", md5_mb_kernel_name(), md5_mb_kernel_lanes(), record_num, repeat);
+	print_header();
+
+	//! 2. 遍历所有组合，测试期间丢弃std::cout上的调试输出
+	NullBuffer null_buffer;
+	std::vector<struct bench_result> results;
+	int ret = 0;
+	for (size_t p = 0; p < pwd_len_list.size() && ret == 0; ++p)
+	{
+		if (write_pwd_file(pwd_path.c_str(), record_num, pwd_len_list[p]) != 0)
+		{
+			printf("error: write %s failed!\n", pwd_path.c_str());
+			ret = -1;
+			break;
+		}
+		for (size_t a = 0; a < alg_list.size() && ret == 0; ++a)
+		for (size_t i = 0; i < iter_list.size() && ret == 0; ++i)
+		{
+			struct alg_desp desp;
+			if (setup_alg(alg_list[a], iter_list[i][0], desp) != 0)
+			{
+				printf("error: setup %s iter_pos=%s failed!\n", alg_list[a].c_str(), iter_list[i].c_str());
+				ret = -1;
+				break;
+			}
+			for (size_t b = 0; b < batch_list.size() && ret == 0; ++b)
+			{
+				struct bench_result r;
+				r.alg_name = alg_list[a];
+				r.iter_pos = iter_list[i][0];
+				r.pwd_len = pwd_len_list[p];
+				r.batch_size = batch_list[b];
+				r.md5_per_record = md5_per_record(&desp, r.pwd_len);
+
+				//! 2.1 单线程逐阶段计时，线程数不同的各行共用
+				double stage_seconds[BENCH_STAGE_NUM] = {0}, best[BENCH_STAGE_NUM] = {0};
+				std::streambuf *cout_buffer = std::cout.rdbuf(&null_buffer);
+				for (int k = 0; k < repeat && ret == 0; ++k)
+				{
+					ret = run_stages(&desp, pwd_path.c_str(), cipher_path.c_str(), r.batch_size, stage_seconds);
+					for (int s = 0; s < BENCH_STAGE_NUM && ret == 0; ++s)
+						best[s] = (k == 0 || stage_seconds[s] < best[s]) ? stage_seconds[s] : best[s];
+				}
+				std::cout.rdbuf(cout_buffer);
+				if (ret != 0)
+				{
+					printf("error: stage run of %s failed!\n", r.alg_name.c_str());
+					break;
+				}
+				for (int s = 0; s < BENCH_STAGE_NUM; ++s)
+					r.stage_ns[s] = best[s] * 1e9 / record_num;
+				r.ns_per_md5 = r.md5_per_record > 0 ? best[2] * 1e9 / (r.md5_per_record * record_num) : 0;
+
+				//! 2.2 各线程数下的流水线端到端吞吐量
+				for (size_t t = 0; t < thread_list.size() && ret == 0; ++t)
+				{
+					r.thread_num = thread_list[t];
+					r.seconds = 0;
+					cout_buffer = std::cout.rdbuf(&null_buffer);
+					for (int k = 0; k < repeat && ret == 0; ++k)
+					{
+						double seconds = 0;
+						ret = run_end_to_end(&desp, pwd_path.c_str(), cipher_path.c_str(), r.thread_num, r.batch_size, seconds);
+						if (ret == 0 && (k == 0 || seconds < r.seconds))
+							r.seconds = seconds;
+					}
+					std::cout.rdbuf(cout_buffer);
+					if (ret != 0)
+					{
+						printf("error: pipeline run of %s failed!\n", r.alg_name.c_str());
+						break;
+					}
+					r.hashes_per_s = r.seconds > 0 ? record_num / r.seconds : 0;
+					print_result(r);
+					results.push_back(r);
+				}
+			}
+		}
+	}
+	unlink(pwd_path.c_str());
+	unlink(cipher_path.c_str());
+
+	//! 3. 输出JSON结果
+	if (ret == 0 && json_path != NULL && write_json(json_path, record_num, results) != 0)
+	{
+		printf("error: write %s failed!\n", json_path);
+		ret = -1;
+	}
+	return ret;
+}
@@ -5,20 +5,52 @@
  */
 #include "include/bytevector.h"
 #include "include/common.h"
+#include "include/rng.h"
 #include <string.h>
 #include <stdlib.h>
 #include <time.h>
+#include <utility>
 
-//! 默认构造函数
+//! 默认构造函数，cap不超过DEFAULT_CAPACITY时使用内联缓冲区
 ByteVector::ByteVector(int cap, int sz)
-    : byte_capacity(cap), byte_size(sz)
+    : byte_p(inline_buf), byte_capacity(DEFAULT_CAPACITY), byte_size(sz)
 {
-    this->byte_p = new Byte[byte_capacity];
+	if (cap > DEFAULT_CAPACITY)
+	{
+		byte_p = new Byte[cap];
+		byte_capacity = cap;
+	}
+}
+//! 从len字节的数组构造
+ByteVector::ByteVector(const Byte *p, int len)
+    : byte_p(inline_buf), byte_capacity(DEFAULT_CAPACITY), byte_size(0)
+{
+	assign(p, len);
+}
+//! 拷贝构造函数
+ByteVector::ByteVector(const ByteVector &rhs)
+    : byte_p(inline_buf), byte_capacity(DEFAULT_CAPACITY), byte_size(0)
+{
+	assign(rhs.byte_p, rhs.byte_size);
+}
+//! 移动构造函数，rhs在堆上时接管它的内存，rhs变为空的内联对象
+ByteVector::ByteVector(ByteVector &&rhs)
+    : byte_p(inline_buf), byte_capacity(DEFAULT_CAPACITY), byte_size(0)
+{
+	*this = std::move(rhs);
 }
 //! 析构函数
 ByteVector::~ByteVector()
 {
-	delete[] byte_p;
+	release();
+}
+//! 释放堆内存，回到内联缓冲区
+void ByteVector::release()
+{
+	if (byte_p != inline_buf)
+		delete[] byte_p;
+	byte_p = inline_buf;
+	byte_capacity = DEFAULT_CAPACITY;
 }
 
 /**
@@ -41,130 +73,117 @@ Byte& ByteVector::operator[] (int index) const
 {
     return this->byte_p[index];
 }
-//! 重载关系运算符==，双目运算符一般重载为友元函数
+//! 重载关系运算符==，按内容比较，双目运算符一般重载为友元函数
 bool operator== (const ByteVector &lhs, const ByteVector &rhs)
 {
-	/*if (strcmp((char *)this->byte_p, (char*)rhs->getByte_p()) == 0)
-		return true;*/   //‘\0' will stop cmp
-	if (&lhs == &rhs && lhs.size() == rhs.size() && lhs.capacity() == rhs.capacity())
-	{
-		for (int i = 0; i < lhs.size(); ++i)
-		{
-			if (lhs[i] != rhs[i])
-				return false;
-		}
-		return true;
-	}
-	else
+	if (lhs.size() != rhs.size())
 		return false;
+	return lhs.size() == 0 || memcmp(lhs.getByte_p(), rhs.getByte_p(), lhs.size()) == 0;
 }
 //! 重载关系运算符!=，应该成对实现
 bool operator!= (const ByteVector &lhs, const ByteVector &rhs)
 {
-	if (rhs == rhs)
-		return false;
-	return true;
+	return !(lhs == rhs);
 }
-//! 重载拷贝赋值运算符
+//! 重载拷贝赋值运算符，容量足够时不重新分配
 ByteVector& ByteVector::operator= (const ByteVector &rhs)
 {
-	if (*this == rhs)    //avoid copying itself, call operator==()
+	if (this != &rhs)    //avoid copying itself
+		assign(rhs.byte_p, rhs.byte_size);
+	return *this;
+}
+//! 重载移动赋值运算符，rhs在堆上时直接接管，在内联缓冲区时复制内容
+ByteVector& ByteVector::operator= (ByteVector &&rhs)
+{
+	if (this == &rhs)
 		return *this;
-	delete[] byte_p;    //free old array space
-	this->byte_size = rhs.size();
-	this->byte_capacity = rhs.capacity();
-	this->byte_p = new Byte[this->byte_size];    //allocate new array space
-	for (int i = 0; i < this->byte_size; ++i)    //copy element of rhs to new array
-		this->byte_p[i] = rhs[i];
+	if (rhs.byte_p != rhs.inline_buf)
+	{
+		release();
+		byte_p = rhs.byte_p;
+		byte_capacity = rhs.byte_capacity;
+		byte_size = rhs.byte_size;
+		rhs.byte_p = rhs.inline_buf;
+		rhs.byte_capacity = DEFAULT_CAPACITY;
+	}
+	else
+		assign(rhs.byte_p, rhs.byte_size);
+	rhs.byte_size = 0;
 	return *this;
-
+}
+//! 把内容替换为len字节的数组
+void ByteVector::assign(const Byte *p, int len)
+{
+	byte_size = 0;
+	reserve(len);
+	if (len > 0)
+		memcpy(byte_p, p, len);
+	byte_size = len;
+}
+//! 在末尾追加len字节的数组，容量按2倍增长
+void ByteVector::append(const Byte *p, int len)
+{
+	if (byte_size + len > byte_capacity)
+		reserve(2 * (byte_size + len));
+	if (len > 0)
+		memcpy(byte_p + byte_size, p, len);
+	byte_size += len;
 }
 //! 重载+运算符，双目运算符应为友元函数
 ByteVector operator+ (const ByteVector &lhs, const ByteVector &rhs)
 {
-	ByteVector result;
-	
-	int llength = lhs.size();
-	int rlength = rhs.size();
-	
-	if (llength + rlength > result.capacity())
-		result.reserve(2 * (llength + rlength));
-	
-	int i, j;
-	for (i = 0; i < llength; ++i)    //not using strcpy(), avoid '\0'
-		result[i] = lhs[i];
-	for (j = 0; j < rlength; ++j)
-		result[i++] = rhs[j];
-	
-	result.resize(llength + rlength);
-	
+	ByteVector result(lhs.size() + rhs.size());
+	result.append(lhs.getByte_p(), lhs.size());
+	result.append(rhs.getByte_p(), rhs.size());
 	return result;
 }
 //! 重载+=运算符
 ByteVector& ByteVector::operator+= (const Byte &rhs)
 {
-	int length = this->byte_size;
-	if (length + 1 < this->byte_capacity)
-	{
-		byte_p[length++] = rhs;
-		resize(length);
-	}
-	else
-	{
-		reserve(2 * length);
-		byte_p[length++] = rhs;
-		resize(length);
-	}
+	append(&rhs, 1);
 	return *this;
 }
 
-//! 改变容器ByteVector的size大小
+//! 改变容器ByteVector的size大小，超过容量时先扩大容量
 void ByteVector::resize(int newSize)
 { 
-	if (newSize < byte_size)
-		return;
-	else
-		byte_size = newSize; 
+	if (newSize > byte_capacity)
+		reserve(newSize);
+	byte_size = newSize; 
 }
 
-//! 给容器ByteVector重新分配内存空间
+//! 给容器ByteVector重新分配内存空间，只增不减，已有的内容保持不变
 void ByteVector::reserve(int newCapacity)
 { 
-	if (newCapacity < byte_size)
+	if (newCapacity <= byte_capacity)
 		return;
-	else
-	{
-	    uint8_t *temp = byte_p;    //copy old array to temporary array
-		byte_p = new Byte[newCapacity];    //allocate a bigger new array
-		for (int i = 0; i < byte_size; ++i)    //copy old data to new array, but byte_size is not changed!
-			byte_p[i] = temp[i];
-		
-		byte_capacity = newCapacity;
-		delete[] temp;    //free the old array
-	}
+	Byte *temp = new Byte[newCapacity];    //allocate a bigger new array
+	if (byte_size > 0)
+		memcpy(temp, byte_p, byte_size);    //copy old data to new array, but byte_size is not changed!
+	if (byte_p != inline_buf)
+		delete[] byte_p;    //free the old array
+	byte_p = temp;
+	byte_capacity = newCapacity;
 }
 //! 实现ByteVector到char数组的转换
-void BV2chararray(char *hash, const ByteVector &bv)
+void BV2chararray(char *hash, const ByteView &bv)
 {
 	for (int i = 0; i < bv.size(); ++ i)
 		hash[i] = bv[i];
 }
 
 //! 实现ByteVector到string的base64编码的转换
-std::string BV2string_base64(const ByteVector &bv)
+std::string BV2string_base64(const ByteView &bv)
 {
-	unsigned char base64Code[22];
-	char *hash = new char[bv.size()];
-	
-	BV2chararray(hash, bv);
-	
-	encode64((unsigned char *)hash , bv.size(), base64Code);    //hash.size() == 16
-	
-	std::string str = std::string((char *)base64Code, 22);
+	//! 直接对视图中的字节编码，base64密文长度为(size * 4 + 2) / 3，hash.size() == 16时为22
+	if (bv.isEmpty())
+		return std::string();
+	std::string str((bv.size() * 4 + 2) / 3, '\0');
+	encode64(bv.getByte_p(), bv.size(), (unsigned char *)&str[0]);
 	return str;
 }
 //! 实现ByteVector到string的ASCII编码的转换
-std::string BV2string_raw(const ByteVector &bv)
+std::string BV2string_raw(const ByteView &bv)
 {
 	std::string str((char *)bv.getByte_p(), bv.size());
 	return str;
@@ -172,25 +191,23 @@ std::string BV2string_raw(const ByteVector &bv)
 //! 实现从ASCII可见字符串到ByteVector的转换
 ByteVector string2BV_raw(const std::string &s)
 {
-	ByteVector bv;
-    for (int i = 0; i < s.size(); ++i)
-	{
-		Byte b = s[i];
-		bv += b;
-	}
-	return bv;
+	return ByteVector((const Byte *)s.data(), s.size());
+}
+//! 实现从长度为len的字符数组到ByteVector的转换，不超过DEFAULT_CAPACITY字节时不分配内存
+ByteVector chararray2BV_raw(const char *s, int len)
+{
+	return ByteVector((const Byte *)s, len);
 }
 //! 实现从ASCII的字符串到UCS-2的ByteVector的转化
 ByteVector string2BV_UCS2(const std::string &s)
 {
-	ByteVector bv;
+	ByteVector bv(2 * s.size());
 	Byte b = 0x00;
 	for (int i = 0; i < s.size(); ++i)
 	{	
 		bv += b;
 		bv += s[i];
 	}
-	for (int i = 0; i < 2 * s.size(); ++i)
 	return bv;
 }
 /**
@@ -200,15 +217,26 @@ ByteVector string2BV_UCS2(const std::string &s)
  *@param charset_size 盐字符集数组的大小
  */
 ByteVector set_random_charset(int bits, char *charset, int charset_size)
+{
+	return set_random_charset(bits, charset, charset_size, rng_thread_state());
+}
+/**
+ *@brief 按照位数和字符集，用指定的随机数产生器获取一个随机位数的盐
+ * 字符按拒绝采样无偏选取，字符集大小不必是2的幂
+ *@param bits 盐的位数
+ *@param charset 盐的字符集数组
+ *@param charset_size 盐字符集数组的大小
+ *@param rng 随机数产生器
+ */
+ByteVector set_random_charset(int bits, char *charset, int charset_size, struct rng_state *rng)
 {
 	ByteVector bv;
+	if (charset_size <= 0 || charset_size > 256)
+		return bv;
 	
-	for (int i = 0; i < bits/8; ++i)
-	{
-		int rand_num = rand() & charset_size - 1;
-		Byte b = charset[rand_num];
-		bv += b;
-	}
+	int len = bits / 8;
+	bv.resize(len);
+	rng_fill_charset(rng, bv.getByte_p(), len, charset, charset_size);
 	
 	return bv;
 }
@@ -219,7 +247,6 @@ ByteVector MD5(const ByteVector &pwd)
 	unsigned char hash[16];
 	memset(hash, '\0', 16);
 	md5(hash, BV2string_raw(pwd));
-	for (int i = 0; i < 16; ++i)
-		result += hash[i];
+	result.assign(hash, 16);
 	return result;
 }
\ No newline at end of file
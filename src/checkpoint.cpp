@@ -0,0 +1,70 @@
+/**
+ *@file checkpoint.cpp
+ *@brief 长时间运行任务的检查点实现文件
+ *
+ * 检查点是文本文件，第一行为CHECKPOINT_MAGIC，之后每行一个"名称=值"
+ *@version 0.1
+ */
+#include "include/checkpoint.h"
+#include "include/state_file.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+//! 写检查点的各行
+static int write_checkpoint_fields(FILE *fp, const void *arg)
+{
+	const struct checkpoint *ckpt = (const struct checkpoint *)arg;
+	fprintf(fp, "%s\nmode=%s\nalg_name=%s\ninput_size=%lld\ninput_offset=%lld\nrecords=%lld\noutput_bytes=%lld\nfound=%lld\n",
+		CHECKPOINT_MAGIC, ckpt->mode.c_str(), ckpt->alg_name.c_str(), ckpt->input_size, ckpt->input_offset,
+		ckpt->records, ckpt->output_bytes, ckpt->found);
+	return 0;
+}
+
+/**
+ *@brief 写检查点，先写path.tmp并fsync，再rename为path
+ *@param path 检查点文件路径
+ *@param ckpt 检查点
+ *@return 0：正确，-1：出错
+ */
+int save_checkpoint(const char *path, const struct checkpoint *ckpt)
+{
+	return write_file_atomic(path, write_checkpoint_fields, ckpt, 1);
+}
+
+//! 读取检查点的一个字段
+static int read_checkpoint_field(const char *name, const char *value, void *arg)
+{
+	struct checkpoint *ckpt = (struct checkpoint *)arg;
+	std::string field = name;
+	if (field == "mode")
+		ckpt->mode = value;
+	else if (field == "alg_name")
+		ckpt->alg_name = value;
+	else if (field == "input_size")
+		ckpt->input_size = atoll(value);
+	else if (field == "input_offset")
+		ckpt->input_offset = atoll(value);
+	else if (field == "records")
+		ckpt->records = atoll(value);
+	else if (field == "output_bytes")
+		ckpt->output_bytes = atoll(value);
+	else if (field == "found")
+		ckpt->found = atoll(value);
+	else
+		return 0;
+	return 1;
+}
+
+/**
+ *@brief 读取检查点，缺少任何一项都认为检查点无效
+ *@param path 检查点文件路径
+ *@param ckpt 输出检查点
+ *@return 0：正确，-1：文件不存在或格式错误
+ */
+int load_checkpoint(const char *path, struct checkpoint *ckpt)
+{
+	if (read_state_file(path, CHECKPOINT_MAGIC, read_checkpoint_field, ckpt) != 7 || ckpt->input_offset < 0
+		|| ckpt->input_offset > ckpt->input_size || ckpt->records < 0 || ckpt->output_bytes < 0)
+		return -1;
+	return 0;
+}
@@ -0,0 +1,321 @@
+/**
+ *@file cipher_writer.cpp
+ *@brief 大块缓冲的密文文件写入实现文件
+ *@version 0.1
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE    //O_DIRECT
+#endif
+#include "include/cipher_writer.h"
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+
+CipherWriter::CipherWriter()
+	: fd(-1), writer_flags(0), pipe_closed(false), buffer(NULL), buffer_size(0), used(0), total_bytes(0), start_offset(0), io_time(0)
+{
+}
+
+CipherWriter::~CipherWriter()
+{
+	close();
+}
+
+/**
+ *@brief 以截断方式打开密文文件
+ *@param path 密文文件路径，"-"表示标准输出，不能与WRITER_DIRECT、WRITER_APPEND同时使用
+ *@param flags WRITER_DIRECT：O_DIRECT写入，WRITER_FSYNC：关闭前fsync，WRITER_APPEND：不截断，从文件末尾继续写
+ *@param buffer_size 写缓冲区大小，向上取整为WRITE_ALIGN的倍数
+ *@return 0：正确，-1：出错
+ */
+int CipherWriter::open(const char *path, int flags, size_t buffer_size)
+{
+	close();
+	writer_flags = flags;
+	this->buffer_size = (buffer_size + WRITE_ALIGN - 1) / WRITE_ALIGN * WRITE_ALIGN;
+	used = 0;
+	total_bytes = 0;
+	start_offset = 0;
+	io_time = 0;
+	pipe_closed = false;
+
+	//! 1. 打开文件，文件系统不支持O_DIRECT时退回到普通写入
+	int open_flags = O_CREAT | ((writer_flags & WRITER_APPEND) ? O_RDWR : O_WRONLY | O_TRUNC);    //追加时可能要读回尾部
+	if (strcmp(path, "-") == 0)
+	{
+		if (writer_flags & (WRITER_DIRECT | WRITER_APPEND))
+			return -1;
+		fd = dup(STDOUT_FILENO);
+	}
+	else if (writer_flags & WRITER_DIRECT)
+	{
+		fd = ::open(path, open_flags | O_DIRECT, 0644);
+		if (fd < 0 && errno == EINVAL)
+		{
+			std::cout << "warning: O_DIRECT is not supported for " << path << ", use buffered write" << std::endl;
+			writer_flags &= ~WRITER_DIRECT;
+		}
+	}
+	if (fd < 0 && strcmp(path, "-") != 0)
+		fd = ::open(path, open_flags, 0644);
+	if (fd < 0)
+		return -1;
+
+	//! 2. 分配对齐的写缓冲区
+	void *p = NULL;
+	if (posix_memalign(&p, WRITE_ALIGN, this->buffer_size) != 0)
+	{
+		::close(fd);
+		fd = -1;
+		return -1;
+	}
+	buffer = (char *)p;
+
+	//! 3. 追加时定位到文件末尾；O_DIRECT要求写入偏移对齐，把最后不足WRITE_ALIGN的部分读回缓冲区，从对齐的偏移开始写
+	if (writer_flags & WRITER_APPEND)
+	{
+		off_t end = lseek(fd, 0, SEEK_END);
+		size_t tail = (writer_flags & WRITER_DIRECT) ? end % WRITE_ALIGN : 0;
+		ssize_t n = 0;
+		if (end >= 0 && tail > 0)
+		{
+			int fl = fcntl(fd, F_GETFL);
+			fcntl(fd, F_SETFL, fl & ~O_DIRECT);
+			n = pread(fd, buffer, tail, end - tail);
+			fcntl(fd, F_SETFL, fl);
+		}
+		if (end < 0 || n != (ssize_t)tail || lseek(fd, end - tail, SEEK_SET) < 0)
+		{
+			close();
+			return -1;
+		}
+		used = tail;
+		start_offset = end - tail;
+		total_bytes = 0;
+	}
+	gettimeofday(&start_time, NULL);
+	end_time = start_time;
+	return 0;
+}
+
+//! 累加从begin到现在的系统调用时间
+void CipherWriter::add_io_time(const struct timeval &begin)
+{
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	io_time += (now.tv_sec - begin.tv_sec) + (now.tv_usec - begin.tv_usec) / 1e6;
+}
+
+/**
+ *@brief 把len字节全部写入文件，处理部分写入和EINTR
+ */
+int CipherWriter::write_all(const char *data, size_t len)
+{
+	struct timeval begin;
+	gettimeofday(&begin, NULL);
+	while (len > 0)
+	{
+		ssize_t n = ::write(fd, data, len);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			pipe_closed = (errno == EPIPE);
+			add_io_time(begin);
+			return -1;
+		}
+		data += n;
+		len -= n;
+		total_bytes += n;
+	}
+	add_io_time(begin);
+	return 0;
+}
+
+/**
+ *@brief 追加len字节
+ * 数据能放进缓冲区时只做复制；放不下时，普通写入用一次writev把缓冲区和新数据一起写出，
+ * O_DIRECT写入只写出对齐的整块缓冲区
+ *@return 0：正确，-1：出错
+ */
+int CipherWriter::write(const char *data, size_t len)
+{
+	if (fd < 0)
+		return -1;
+	if (used + len <= buffer_size)
+	{
+		memcpy(buffer + used, data, len);
+		used += len;
+		return 0;
+	}
+
+	if (!(writer_flags & WRITER_DIRECT))
+	{
+		struct iovec iov[2];
+		iov[0].iov_base = buffer;
+		iov[0].iov_len = used;
+		iov[1].iov_base = (void *)data;
+		iov[1].iov_len = len;
+		ssize_t n;
+		struct timeval begin;
+		gettimeofday(&begin, NULL);
+		do {
+			n = writev(fd, iov, 2);
+		} while (n < 0 && errno == EINTR);
+		add_io_time(begin);
+		if (n < 0)
+		{
+			pipe_closed = (errno == EPIPE);
+			return -1;
+		}
+		total_bytes += n;
+		//writev只写出了一部分时，把剩余部分补写完
+		size_t left = n;
+		if (left < used)
+		{
+			if (write_all(buffer + left, used - left) != 0)
+				return -1;
+			left = used;
+		}
+		left -= used;
+		used = 0;
+		return write_all(data + left, len - left);
+	}
+
+	while (len > 0)
+	{
+		size_t n = buffer_size - used < len ? buffer_size - used : len;
+		memcpy(buffer + used, data, n);
+		used += n;
+		data += n;
+		len -= n;
+		if (used == buffer_size)
+		{
+			if (write_all(buffer, used) != 0)
+				return -1;
+			used = 0;
+		}
+	}
+	return 0;
+}
+
+/**
+ *@brief 写出缓冲区中所有数据
+ * O_DIRECT写入时，不足WRITE_ALIGN的尾部先关闭O_DIRECT再写出
+ *@return 0：正确，-1：出错
+ */
+int CipherWriter::flush()
+{
+	if (fd < 0 || used == 0)
+		return 0;
+	if (writer_flags & WRITER_DIRECT)
+	{
+		size_t aligned = used / WRITE_ALIGN * WRITE_ALIGN;
+		if (write_all(buffer, aligned) != 0)
+			return -1;
+		if (aligned < used)
+		{
+			fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT);
+			writer_flags &= ~WRITER_DIRECT;
+			if (write_all(buffer + aligned, used - aligned) != 0)
+				return -1;
+		}
+		used = 0;
+		return 0;
+	}
+	if (write_all(buffer, used) != 0)
+		return -1;
+	used = 0;
+	return 0;
+}
+
+/**
+ *@brief 写出缓冲区中所有数据并fdatasync，用于写检查点之前
+ * O_DIRECT写入时，对齐的整块仍然用O_DIRECT写出；不足WRITE_ALIGN的尾部临时关闭O_DIRECT用pwrite写到同一位置，
+ * 并留在缓冲区中，下次写出整块时覆盖，之后的写入仍然是O_DIRECT
+ *@return 0：正确，-1：出错
+ */
+int CipherWriter::sync()
+{
+	if (fd < 0)
+		return -1;
+	if (!(writer_flags & WRITER_DIRECT))
+	{
+		if (flush() != 0)
+			return -1;
+	}
+	else
+	{
+		size_t aligned = used / WRITE_ALIGN * WRITE_ALIGN;
+		if (write_all(buffer, aligned) != 0)
+			return -1;
+		memmove(buffer, buffer + aligned, used - aligned);
+		used -= aligned;
+		if (used > 0)
+		{
+			struct timeval begin;
+			gettimeofday(&begin, NULL);
+			off_t pos = lseek(fd, 0, SEEK_CUR);
+			int fl = fcntl(fd, F_GETFL);
+			fcntl(fd, F_SETFL, fl & ~O_DIRECT);
+			size_t done = 0;
+			while (pos >= 0 && done < used)
+			{
+				ssize_t n = pwrite(fd, buffer + done, used - done, pos + done);
+				if (n < 0 && errno == EINTR)
+					continue;
+				if (n <= 0)
+					break;
+				done += n;
+			}
+			fcntl(fd, F_SETFL, fl);
+			add_io_time(begin);
+			if (done < used)
+				return -1;
+		}
+	}
+	struct timeval begin;
+	gettimeofday(&begin, NULL);
+	int ret = fdatasync(fd);
+	add_io_time(begin);
+	return ret == 0 ? 0 : -1;
+}
+
+/**
+ *@brief 写出剩余数据，按策略fsync后关闭文件
+ *@return 0：正确，-1：出错
+ */
+int CipherWriter::close()
+{
+	if (fd < 0)
+		return 0;
+	int ret = flush();
+	if (ret == 0 && (writer_flags & WRITER_FSYNC))
+	{
+		struct timeval begin;
+		gettimeofday(&begin, NULL);
+		if (fsync(fd) != 0)
+			ret = -1;
+		add_io_time(begin);
+	}
+	if (::close(fd) != 0)
+		ret = -1;
+	fd = -1;
+	free(buffer);
+	buffer = NULL;
+	gettimeofday(&end_time, NULL);
+	return ret;
+}
+
+//! 从打开到现在(或到关闭)的秒数
+double CipherWriter::seconds() const
+{
+	struct timeval now = end_time;
+	if (fd >= 0)
+		gettimeofday(&now, NULL);
+	return (now.tv_sec - start_time.tv_sec) + (now.tv_usec - start_time.tv_usec) / 1e6;
+}
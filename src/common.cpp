@@ -1,50 +1,443 @@
-/**
- *@file common.cpp
- *@brief 供各种算法使用的通用基础函数
- *@version 0.1
- */
-#include "include/common.h"
-#include <stdint.h>
-#include <openssl/md5.h>
-
-//! wordpress算法base64加密算法的字符集
-unsigned char base64Char2[]= "./0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
-
-/**
- *@brief base64加密算法实现
- *@param hash 要加密的hash值
- *@param count hash值的字节数
- *@param base64Code base64加密后的base64密文
- */
-void encode64(const unsigned char *hash, int count, unsigned char *base64Code)
-{
-	uint32_t value;
-	int i = 0, j = 0;
-	do {
-		value = hash[i++];
-		base64Code[j++] = base64Char2[value & 0x3f];
-		if (i < count)
-			value |= hash[i] << 8;
-		base64Code[j++] = base64Char2[(value >> 6) & 0x3f];
-		if (i++ >= count)
-			break;
-		if (i < count)
-			value |= hash[i] << 16;
-		base64Code[j++] = base64Char2[(value >> 12) & 0x3f];
-		if (i++ >= count)
-			break;
-		base64Code[j++] = base64Char2[(value >> 18) & 0x3f];
-	} while (i < count);
-}
-/**
- *@brief md5加密算法实现
- *@param hash 存储md5哈希值的16字节数组
- *@param pwd 需要加密的口令
- */
-void md5(unsigned char*hash, const std::string &pwd)
-{
-	MD5_CTX ctx;
-	MD5_Init(&ctx);
-	MD5_Update(&ctx, pwd.c_str(), pwd.size());
-	MD5_Final(hash, &ctx);
+/**
+ *@file common.cpp
+ *@brief 供各种算法使用的通用基础函数
+ *@version 0.1
+ */
+#include "include/common.h"
+#include <stdint.h>
+#include <openssl/md5.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+//! wordpress算法base64加密算法的字符集
+unsigned char base64Char2[]= "./0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+
+/**
+ *@brief base64加密算法实现
+ *@param hash 要加密的hash值
+ *@param count hash值的字节数
+ *@param base64Code base64加密后的base64密文
+ */
+void encode64(const unsigned char *hash, int count, unsigned char *base64Code)
+{
+	uint32_t value;
+	int i = 0, j = 0;
+	do {
+		value = hash[i++];
+		base64Code[j++] = base64Char2[value & 0x3f];
+		if (i < count)
+			value |= hash[i] << 8;
+		base64Code[j++] = base64Char2[(value >> 6) & 0x3f];
+		if (i++ >= count)
+			break;
+		if (i < count)
+			value |= hash[i] << 16;
+		base64Code[j++] = base64Char2[(value >> 12) & 0x3f];
+		if (i++ >= count)
+			break;
+		base64Code[j++] = base64Char2[(value >> 18) & 0x3f];
+	} while (i < count);
+}
+/**
+ *@brief 把16字节的MD5摘要编码为22个base64字符，结果与encode64(hash, 16, base64Code)相同
+ * 每3个字节拼成一个32位通道中的24位数值，SSE2一次把4个通道各拆成4个6位数值(每字节一个)，
+ * 再按所在段加上偏移映射到base64Char2，没有SSE2时使用encode64
+ *@param hash 16字节的MD5摘要
+ *@param base64Code 存储22个base64字符，不以'\0'结尾
+ */
+void encode64_md5(const unsigned char *hash, unsigned char *base64Code)
+{
+#ifdef __SSE2__
+	//! 1. 前15个字节每3个一组，最后1个字节单独一组，放在6个32位通道的低24位
+	uint32_t t[8];
+	for (int m = 0; m < 5; ++m)
+		t[m] = hash[3 * m] | (hash[3 * m + 1] << 8) | (hash[3 * m + 2] << 16);
+	t[5] = hash[15];
+	t[6] = 0;
+	t[7] = 0;
+	unsigned char buf[32];
+	for (int k = 0; k < 2; ++k)
+	{
+		//! 2. 通道中的第j个6位数值移到第j个字节：v & 0x3f | (v << 2) & 0x3f00 | (v << 4) & 0x3f0000 | (v << 6) & 0x3f000000
+		__m128i v = _mm_loadu_si128((const __m128i *)(t + 4 * k));
+		__m128i c = _mm_or_si128(
+			_mm_or_si128(_mm_and_si128(v, _mm_set1_epi32(0x3f)), _mm_and_si128(_mm_slli_epi32(v, 2), _mm_set1_epi32(0x3f00))),
+			_mm_or_si128(_mm_and_si128(_mm_slli_epi32(v, 4), _mm_set1_epi32(0x3f0000)), _mm_and_si128(_mm_slli_epi32(v, 6), _mm_set1_epi32(0x3f000000))));
+		//! 3. 0-11映射到'.'-'9'，12-37映射到'A'-'Z'，38-63映射到'a'-'z'
+		__m128i offset = _mm_add_epi8(_mm_set1_epi8('.'),
+			_mm_add_epi8(_mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8(11)), _mm_set1_epi8('A' - 12 - '.')),
+				_mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8(37)), _mm_set1_epi8('a' - 38 - ('A' - 12)))));
+		_mm_storeu_si128((__m128i *)(buf + 16 * k), _mm_add_epi8(c, offset));
+	}
+	//! 4. 前5组各4个字符，最后1个字节只有2个字符
+	memcpy(base64Code, buf, 22);
+#else
+	encode64(hash, MD5_DIGEST_SIZE, base64Code);
+#endif
+}
+/**
+ *@brief base64解码，encode64的逆过程
+ *@param base64Code base64密文
+ *@param count 解码后的字节数，base64密文长度为(count * 4 + 2) / 3
+ *@param hash 存储解码后的字节
+ *@return 0：正确，-1：密文中有不属于base64Char2的字符
+ */
+int decode64(const unsigned char *base64Code, int count, unsigned char *hash)
+{
+	//! 1. 第一次调用时建立字符到6位数值的反查表，非法字符为0xff，局部静态对象的初始化是线程安全的
+	static const struct decode64_table {
+		unsigned char v[256];
+		decode64_table()
+		{
+			memset(v, 0xff, sizeof(v));
+			for (int k = 0; k < 64; ++k)
+				v[base64Char2[k]] = k;
+		}
+	} table;
+	const unsigned char *index = table.v;
+	//! 2. 每4个字符还原3个字节，最后不足3个字节时只取2或3个字符
+	int i = 0, j = 0;
+	while (i < count)
+	{
+		int chars = count - i >= 3 ? 4 : count - i + 1;
+		uint32_t value = 0;
+		for (int k = 0; k < chars; ++k)
+		{
+			unsigned char v = index[base64Code[j++]];
+			if (v == 0xff)
+				return -1;
+			value |= (uint32_t)v << (6 * k);
+		}
+		for (int k = 0; k < chars - 1; ++k)
+			hash[i++] = (value >> (8 * k)) & 0xff;
+	}
+	return 0;
+}
+/**
+ *@brief 把22个base64字符解码为16字节的MD5摘要，用于大量加载密文
+ * SSE2一次把16个字符查表转换为6位数值并检查合法性，再用两次乘加把6位数值拼成24位，
+ * 没有SSE2时使用decode64
+ *@param base64Code 22个字符的base64密文
+ *@param hash 存储解码后的16字节
+ *@return 0：正确，-1：密文中有不属于base64Char2的字符
+ */
+int decode64_md5(const unsigned char *base64Code, unsigned char *hash)
+{
+#ifdef __SSE2__
+	//! 1. 复制到32字节的缓冲区，后10个字节用解码为0的'.'填充
+	unsigned char buf[32];
+	memcpy(buf, base64Code, 22);
+	memset(buf + 22, '.', 10);
+	__m128i chars[2] = {_mm_loadu_si128((const __m128i *)buf), _mm_loadu_si128((const __m128i *)(buf + 16))};
+	__m128i packed[2];
+	for (int k = 0; k < 2; ++k)
+	{
+		//! 2. base64Char2由'.'-'9'、'A'-'Z'、'a'-'z'三段连续字符组成，按所在段减去对应的偏移
+		__m128i c = chars[k];
+		__m128i r1 = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('.' - 1)), _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1)));
+		__m128i r2 = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('A' - 1)), _mm_cmplt_epi8(c, _mm_set1_epi8('Z' + 1)));
+		__m128i r3 = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(c, _mm_set1_epi8('z' + 1)));
+		if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(r1, r2), r3)) != 0xffff)
+			return -1;
+		__m128i offset = _mm_or_si128(_mm_or_si128(_mm_and_si128(r1, _mm_set1_epi8('.')),
+			_mm_and_si128(r2, _mm_set1_epi8('A' - 12))), _mm_and_si128(r3, _mm_set1_epi8('a' - 38)));
+		__m128i v = _mm_sub_epi8(c, offset);
+		//! 3. 相邻两个6位数值拼成12位，再把相邻两个12位数值拼成24位(3个字节)
+		__m128i zero = _mm_setzero_si128();
+		__m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(v, zero), _mm_set1_epi32(0x00400001));
+		__m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(v, zero), _mm_set1_epi32(0x00400001));
+		packed[k] = _mm_madd_epi16(_mm_packs_epi32(lo, hi), _mm_set1_epi32(0x10000001));
+	}
+	//! 4. 每个32位通道的低3个字节依次输出，共16个字节
+	uint32_t t[8];
+	_mm_storeu_si128((__m128i *)t, packed[0]);
+	_mm_storeu_si128((__m128i *)(t + 4), packed[1]);
+	for (int m = 0; m < 5; ++m)
+	{
+		hash[3 * m] = t[m] & 0xff;
+		hash[3 * m + 1] = (t[m] >> 8) & 0xff;
+		hash[3 * m + 2] = (t[m] >> 16) & 0xff;
+	}
+	hash[15] = t[5] & 0xff;
+	return 0;
+#else
+	return decode64(base64Code, MD5_DIGEST_SIZE, hash);
+#endif
+}
+/**
+ *@brief md5加密算法实现
+ *@param hash 存储md5哈希值的16字节数组
+ *@param pwd 需要加密的口令
+ */
+void md5(unsigned char*hash, const std::string &pwd)
+{
+	MD5_CTX ctx;
+	MD5_Init(&ctx);
+	MD5_Update(&ctx, pwd.c_str(), pwd.size());
+	MD5_Final(hash, &ctx);
+}
+/**
+ *@brief 按小端解码一个64字节分组并执行压缩函数
+ */
+static void md5_compress_bytes(uint32_t state[4], const unsigned char *bytes)
+{
+	uint32_t block[16];
+	for (int j = 0; j < 4; ++j)
+		md5_bytes2words(block + 4 * j, bytes + 16 * j);
+	md5_compress(state, block);
+}
+/**
+ *@brief 两段数据拼接后的md5，用于MD5(salt + pwd)等场景，避免构造临时字符串
+ * 直接使用md5_compress，不经过OpenSSL 3中已废弃的MD5_*接口
+ *@param hash 存储md5哈希值的16字节数组
+ *@param a 第一段数据
+ *@param alen 第一段数据的字节数
+ *@param b 第二段数据
+ *@param blen 第二段数据的字节数
+ */
+void md5_concat(unsigned char *hash, const unsigned char *a, int alen, const unsigned char *b, int blen)
+{
+	uint32_t state[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+	unsigned char buf[MD5_BLOCK_SIZE];
+	int used = 0;
+	//! 1. 两段数据依次填入分组，满64字节压缩一次
+	const unsigned char *part[2] = {a, b};
+	int part_len[2] = {alen, blen};
+	for (int k = 0; k < 2; ++k)
+	{
+		for (int i = 0; i < part_len[k]; )
+		{
+			int take = std::min(MD5_BLOCK_SIZE - used, part_len[k] - i);
+			memcpy(buf + used, part[k] + i, take);
+			used += take;
+			i += take;
+			if (used == MD5_BLOCK_SIZE)
+			{
+				md5_compress_bytes(state, buf);
+				used = 0;
+			}
+		}
+	}
+	//! 2. 填充0x80、若干0和64位小端的消息位数，放不下位数时多压缩一个分组
+	uint64_t bits = ((uint64_t)alen + blen) * 8;
+	buf[used++] = 0x80;
+	if (used > MD5_BLOCK_SIZE - 8)
+	{
+		memset(buf + used, 0, MD5_BLOCK_SIZE - used);
+		md5_compress_bytes(state, buf);
+		used = 0;
+	}
+	memset(buf + used, 0, MD5_BLOCK_SIZE - 8 - used);
+	for (int i = 0; i < 8; ++i)
+		buf[MD5_BLOCK_SIZE - 8 + i] = (bits >> (8 * i)) & 0xff;
+	md5_compress_bytes(state, buf);
+	md5_words2bytes(hash, state);
+}
+
+//MD5的四个基本函数及每一步的运算
+#define MD5_F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define MD5_G(x, y, z) ((y) ^ ((z) & ((x) ^ (y))))
+#define MD5_H(x, y, z) ((x) ^ (y) ^ (z))
+#define MD5_I(x, y, z) ((y) ^ ((x) | ~(z)))
+#define MD5_STEP(f, a, b, c, d, m, t, s) \
+	(a) += f((b), (c), (d)) + (m) + (t); \
+	(a) = ((a) << (s)) | ((a) >> (32 - (s))); \
+	(a) += (b);
+
+/**
+ *@brief MD5压缩函数，对一个64字节分组更新state
+ *@param state MD5的4个32位状态字
+ *@param block 按小端解码的16个32位消息字
+ */
+void md5_compress(uint32_t state[4], const uint32_t block[16])
+{
+	uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+	const uint32_t *m = block;
+
+	MD5_STEP(MD5_F, a, b, c, d, m[0], 0xd76aa478, 7)
+	MD5_STEP(MD5_F, d, a, b, c, m[1], 0xe8c7b756, 12)
+	MD5_STEP(MD5_F, c, d, a, b, m[2], 0x242070db, 17)
+	MD5_STEP(MD5_F, b, c, d, a, m[3], 0xc1bdceee, 22)
+	MD5_STEP(MD5_F, a, b, c, d, m[4], 0xf57c0faf, 7)
+	MD5_STEP(MD5_F, d, a, b, c, m[5], 0x4787c62a, 12)
+	MD5_STEP(MD5_F, c, d, a, b, m[6], 0xa8304613, 17)
+	MD5_STEP(MD5_F, b, c, d, a, m[7], 0xfd469501, 22)
+	MD5_STEP(MD5_F, a, b, c, d, m[8], 0x698098d8, 7)
+	MD5_STEP(MD5_F, d, a, b, c, m[9], 0x8b44f7af, 12)
+	MD5_STEP(MD5_F, c, d, a, b, m[10], 0xffff5bb1, 17)
+	MD5_STEP(MD5_F, b, c, d, a, m[11], 0x895cd7be, 22)
+	MD5_STEP(MD5_F, a, b, c, d, m[12], 0x6b901122, 7)
+	MD5_STEP(MD5_F, d, a, b, c, m[13], 0xfd987193, 12)
+	MD5_STEP(MD5_F, c, d, a, b, m[14], 0xa679438e, 17)
+	MD5_STEP(MD5_F, b, c, d, a, m[15], 0x49b40821, 22)
+
+	MD5_STEP(MD5_G, a, b, c, d, m[1], 0xf61e2562, 5)
+	MD5_STEP(MD5_G, d, a, b, c, m[6], 0xc040b340, 9)
+	MD5_STEP(MD5_G, c, d, a, b, m[11], 0x265e5a51, 14)
+	MD5_STEP(MD5_G, b, c, d, a, m[0], 0xe9b6c7aa, 20)
+	MD5_STEP(MD5_G, a, b, c, d, m[5], 0xd62f105d, 5)
+	MD5_STEP(MD5_G, d, a, b, c, m[10], 0x02441453, 9)
+	MD5_STEP(MD5_G, c, d, a, b, m[15], 0xd8a1e681, 14)
+	MD5_STEP(MD5_G, b, c, d, a, m[4], 0xe7d3fbc8, 20)
+	MD5_STEP(MD5_G, a, b, c, d, m[9], 0x21e1cde6, 5)
+	MD5_STEP(MD5_G, d, a, b, c, m[14], 0xc33707d6, 9)
+	MD5_STEP(MD5_G, c, d, a, b, m[3], 0xf4d50d87, 14)
+	MD5_STEP(MD5_G, b, c, d, a, m[8], 0x455a14ed, 20)
+	MD5_STEP(MD5_G, a, b, c, d, m[13], 0xa9e3e905, 5)
+	MD5_STEP(MD5_G, d, a, b, c, m[2], 0xfcefa3f8, 9)
+	MD5_STEP(MD5_G, c, d, a, b, m[7], 0x676f02d9, 14)
+	MD5_STEP(MD5_G, b, c, d, a, m[12], 0x8d2a4c8a, 20)
+
+	MD5_STEP(MD5_H, a, b, c, d, m[5], 0xfffa3942, 4)
+	MD5_STEP(MD5_H, d, a, b, c, m[8], 0x8771f681, 11)
+	MD5_STEP(MD5_H, c, d, a, b, m[11], 0x6d9d6122, 16)
+	MD5_STEP(MD5_H, b, c, d, a, m[14], 0xfde5380c, 23)
+	MD5_STEP(MD5_H, a, b, c, d, m[1], 0xa4beea44, 4)
+	MD5_STEP(MD5_H, d, a, b, c, m[4], 0x4bdecfa9, 11)
+	MD5_STEP(MD5_H, c, d, a, b, m[7], 0xf6bb4b60, 16)
+	MD5_STEP(MD5_H, b, c, d, a, m[10], 0xbebfbc70, 23)
+	MD5_STEP(MD5_H, a, b, c, d, m[13], 0x289b7ec6, 4)
+	MD5_STEP(MD5_H, d, a, b, c, m[0], 0xeaa127fa, 11)
+	MD5_STEP(MD5_H, c, d, a, b, m[3], 0xd4ef3085, 16)
+	MD5_STEP(MD5_H, b, c, d, a, m[6], 0x04881d05, 23)
+	MD5_STEP(MD5_H, a, b, c, d, m[9], 0xd9d4d039, 4)
+	MD5_STEP(MD5_H, d, a, b, c, m[12], 0xe6db99e5, 11)
+	MD5_STEP(MD5_H, c, d, a, b, m[15], 0x1fa27cf8, 16)
+	MD5_STEP(MD5_H, b, c, d, a, m[2], 0xc4ac5665, 23)
+
+	MD5_STEP(MD5_I, a, b, c, d, m[0], 0xf4292244, 6)
+	MD5_STEP(MD5_I, d, a, b, c, m[7], 0x432aff97, 10)
+	MD5_STEP(MD5_I, c, d, a, b, m[14], 0xab9423a7, 15)
+	MD5_STEP(MD5_I, b, c, d, a, m[5], 0xfc93a039, 21)
+	MD5_STEP(MD5_I, a, b, c, d, m[12], 0x655b59c3, 6)
+	MD5_STEP(MD5_I, d, a, b, c, m[3], 0x8f0ccc92, 10)
+	MD5_STEP(MD5_I, c, d, a, b, m[10], 0xffeff47d, 15)
+	MD5_STEP(MD5_I, b, c, d, a, m[1], 0x85845dd1, 21)
+	MD5_STEP(MD5_I, a, b, c, d, m[8], 0x6fa87e4f, 6)
+	MD5_STEP(MD5_I, d, a, b, c, m[15], 0xfe2ce6e0, 10)
+	MD5_STEP(MD5_I, c, d, a, b, m[6], 0xa3014314, 15)
+	MD5_STEP(MD5_I, b, c, d, a, m[13], 0x4e0811a1, 21)
+	MD5_STEP(MD5_I, a, b, c, d, m[4], 0xf7537e82, 6)
+	MD5_STEP(MD5_I, d, a, b, c, m[11], 0xbd3af235, 10)
+	MD5_STEP(MD5_I, c, d, a, b, m[2], 0x2ad7d2bb, 15)
+	MD5_STEP(MD5_I, b, c, d, a, m[9], 0xeb86d391, 21)
+
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+}
+
+//! 16字节摘要按小端转换为4个32位字
+void md5_bytes2words(uint32_t words[4], const unsigned char *bytes)
+{
+	for (int i = 0; i < 4; ++i)
+		words[i] = bytes[4*i] | (bytes[4*i+1] << 8) | (bytes[4*i+2] << 16) | ((uint32_t)bytes[4*i+3] << 24);
+}
+
+//! 4个32位字按小端转换为16字节摘要
+void md5_words2bytes(unsigned char *bytes, const uint32_t words[4])
+{
+	for (int i = 0; i < 4; ++i)
+	{
+		bytes[4*i] = words[i] & 0xff;
+		bytes[4*i+1] = (words[i] >> 8) & 0xff;
+		bytes[4*i+2] = (words[i] >> 16) & 0xff;
+		bytes[4*i+3] = (words[i] >> 24) & 0xff;
+	}
+}
+
+/**
+ *@brief 初始化MD5链式迭代引擎，构造 16字节摘要 + pwd 的填充消息
+ * 前16字节留给每轮的摘要，之后是pwd、0x80、0x00...、64位小端消息位长
+ *@param chain 迭代引擎
+ *@param pwd 口令
+ *@param pwd_len 口令字节数
+ *@return 0：正确，-1：出错
+ */
+int md5_chain_init(struct md5_chain *chain, const unsigned char *pwd, int pwd_len)
+{
+	if (pwd_len < 0)
+		return -1;
+	//! 1. 计算分组个数，消息长度+1字节0x80+8字节位长不超过nblocks*64
+	uint64_t msg_len = MD5_DIGEST_SIZE + pwd_len;
+	chain->nblocks = (msg_len + 8) / MD5_BLOCK_SIZE + 1;
+	if (chain->nblocks <= MD5_CHAIN_STACK_BLOCKS)
+		chain->words = chain->stack_words;
+	else
+		chain->words = new uint32_t[16 * chain->nblocks];
+
+	//! 2. 按字节构造填充后的消息，再按小端解码为32位字
+	int total = chain->nblocks * MD5_BLOCK_SIZE;
+	memset(chain->words, 0, total);
+	for (int i = 0; i < pwd_len; ++i)
+		chain->words[(MD5_DIGEST_SIZE + i) >> 2] |= (uint32_t)pwd[i] << (((MD5_DIGEST_SIZE + i) & 3) << 3);
+	chain->words[msg_len >> 2] |= (uint32_t)0x80 << ((msg_len & 3) << 3);
+	uint64_t bit_len = msg_len << 3;
+	chain->words[total / 4 - 2] = (uint32_t)bit_len;
+	chain->words[total / 4 - 1] = (uint32_t)(bit_len >> 32);
+
+	return 0;
+}
+
+/**
+ *@brief 执行count轮 digest = MD5(digest || pwd)
+ * 每轮只改写消息的前4个字，单分组口令(不超过39字节)走只压缩一次的快速路径
+ *@param chain 已初始化的迭代引擎
+ *@param digest 输入为初始摘要，输出为迭代后的摘要，4个小端32位字
+ *@param count 迭代轮数
+ */
+void md5_chain_iterate(struct md5_chain *chain, uint32_t digest[4], uint32_t count)
+{
+	uint32_t *words = chain->words;
+	uint32_t state[4];
+
+	if (chain->nblocks == 1)
+	{
+		while (count--)
+		{
+			words[0] = digest[0];
+			words[1] = digest[1];
+			words[2] = digest[2];
+			words[3] = digest[3];
+			state[0] = 0x67452301;
+			state[1] = 0xefcdab89;
+			state[2] = 0x98badcfe;
+			state[3] = 0x10325476;
+			md5_compress(state, words);
+			digest[0] = state[0];
+			digest[1] = state[1];
+			digest[2] = state[2];
+			digest[3] = state[3];
+		}
+		return;
+	}
+
+	while (count--)
+	{
+		words[0] = digest[0];
+		words[1] = digest[1];
+		words[2] = digest[2];
+		words[3] = digest[3];
+		state[0] = 0x67452301;
+		state[1] = 0xefcdab89;
+		state[2] = 0x98badcfe;
+		state[3] = 0x10325476;
+		for (int i = 0; i < chain->nblocks; ++i)
+			md5_compress(state, words + 16 * i);
+		digest[0] = state[0];
+		digest[1] = state[1];
+		digest[2] = state[2];
+		digest[3] = state[3];
+	}
+}
+
+//! 释放MD5链式迭代引擎在堆上分配的消息
+void md5_chain_free(struct md5_chain *chain)
+{
+	if (chain->words != chain->stack_words)
+		delete[] chain->words;
+	chain->words = NULL;
 }
\ No newline at end of file
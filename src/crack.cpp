@@ -0,0 +1,744 @@
+/**
+ *@file crack.cpp
+ *@brief 字典破解模式实现文件
+ *
+ * 密文按(密文自带的参数, 盐)分组，例如wordpress按(迭代次数标识, 盐)分组，
+ * 每个候选口令在每个不同的组下只计算一次hash值，再经过组的bloom过滤器在组内查找。
+ * 密文存放在紧凑的密文库TargetStore中，可以保存为二进制索引文件供下次直接mmap。
+ * 读取级(调用线程)按批读取字典(或由掩码按下标范围产生候选口令)并预处理口令，每批按组切分为若干任务交给工作线程池，
+ * 指定规则时每次读取一组基础口令，逐条规则变形后填满各批，
+ * 吞吐量以(候选口令, 盐)对每秒计。
+ * 各批完成的顺序与读入顺序不同，检查点只记录全部完成的连续前缀，恢复时从匹配结果文件重新标记已破解的密文。
+ * 使用potfile时启动前把其中已破解的密文标记出来，组内密文都已破解的盐不再分配任务，新的匹配结果追加到potfile，
+ * potfile中已有的密文不重复追加
+ *@version 0.1
+ */
+#include "include/crack.h"
+#include "include/bounded_queue.h"
+#include "include/target_store.h"
+#include "include/batch_arena.h"
+#include "include/metrics.h"
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <map>
+
+//! 每个候选口令在arena中预留的字节数
+#define CRACK_ARENA_BYTES_PER_PWD 64
+//! 并行加载匹配结果文件时每个线程至少处理的字节数
+#define CRACK_LOAD_BYTES_PER_THREAD (4 << 20)
+
+//! 破解出错的步骤，保存在crack_ctx::error中
+#define CRACK_ERR_HASH 1
+#define CRACK_ERR_FOUND 2         //写匹配结果文件
+#define CRACK_ERR_CIPHER 3
+#define CRACK_ERR_CHECKPOINT 4
+#define CRACK_ERR_PIPE 5          //匹配结果输出管道的读端已关闭，不是错误
+#define CRACK_ERR_POT 6
+
+/**
+ *@brief 一批候选口令，所有任务完成后回收
+ */
+struct crack_batch {
+	long long seq;              //批次序号，从0开始
+	size_t end_offset;          //本批最后一个候选口令之后在字典文件中的偏移，掩码模式为口令空间中的下标
+	int count;                  //本批候选口令个数
+	const char **pwd;           //候选口令，指向字典文件映射内存或input的视图
+	std::string input;          //流式读取时本批候选口令的副本
+	int *pwd_len;               //候选口令字节数
+	BatchArena *arena;          //预处理后的候选口令所在的连续内存
+	ByteView *pwd_view;         //预处理后的候选口令
+	std::atomic<int> pending;   //本批尚未完成的任务数
+};
+
+/**
+ *@brief 一个任务：一批候选口令对密文[first, end)中的各组计算hash值，first和end都是组的起始下标
+ */
+struct crack_task {
+	struct crack_batch *batch;
+	long long first;
+	long long end;
+};
+
+/**
+ *@brief 破解模式共享状态
+ */
+struct crack_ctx {
+	struct alg_desp *desp;
+	const TargetStore *store;
+	CipherWriter *found_out;                    //输出匹配结果，为NULL时直接写标准输出，其余信息由调用者改为输出到标准错误
+	int pot_fd;                                 //以O_APPEND打开的potfile，-1表示不使用
+	std::atomic<unsigned char> *target_found;   //每个密文是否已破解
+	std::atomic<unsigned char> *target_potted;  //每个密文是否已在potfile中，不使用potfile时为NULL
+	std::atomic<long long> targets_left;        //尚未破解的密文个数，为0时停止读取字典
+	std::atomic<long long> pairs;               //已计算的(候选口令, 盐)对数
+	BoundedQueue<struct crack_batch *> *free_queue;
+	BoundedQueue<struct crack_task> *work_queue;
+	std::mutex found_mutex;                     //保护匹配结果的输出
+	std::atomic<int> stop;                      //出错后置1，通知读取级停止
+	std::atomic<int> error;
+	const struct pipeline_option *option;
+	std::mutex checkpoint_mutex;                //保护以下检查点状态
+	std::map<long long, std::pair<size_t, int> > done;    //先于前面批次完成的批次的(结束偏移, 候选口令个数)
+	long long next_seq;                         //下一个应该完成的批次序号
+	struct checkpoint ckpt;                     //全部完成的连续前缀
+	std::chrono::steady_clock::time_point last_checkpoint;
+};
+
+/**
+ *@brief 打开密文库：索引文件可用时直接mmap，否则解析密文文件，指定了索引文件时保存索引
+ *@param store 密文库
+ *@param desp 已初始化的算法描述
+ *@param cipher_path 密文文件路径
+ *@param index_path 索引文件路径，为NULL时不使用索引
+ *@return 0：正确，-1：出错
+ */
+static int open_targets(TargetStore &store, struct alg_desp *desp, const char *cipher_path, const char *index_path)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	const char *source = "index";
+	if (index_path == NULL || store.load(index_path, desp->alg_name, cipher_path) != 0)
+	{
+		source = "cipher_file";
+		if (store.build(desp, cipher_path) != 0)
+			return -1;
+		if (index_path != NULL && store.save(index_path) != 0)
+			std::cout << "warning: save index " << index_path << " failed" << std::endl;
+	}
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "crack: load " << store.size() << " targets from " << source << " in " << ms << " ms, "
+		<< (double)store.bytes() / store.size() << " bytes/target" << std::endl;
+	return 0;
+}
+
+/**
+ *@brief 把匹配结果文件第k片(共n片)中的密文标记为已破解
+ *@param ctx 破解模式共享状态
+ *@param path 匹配结果文件，每行为"密文:口令"
+ *@param k 片号，从1开始
+ *@param n 总片数，为1时不分片，可以流式读取
+ *@param marked 累加本片新标记的密文个数
+ *@param failed 打开失败时置1
+ *@param potted 不为NULL时把文件中的密文同时标记为已在potfile中
+ */
+static void mark_found_shard(struct crack_ctx *ctx, const char *path, int k, int n, std::atomic<long long> *marked, std::atomic<int> *failed,
+	std::atomic<unsigned char> *potted)
+{
+	PwdReader found_in;
+	if (found_in.open(path) != 0 || (n > 1 && found_in.shard(k, n) != 0))
+	{
+		*failed = 1;
+		return;
+	}
+	struct alg_desp desp = *ctx->desp;
+	unsigned char salt[CIPHER_MAX_SALT], hash[CIPHER_MAX_HASH];
+	int salt_len, hash_len;
+	long long count = 0;
+	const char *line;
+	int len;
+	while (found_in.next(line, len))
+	{
+		const char *colon = (const char *)memchr(line, ':', len);
+		if (colon == NULL || desp.parse_cipher(line, colon - line, salt, salt_len, hash, hash_len, desp.extra) != 0)
+			continue;
+		long long t = ctx->store->lookup(desp.extra, salt, salt_len, hash);
+		if (t >= 0 && potted != NULL)
+			potted[t] = 1;
+		if (t >= 0 && ctx->target_found[t].exchange(1) == 0)
+		{
+			--ctx->targets_left;
+			++count;
+		}
+	}
+	if (found_in.read_failed())
+		*failed = 1;
+	found_in.close();
+	*marked += count;
+}
+
+/**
+ *@brief 把匹配结果文件或potfile中已有的密文标记为已破解
+ * 不把文件读入内存建立索引，而是逐行解析后在已按(盐, hash值)排序的密文库中查找，
+ * 大文件按行对齐的字节范围分给多个线程并行解析
+ *@param ctx 破解模式共享状态
+ *@param path 匹配结果文件，每行为"密文:口令"
+ *@param thread_num 最多使用的线程数
+ *@param potted 不为NULL时把文件中的密文同时标记为已在potfile中
+ *@return 新标记的密文个数，-1：出错
+ */
+static long long mark_found(struct crack_ctx *ctx, const char *path, int thread_num, std::atomic<unsigned char> *potted)
+{
+	struct stat st;
+	int n = 1;
+	if (stat(path, &st) == 0 && S_ISREG(st.st_mode))
+	{
+		long long want = st.st_size / CRACK_LOAD_BYTES_PER_THREAD + 1;
+		n = want < thread_num ? (int)want : thread_num;
+	}
+	std::atomic<long long> marked(0);
+	std::atomic<int> failed(0);
+	if (n == 1)
+		mark_found_shard(ctx, path, 1, 1, &marked, &failed, potted);
+	else
+	{
+		std::vector<std::thread> loaders;
+		for (int k = 1; k <= n; ++k)
+			loaders.push_back(std::thread(mark_found_shard, ctx, path, k, n, &marked, &failed, potted));
+		for (int k = 0; k < n; ++k)
+			loaders[k].join();
+	}
+	if (failed)
+	{
+		std::cout << "error: read " << path << " failed!" << std::endl;
+		return -1;
+	}
+	return marked;
+}
+
+//! 组[first, end)中是否还有未破解的密文
+static bool group_left(const struct crack_ctx *ctx, long long first, long long end)
+{
+	for (long long t = first; t < end; ++t)
+	{
+		if (ctx->target_found[t] == 0)
+			return true;
+	}
+	return false;
+}
+
+//! 把size字节完整写入fd，O_APPEND打开时一次write的内容不会与其他进程的追加交错
+static int write_all(int fd, const char *p, size_t size)
+{
+	while (size > 0)
+	{
+		ssize_t n = write(fd, p, size);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return -1;
+		p += n;
+		size -= n;
+	}
+	return 0;
+}
+
+/**
+ *@brief 把匹配结果文件已写出的部分落盘，再写检查点，调用时持有checkpoint_mutex
+ *@return 0：正确，-1：出错
+ */
+static int write_checkpoint(struct crack_ctx *ctx)
+{
+	{
+		std::lock_guard<std::mutex> lock(ctx->found_mutex);
+		if (ctx->found_out->sync() != 0 || (ctx->pot_fd >= 0 && fdatasync(ctx->pot_fd) != 0))
+			return -1;
+		ctx->ckpt.output_bytes = ctx->found_out->offset();
+	}
+	ctx->ckpt.found = ctx->store->size() - ctx->targets_left;
+	ctx->last_checkpoint = std::chrono::steady_clock::now();
+	return save_checkpoint(ctx->option->checkpoint_path, &ctx->ckpt);
+}
+
+/**
+ *@brief 一批的所有任务完成后调用，推进全部完成的连续前缀，到时间间隔时写检查点
+ * 出错停止后不再推进，被跳过的任务所在的批次不算完成
+ */
+static void commit_batch(struct crack_ctx *ctx, const struct crack_batch *batch)
+{
+	std::lock_guard<std::mutex> lock(ctx->checkpoint_mutex);
+	if (ctx->stop)
+		return;
+	ctx->done.insert(std::make_pair(batch->seq, std::make_pair(batch->end_offset, batch->count)));
+	std::map<long long, std::pair<size_t, int> >::iterator it;
+	while ((it = ctx->done.find(ctx->next_seq)) != ctx->done.end())
+	{
+		ctx->ckpt.input_offset = it->second.first;
+		ctx->ckpt.records += it->second.second;
+		ctx->done.erase(it);
+		++ctx->next_seq;
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - ctx->last_checkpoint;
+	if (elapsed.count() >= ctx->option->checkpoint_interval && write_checkpoint(ctx) != 0)
+	{
+		ctx->error = CRACK_ERR_CHECKPOINT;
+		ctx->stop = 1;
+	}
+}
+
+/**
+ *@brief 把一个匹配结果按"密文:口令"格式追加到found中，密文由算法的get_cipher接口重新生成
+ */
+static int append_found(struct alg_desp *desp, const TargetStore &store, int seg, long long t, const char *pwd, int pwd_len, std::string &found)
+{
+	ByteView hash(store.hash(t), store.hash_size());
+	ByteView salt(store.salt(t), store.segment(seg).salt_len);
+	if (alg_get_cipher_batch(desp, &hash, &salt, 1, found) != 0)
+		return -1;
+	found[found.size() - 1] = ':';
+	found.append(pwd, pwd_len);
+	found += '\n';
+	return 0;
+}
+
+/**
+ *@brief 执行一个任务，把匹配结果按"密文:口令"每行一个输出
+ *@param ctx 破解模式共享状态
+ *@param desp 当前线程的算法描述副本
+ *@param task 任务
+ *@param salt 当前线程的盐视图数组，至少batch_size个
+ *@param hash 当前线程的hash值视图数组，至少batch_size个
+ *@param arena 当前线程的分配器，每组的hash值从中分配，算完一组即回收
+ */
+static void run_task(struct crack_ctx *ctx, struct alg_desp *desp, const struct crack_task &task, ByteView *salt, ByteView *hash, BatchArena &arena)
+{
+	const TargetStore &store = *ctx->store;
+	struct crack_batch *batch = task.batch;
+	int n = batch->count;
+	long long pairs = 0;
+	std::string found, pot;    //pot为found中还不在potfile中的行
+	int seg = store.segment_of(task.first);
+	long long seg_end = store.segment_end(seg);
+
+	for (long long first = task.first, end; first < task.end && !ctx->stop; first = end)
+	{
+		//! 1. 进入新的段时设置本段的参数
+		if (first >= seg_end)
+		{
+			seg = store.segment_of(first);
+			seg_end = store.segment_end(seg);
+		}
+		end = store.group_end(first, seg_end);
+		if (!group_left(ctx, first, end))    //组内密文都已破解
+			continue;
+		const union extra_data *values = store.segment_values(seg);
+		for (int k = 0; k < store.param_num(); ++k)
+			desp->extra[store.param_index(k)].cur_value = values[k];
+
+		//! 2. 整批候选口令在本组的盐下计算hash值，盐直接引用密文库
+		ByteView group_salt(store.salt(first), store.segment(seg).salt_len);
+		for (int i = 0; i < n; ++i)
+			salt[i] = group_salt;
+		arena.reset();
+		uint64_t begin = metrics_begin();
+		if (alg_hash_pwd_batch(desp, batch->pwd_view, salt, hash, n, arena) != 0)
+		{
+			ctx->error = CRACK_ERR_HASH;
+			ctx->stop = 1;
+			break;
+		}
+		metrics_end(METRIC_HASH, begin, n);
+		pairs += n;
+
+		//! 3. 先查本组的bloom过滤器，再在组内查找，每个密文只报告第一次匹配
+		const struct target_bloom *bloom = store.bloom_of(first, end);
+		for (int i = 0; i < n; ++i)
+		{
+			if (hash[i].size() != store.hash_size())
+				continue;
+			if (bloom != NULL && !store.bloom_test(bloom, hash[i].getByte_p()))
+				continue;
+			long long t = store.find(first, end, hash[i].getByte_p());
+			if (t < 0 || ctx->target_found[t].exchange(1) != 0)
+				continue;
+			--ctx->targets_left;
+			size_t line = found.size();
+			if (append_found(desp, store, seg, t, batch->pwd[i], batch->pwd_len[i], found) != 0)
+			{
+				ctx->error = CRACK_ERR_CIPHER;
+				ctx->stop = 1;
+				break;
+			}
+			//按密文库下标判断，不依赖密文文本：potfile中已有的密文不再追加，本次运行中每个密文也只追加一次
+			if (ctx->target_potted != NULL && ctx->target_potted[t].exchange(1) == 0)
+				pot.append(found, line, std::string::npos);
+		}
+	}
+	ctx->pairs += pairs;
+
+	//! 4. 输出匹配结果
+	if (!found.empty())
+	{
+		std::lock_guard<std::mutex> lock(ctx->found_mutex);
+		uint64_t begin = metrics_begin();
+		if (ctx->found_out == NULL)
+		{
+			//不经过std::cout，匹配结果不会与状态信息混在一起；标准输出的读端关闭后不再输出，正常结束
+			if (write_all(STDOUT_FILENO, found.data(), found.size()) != 0)
+			{
+				ctx->error = errno == EPIPE ? CRACK_ERR_PIPE : CRACK_ERR_FOUND;
+				ctx->stop = 1;
+			}
+		}
+		else if (ctx->found_out->write(found.data(), found.size()) != 0)
+		{
+			ctx->error = ctx->found_out->broken_pipe() ? CRACK_ERR_PIPE : CRACK_ERR_FOUND;
+			ctx->stop = 1;
+		}
+		//每个任务的匹配结果一次追加到potfile，多个进程共用同一个potfile时行不会交错
+		if (ctx->pot_fd >= 0 && !ctx->error && !pot.empty() && write_all(ctx->pot_fd, pot.data(), pot.size()) != 0)
+		{
+			ctx->error = CRACK_ERR_POT;
+			ctx->stop = 1;
+		}
+		metrics_end(METRIC_WRITE, begin, 1);
+	}
+}
+
+//! 统计输出中各队列的名称，破解模式只有两个队列
+static const char *const queue_names[METRICS_QUEUE_NUM] = {"free", "task", ""};
+
+//! 采样空闲批次和待执行任务的个数
+static void sample_queues(void *arg, int *depth)
+{
+	struct crack_ctx *ctx = (struct crack_ctx *)arg;
+	depth[0] = ctx->free_queue->size();
+	depth[1] = ctx->work_queue->size();
+	depth[2] = -1;
+}
+
+/**
+ *@brief 工作线程：循环取任务执行，一批的所有任务完成后回收该批
+ */
+static void crack_worker(struct crack_ctx *ctx, int batch_size)
+{
+	//! 每个线程使用自己的算法描述副本，按组改写密文自带的参数
+	struct alg_desp desp = *ctx->desp;
+	ByteView *salt = new ByteView[batch_size];
+	ByteView *hash = new ByteView[batch_size];
+	BatchArena arena((size_t)batch_size * CRACK_ARENA_BYTES_PER_PWD);
+	struct crack_task task;
+
+	while (ctx->work_queue->pop(task))
+	{
+		if (!ctx->stop)
+			run_task(ctx, &desp, task, salt, hash, arena);
+		if (--task.batch->pending == 0)
+		{
+			if (ctx->option->checkpoint_path != NULL)
+				commit_batch(ctx, task.batch);
+			ctx->free_queue->push(task.batch);
+		}
+	}
+	delete[] salt;
+	delete[] hash;
+}
+
+/**
+ *@brief 读取密文文件和字典文件，多线程计算每个候选口令在每个不同盐下的hash值，输出匹配的密文和口令
+ *@param desp 已初始化的算法描述，必须提供parse_cipher
+ *@param cipher_path 密文文件路径
+ *@param index_path 二进制索引文件路径，为NULL时不使用索引
+ *@param pwd_in 已映射的字典文件，掩码模式为NULL
+ *@param mask 掩码候选口令产生器，字典模式为NULL
+ *@param rules 字典的变形规则，为NULL时直接使用字典中的口令
+ *@param found_out 输出"密文:口令"的文件，为NULL时写标准输出
+ *@param found_path 匹配结果文件路径，从检查点恢复时从中读取已破解的密文
+ *@param option 流水线运行参数，使用其中的线程数、每批口令个数和检查点设置
+ *@return 0：正确，-1：出错
+ */
+int run_crack(struct alg_desp *desp, const char *cipher_path, const char *index_path, PwdReader *pwd_in, MaskGenerator *mask, const RuleSet *rules, CipherWriter *found_out, const char *found_path, const struct pipeline_option *option)
+{
+	if (desp->parse_cipher == NULL)
+	{
+		std::cout << "error: " << desp->alg_name << " does not support crack mode!" << std::endl;
+		return -1;
+	}
+	if (option->checkpoint_path != NULL && found_out == NULL)
+	{
+		std::cout << "error: checkpoint in crack mode needs found_file!" << std::endl;
+		return -1;
+	}
+
+	//! 1. 打开密文库
+	TargetStore store;
+	if (open_targets(store, desp, cipher_path, index_path) != 0)
+		return -1;
+	long long target_num = store.size();
+	struct crack_ctx ctx;
+	ctx.desp = desp;
+	ctx.store = &store;
+	ctx.found_out = found_out;
+	ctx.pot_fd = -1;
+	ctx.target_found = new std::atomic<unsigned char>[target_num];
+	ctx.target_potted = option->pot_path != NULL ? new std::atomic<unsigned char>[target_num] : NULL;
+	for (long long i = 0; i < target_num; ++i)
+	{
+		ctx.target_found[i] = 0;
+		if (ctx.target_potted != NULL)
+			ctx.target_potted[i] = 0;
+	}
+	ctx.targets_left = target_num;
+	ctx.pairs = 0;
+	ctx.stop = 0;
+	ctx.error = 0;
+	ctx.option = option;
+	ctx.next_seq = 0;
+	ctx.ckpt.mode = CHECKPOINT_CRACK;
+	ctx.ckpt.alg_name = desp->alg_name;
+	ctx.ckpt.input_size = mask != NULL ? mask->keyspace() : pwd_in->file_size();
+	ctx.ckpt.input_offset = mask != NULL ? mask->offset() : pwd_in->offset();
+	ctx.ckpt.records = option->first_record;
+	ctx.ckpt.output_bytes = 0;
+	ctx.ckpt.found = 0;
+	ctx.last_checkpoint = std::chrono::steady_clock::now();
+	if (option->restore && found_path != NULL)
+	{
+		long long restored = mark_found(&ctx, found_path, option->thread_num, NULL);
+		if (restored < 0)
+		{
+			delete[] ctx.target_found;
+			delete[] ctx.target_potted;
+			return -1;
+		}
+		std::cout << "crack: restore " << restored << " cracked targets from " << found_path
+			<< ", resume after " << option->first_record << " candidates" << std::endl;
+	}
+
+	//! 1.1 打开potfile，不存在时创建，标记其中已破解的密文
+	if (option->pot_path != NULL)
+	{
+		ctx.pot_fd = open(option->pot_path, O_WRONLY | O_APPEND | O_CREAT, 0644);
+		long long potted = ctx.pot_fd < 0 ? -1 : mark_found(&ctx, option->pot_path, option->thread_num, ctx.target_potted);
+		if (potted < 0)
+		{
+			std::cout << "error: open potfile " << option->pot_path << " failed!" << std::endl;
+			if (ctx.pot_fd >= 0)
+				close(ctx.pot_fd);
+			delete[] ctx.target_found;
+			delete[] ctx.target_potted;
+			return -1;
+		}
+		std::cout << "crack: " << potted << " targets already cracked in potfile " << option->pot_path << std::endl;
+	}
+
+	//! 2. 按组的边界把密文库切分为约4倍线程数个任务范围，组很少时由多个批次并行
+	//! 只统计还有未破解密文的组，组内密文都已破解的盐不参与切分，执行任务时直接跳过
+	std::vector<long long> bounds(1, 0);
+	long long group_num = 0;
+	for (int s = 0; s < store.segment_num(); ++s)
+	{
+		for (long long first = store.segment(s).first, end; first < store.segment_end(s); first = end)
+		{
+			end = store.group_end(first, store.segment_end(s));
+			if (group_left(&ctx, first, end))
+				++group_num;
+		}
+	}
+	long long chunk = group_num / (4 * option->thread_num);
+	if (chunk < 1)
+		chunk = 1;
+	for (long long first = 0, groups = 0; first < target_num; )
+	{
+		int s = store.segment_of(first);
+		long long end = store.group_end(first, store.segment_end(s));
+		bool live = group_left(&ctx, first, end);
+		first = end;
+		if ((live && ++groups % chunk == 0) || first == target_num)
+			bounds.push_back(first);
+	}
+	int task_num = bounds.size() - 1;
+
+	//! 3. 创建队列和循环使用的批次，启动工作线程
+	int batch_num = 2 * option->thread_num + 2;
+	BoundedQueue<struct crack_batch *> free_queue(batch_num);
+	BoundedQueue<struct crack_task> work_queue(batch_num * task_num);
+	ctx.free_queue = &free_queue;
+	ctx.work_queue = &work_queue;
+	if (metrics_enabled)
+		metrics_watch_queues(sample_queues, &ctx, queue_names);
+	std::vector<struct crack_batch *> batches;
+	for (int i = 0; i < batch_num; ++i)
+	{
+		struct crack_batch *batch = new struct crack_batch;
+		batch->count = 0;
+		batch->pwd = new const char *[option->batch_size];
+		batch->pwd_len = new int[option->batch_size];
+		batch->arena = new BatchArena((size_t)option->batch_size * CRACK_ARENA_BYTES_PER_PWD);
+		batch->pwd_view = new ByteView[option->batch_size];
+		batch->pending = 0;
+		batches.push_back(batch);
+		free_queue.push(batch);
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::vector<std::thread> workers;
+	for (int i = 0; i < option->thread_num; ++i)
+		workers.push_back(std::thread(crack_worker, &ctx, option->batch_size));
+
+	//! 4. 读取级：按批读取并预处理候选口令，全部密文破解后提前结束
+	//! 使用规则时每组读取batch_size个基础口令，检查点只越过所有规则都已执行完的组
+	long long candidates = 0;
+	long long seq = 0;
+	bool eof = false;
+	int rule_max_len = option->max_pwd_len > 0 && option->max_pwd_len < RULE_MAX_LEN ? option->max_pwd_len : RULE_MAX_LEN;
+	RuleSet no_rules;
+	RuleBatch rule_batch(rules != NULL ? *rules : no_rules, rule_max_len);
+	std::vector<const char *> word(rules != NULL ? option->batch_size : 0);
+	std::vector<int> word_len(word.size());
+	std::string word_input;
+	bool words_eof = false;
+	size_t block_offset = 0;
+	while (!eof && !ctx.stop && ctx.targets_left > 0 && !pipeline_interrupted())
+	{
+		struct crack_batch *batch;
+		free_queue.pop(batch);
+		batch->seq = seq++;
+		batch->count = 0;
+		batch->arena->reset();
+		uint64_t begin = metrics_begin();
+		int read_num = 0;
+		size_t end_offset;
+		if (mask != NULL)    //掩码模式直接把本批下标范围内的口令写入arena
+		{
+			read_num = mask->generate(*batch->arena, batch->pwd, batch->pwd_len, option->batch_size);
+			eof = read_num < option->batch_size;
+			end_offset = mask->offset();
+		}
+		else if (rules != NULL)    //变形后的口令写入arena，一组的规则执行完再读取下一组
+		{
+			while (read_num < option->batch_size)
+			{
+				if (rule_batch.done())
+				{
+					if (words_eof)
+						break;
+					block_offset = pwd_in->offset();
+					int word_num = pwd_in->next_batch(&word[0], &word_len[0], option->batch_size, word_input);
+					words_eof = word_num < option->batch_size;
+					rule_batch.set_words(&word[0], &word_len[0], word_num);
+					continue;
+				}
+				read_num += rule_batch.generate(*batch->arena, batch->pwd + read_num, batch->pwd_len + read_num, option->batch_size - read_num);
+			}
+			eof = words_eof && rule_batch.done();
+			end_offset = rule_batch.done() ? pwd_in->offset() : block_offset;
+		}
+		else
+		{
+			read_num = pwd_in->next_batch(batch->pwd, batch->pwd_len, option->batch_size, batch->input);
+			eof = read_num < option->batch_size;
+			end_offset = pwd_in->offset();
+		}
+		metrics_end(METRIC_READ, begin, read_num);
+		begin = metrics_begin();
+		for (int j = 0; j < read_num; ++j)
+		{
+			if (batch->pwd_len[j] == 0)    //跳过空行，其余候选口令前移
+				continue;
+			int i = batch->count;
+			batch->pwd[i] = batch->pwd[j];
+			batch->pwd_len[i] = batch->pwd_len[j];
+			ByteVector bv_pwd = desp->prepare_pwd(batch->pwd[i], batch->pwd_len[i]);
+			if (bv_pwd.isEmpty())
+			{
+				std::cout << "error: prepare_pwd() is wrong!" << std::endl;
+				ctx.stop = 1;
+				break;
+			}
+			batch->pwd_view[i] = batch->arena->copy(bv_pwd.getByte_p(), bv_pwd.size());
+			++batch->count;
+		}
+		metrics_end(METRIC_PREPARE, begin, batch->count);
+		if (batch->count == 0 || ctx.stop)
+		{
+			//! 只剩空行时这一批也算完成，检查点越过这些空行
+			if (batch->count == 0 && !ctx.stop)
+			{
+				batch->end_offset = end_offset;
+				batch->pending = 0;
+				if (option->checkpoint_path != NULL)
+					commit_batch(&ctx, batch);
+			}
+			free_queue.push(batch);
+			break;
+		}
+		batch->end_offset = end_offset;
+		candidates += batch->count;
+		batch->pending = task_num;
+		for (int k = 0; k < task_num; ++k)
+		{
+			struct crack_task task = {batch, bounds[k], bounds[k + 1]};
+			work_queue.push(task);
+		}
+	}
+	work_queue.close();
+
+	//! 5. 等待所有线程退出，释放批次，输出吞吐量
+	for (int i = 0; i < option->thread_num; ++i)
+		workers[i].join();
+	if (metrics_enabled)
+		metrics_watch_queues(NULL, NULL, NULL);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	for (int i = 0; i < batch_num; ++i)
+	{
+		delete[] batches[i]->pwd;
+		delete[] batches[i]->pwd_len;
+		delete batches[i]->arena;
+		delete[] batches[i]->pwd_view;
+		delete batches[i];
+	}
+	delete[] ctx.target_found;
+	delete[] ctx.target_potted;
+
+	//! 6. 结束或出错时都写最后一个检查点，已完成的前缀仍然有效
+	if (option->checkpoint_path != NULL)
+	{
+		std::lock_guard<std::mutex> lock(ctx.checkpoint_mutex);
+		if (write_checkpoint(&ctx) != 0 && !ctx.error)
+		{
+			ctx.error = CRACK_ERR_CHECKPOINT;
+			ctx.stop = 1;
+		}
+	}
+
+	if (ctx.pot_fd >= 0 && close(ctx.pot_fd) != 0 && !ctx.error)
+		ctx.error = CRACK_ERR_POT;
+
+	long long pairs = ctx.pairs;
+	std::cout << "crack: " << candidates << " candidates x " << group_num << " salts, " << pairs << " pairs in "
+		<< seconds << " s, " << (seconds > 0 ? pairs / seconds : 0) << " pairs/s, cracked "
+		<< target_num - ctx.targets_left << "/" << target_num << std::endl;
+	if (rules != NULL)
+		std::cout << "crack: " << rules->size() << " rules, " << rule_batch.rejected() << " rejected, "
+			<< rule_batch.duplicates() << " duplicates skipped" << std::endl;
+
+	switch (ctx.error)
+	{
+		case CRACK_ERR_HASH:
+			std::cout << "error: hash_pwd() is wrong!" << std::endl;
+			return -1;
+		case CRACK_ERR_FOUND:
+			std::cout << "error: write found_file failed!" << std::endl;
+			return -1;
+		case CRACK_ERR_CIPHER:
+			std::cout << "error: get_cipher() is wrong!" << std::endl;
+			return -1;
+		case CRACK_ERR_CHECKPOINT:
+			std::cout << "error: write checkpoint_file failed!" << std::endl;
+			return -1;
+		case CRACK_ERR_PIPE:
+			return 0;
+		case CRACK_ERR_POT:
+			std::cout << "error: write potfile failed!" << std::endl;
+			return -1;
+		default:
+			break;
+	}
+	if (!ctx.stop && pipeline_interrupted() && !eof && ctx.targets_left > 0)
+	{
+		std::cout << "error: interrupted after " << ctx.ckpt.records << " candidates";
+		if (option->checkpoint_path != NULL)
+			std::cout << ", resume with -c " << option->checkpoint_path << " --restore";
+		std::cout << std::endl;
+		return -1;
+	}
+	return ctx.stop ? -1 : 0;
+}
@@ -1,78 +1,201 @@
-/**
- *@file extra_info.cpp
- *@brief 各种算法附加信息基础函数实现文件
- *@version 0.1
- */
-#include "include/extra_info.h"
-#include <string.h>
-
-/**
- *@brief 清除extra的所有有效位
- *@param extra 算法附加信息
- */
-int clear_extra_valid(struct extra_info *extra)
-{
-	for (int i = 0; i < 32; ++i)
-		extra[i].valid = 0;
-	
-	return 0;
-}
-
-/**
- *@brief 设置当前算法描述结构体的extra数组的extra_index位置的默认附加信息
- *@param extra 算法附加信息
- *@param extra_index 附加信息的位置
- *@param extra_name 附加信息的名称
- *@param intarray 附加信息是一个整形数组
- */
-int set_extra_intarray(struct extra_info *extra, int extra_index, const std::string &extra_name, std::vector<int> intarray)
-{
-	extra[extra_index].valid = 1;
-	extra[extra_index].extra_name = extra_name;
-	extra[extra_index].def_value.dint = intarray[0];
-	extra[extra_index].cur_value.dint = extra[extra_index].def_value.dint;
-	extra[extra_index].optionvalue = intarray.size();
-	for (int i = 0; i < intarray.size(); ++i)
-		extra[extra_index].values[i].dint = intarray[i];	
-	
-	return 0;
-}
-
-/**
- *@brief 设置当前算法描述结构体的extra数组的extra_index位置的默认附加信息
- *@param extra 算法附加信息
- *@param extra_index 附加信息的位置
- *@param extra_name 附加信息的名称
- *@param chararray 附加信息是一个字符数组
- */
-int set_extra_chararray(struct extra_info *extra, int extra_index, const std::string &extra_name, const std::string &chararray)
-{
-	extra[extra_index].valid = 1;
-	extra[extra_index].extra_name = extra_name;
-	strcpy(extra[extra_index].def_value.dchar, chararray.c_str());
-	extra[extra_index].cur_value = extra[extra_index].def_value;
-	extra[extra_index].optionvalue = 1;
-	strcpy(extra[extra_index].values[0].dchar, chararray.c_str());	
-	
-	return 0;
-}
-/**
- *@brief 根据extra设置算法的全局的字符集
- *@param charset 算法的全局字符集数组
- *@param extra 算法附加信息
- *@param subcharset_size 子字符集的个数
- */
-int expand_charset(char *charset, struct extra_info *extra, int subcharset_size)
-{
-	int k = 0;
-	memset(charset, '\0', 256);
-	//初始化全局字符集数组
-	for (int i = 0; i < subcharset_size; ++i)
-	{
-		for (int j = 0; j <= extra[SALT_CHARSET_INDEX].values[0].dchar[2*i+1] - extra[SALT_CHARSET_INDEX].values[0].dchar[2*i]; ++j)
-		{
-			charset[k++] = extra[SALT_CHARSET_INDEX].values[0].dchar[2*i] + j;
-		}
-	}
-	return 0;
+/**
+ *@file extra_info.cpp
+ *@brief 各种算法附加信息基础函数实现文件
+ *@version 0.1
+ */
+#include "include/extra_info.h"
+#include "include/rng.h"
+#include <string.h>
+#include <stdlib.h>
+
+int alg_debug = 0;
+
+/**
+ *@brief 清除extra的所有有效位
+ *@param extra 算法附加信息
+ */
+int clear_extra_valid(struct extra_info *extra)
+{
+	for (int i = 0; i < 32; ++i)
+		extra[i].valid = 0;
+	
+	return 0;
+}
+
+/**
+ *@brief 设置当前算法描述结构体的extra数组的extra_index位置的默认附加信息
+ *@param extra 算法附加信息
+ *@param extra_index 附加信息的位置
+ *@param extra_name 附加信息的名称
+ *@param intarray 附加信息是一个整形数组
+ */
+int set_extra_intarray(struct extra_info *extra, int extra_index, const std::string &extra_name, std::vector<int> intarray)
+{
+	extra[extra_index].valid = 1;
+	extra[extra_index].extra_name = extra_name;
+	extra[extra_index].def_value.dint = intarray[0];
+	extra[extra_index].cur_value.dint = extra[extra_index].def_value.dint;
+	extra[extra_index].optionvalue = intarray.size();
+	for (int i = 0; i < intarray.size(); ++i)
+		extra[extra_index].values[i].dint = intarray[i];	
+	
+	return 0;
+}
+
+/**
+ *@brief 设置当前算法描述结构体的extra数组的extra_index位置的默认附加信息
+ *@param extra 算法附加信息
+ *@param extra_index 附加信息的位置
+ *@param extra_name 附加信息的名称
+ *@param chararray 附加信息是一个字符数组
+ */
+int set_extra_chararray(struct extra_info *extra, int extra_index, const std::string &extra_name, const std::string &chararray)
+{
+	extra[extra_index].valid = 1;
+	extra[extra_index].extra_name = extra_name;
+	strcpy(extra[extra_index].def_value.dchar, chararray.c_str());
+	extra[extra_index].cur_value = extra[extra_index].def_value;
+	extra[extra_index].optionvalue = 1;
+	strcpy(extra[extra_index].values[0].dchar, chararray.c_str());	
+	
+	return 0;
+}
+/**
+ *@brief 设置所有算法共用的随机盐附加信息的缺省值
+ * seed缺省为启动时的随机进程种子，salt_mode缺省为stream
+ *@param extra 算法附加信息
+ */
+int set_extra_random(struct extra_info *extra)
+{
+	extra[SEED_INDEX].valid = 1;
+	extra[SEED_INDEX].extra_name = "seed";
+	extra[SEED_INDEX].def_value.dlong = rng_process_seed();
+	extra[SEED_INDEX].cur_value = extra[SEED_INDEX].def_value;
+	extra[SEED_INDEX].optionvalue = 1;
+	extra[SEED_INDEX].values[0] = extra[SEED_INDEX].def_value;
+
+	set_extra_intarray(extra, SALT_MODE_INDEX, "salt_mode", std::vector<int>{RNG_MODE_STREAM, RNG_MODE_INDEX});
+	return 0;
+}
+
+/**
+ *@brief 处理附加信息seed=N和salt_mode=stream|index
+ *@param extra 算法附加信息
+ *@param extra_name 附加信息名称
+ *@param extra_value 附加信息值
+ *@return 1：已处理，0：不是seed或salt_mode，-1：出错
+ */
+int check_extra_random(struct extra_info *extra, const std::string &extra_name, const std::string &extra_value)
+{
+	if (extra_name == "seed")
+	{
+		extra[SEED_INDEX].cur_value.dlong = strtoull(extra_value.c_str(), NULL, 10);
+		return 1;
+	}
+	if (extra_name == "salt_mode")
+	{
+		if (extra_value == "stream")
+			extra[SALT_MODE_INDEX].cur_value.dint = RNG_MODE_STREAM;
+		else if (extra_value == "index")
+			extra[SALT_MODE_INDEX].cur_value.dint = RNG_MODE_INDEX;
+		else
+			return -1;
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ *@brief 根据extra展开算法的字符集
+ *@param charset 输出字符集数组，256字节，最多展开255个字符，以'\0'结尾
+ *@param extra 算法附加信息
+ *@param subcharset_size 子字符集的个数
+ */
+int expand_charset(char *charset, struct extra_info *extra, int subcharset_size)
+{
+	int k = 0;
+	memset(charset, '\0', 256);
+	//初始化字符集数组
+	for (int i = 0; i < subcharset_size; ++i)
+	{
+		for (int j = 0; j <= extra[SALT_CHARSET_INDEX].values[0].dchar[2*i+1] - extra[SALT_CHARSET_INDEX].values[0].dchar[2*i] && k < 255; ++j)
+		{
+			charset[k++] = extra[SALT_CHARSET_INDEX].values[0].dchar[2*i] + j;
+		}
+	}
+	return 0;
+}
+
+/**
+ *@brief 批量产生n个随机盐
+ *@param desp 算法描述
+ *@param salt 输出n个盐的视图
+ *@param n 盐的个数
+ *@param first_index 第一个盐对应记录的序号，RNG_MODE_INDEX方式由它确定每个盐
+ *@param arena 本批的分配器，盐保存在其中
+ *@return 0：正确，-1：出错
+ */
+int alg_get_random_salt_batch(struct alg_desp *desp, ByteView *salt, int n, long long first_index, BatchArena &arena)
+{
+	if (desp->get_random_salt_batch != NULL)
+		return desp->get_random_salt_batch(salt, n, first_index, arena, desp->extra);
+
+	for (int i = 0; i < n; ++i)
+	{
+		ByteVector bv_salt = desp->get_random_salt(desp->extra);
+		if (bv_salt.isEmpty())
+			return -1;
+		salt[i] = arena.copy(bv_salt.getByte_p(), bv_salt.size());
+	}
+	return 0;
+}
+
+/**
+ *@brief 批量计算n个hash值
+ *@param desp 算法描述
+ *@param pwd n个预处理后的口令的视图
+ *@param salt n个盐的视图
+ *@param hash 输出n个hash值的视图
+ *@param n 口令个数
+ *@param arena 本批的分配器，hash值保存在其中
+ *@return 0：正确，-1：出错
+ */
+int alg_hash_pwd_batch(struct alg_desp *desp, const ByteView *pwd, const ByteView *salt, ByteView *hash, int n, BatchArena &arena)
+{
+	if (desp->hash_pwd_batch != NULL)
+		return desp->hash_pwd_batch(pwd, salt, hash, n, arena, desp->extra);
+
+	for (int i = 0; i < n; ++i)
+	{
+		ByteVector bv_hash = desp->hash_pwd(pwd[i], salt[i], desp->extra);
+		if (bv_hash.isEmpty())
+			return -1;
+		hash[i] = arena.copy(bv_hash.getByte_p(), bv_hash.size());
+	}
+	return 0;
+}
+
+/**
+ *@brief 批量产生n个密文，每个密文后加'\n'追加到同一个输出缓冲区
+ *@param desp 算法描述
+ *@param hash n个hash值的视图
+ *@param salt n个盐的视图
+ *@param n 密文个数
+ *@param out 输出缓冲区
+ *@return 0：正确，-1：出错
+ */
+int alg_get_cipher_batch(struct alg_desp *desp, const ByteView *hash, const ByteView *salt, int n, std::string &out)
+{
+	if (desp->get_cipher_batch != NULL)
+		return desp->get_cipher_batch(hash, salt, n, desp->extra, out);
+
+	for (int i = 0; i < n; ++i)
+	{
+		std::string cipher = desp->get_cipher(hash[i], salt[i], desp->extra);
+		if (cipher.empty())
+			return -1;
+		out += cipher;
+		out += '\n';
+	}
+	return 0;
 }
\ No newline at end of file
@@ -1,286 +1,684 @@
-/**
- *@file getcipher.cpp
- *@brief 处理用户输入命令行的主函数文件
- *@version 0.1
- */
-/*
- * 程序使用命令：
- *   ./getcipher alg_name pwd [extra_name=extra_value]
- * 输入：
- *   alg_name    算法名称    字符串(不超过31字节)    来自于标准算法名称表
- *   pwd         口令        口令                    一般为ASCII可输入字符
- *   extra_name  附加信息名称 字符串(不超过31字节)   典型的名称包括
- *               salt_len    salt长度    //0号位置 SALT_LEN_INDEX = 0
- *               iter_count  迭代次数    //1号位置 ITER_COUNT_INDEX = 1
- *               pwd_len     口令长度    //2号位置 PWD_LEN_INDEX = 2
- *               ssid        WPA的SSID
- *               其余的根据特定算法决定
- *   extra_value 附加信息数值 字符串(不超过31字节)或者整数    数据类型由extra_name决定
- *
- * author: liufeng
- * date:   2018/8/1
- */
-
-#include "include/extra_info.h"
-#include <stdio.h>
-#include <string.h>
-#include <stdlib.h>
-#include <fstream>
-#include <regex>
-
-#define _MAIN_DEBUG
-
-/*struct ptrCmp
-{
-	bool operator() (const char *s1, const char *s2) const
-	{
-		return (strcmp(s1, s2) < 0);
-	}
-};*/
-//加密算法名和算法描述结构体的映射
-//static std::map<char *, struct alg_desp, ptrCmp> myAlgMap;
-static std::map<std::string, struct alg_desp> myAlgMap;   
-
-//存储附加信息和对应的正则表达式
-static std::map<std::string, std::string> extra_value_pattern; 
-
-//存储解析命令行后得到的附加信息和值
-static std::map<std::string, std::string>extra_name_value;  
-
-/**************引用外部算法描述，用来在main()中注册******************/
-
-extern struct alg_desp wordpress_alg_desp;
-
-/********************************************************************/
-
-//根据用户输入的算法名得到的算法描述
-static struct alg_desp cur_alg_desp;    
-
-static std::ifstream file_in;
-static std::ofstream file_out;
-
-/**
- *@brief 注册所有加密算法描述结构体以及附加信息值的格式正则表达式
- */
-int register_all()
-{
-	//! 1. 注册算法名和对应算法描述的映射
-	myAlgMap.insert(std::make_pair(std::string("wordpress"), wordpress_alg_desp));
-	//! 2. 注册附加信息的值对应的正则表达式规则
-	extra_value_pattern.insert(std::make_pair(std::string("salt_len"), std::string("\\d+")));    //匹配任何一个数字字符
-	extra_value_pattern.insert(std::make_pair(std::string("iter_pos"), std::string("\\S")));    //匹配任何一个可见字符
-	//匹配[*-*]这样的1个或多个字符集
-	extra_value_pattern.insert(std::make_pair(std::string("salt_charset"), std::string("(\\[[0-9A-Za-z\\./]{1}\\-[0-9A-Za-z\\./]{1}\\])+")));
-	
-	return 0;
-}
-
-/**
- *@brief 打开输入文件
- *@param file_in 文件指针
- *@param infile_path 输入文件路径
- */
-int open_infile(std::ifstream &file_in, const char *infile_path)
-{
-	file_in.open(infile_path);    //默认以ifstream::in方式打开
-	if (!file_in)
-	{
-		std::cout<<"error: open pwd_file " << infile_path << " failed!" << std::endl;
-		return -1;
-	}
-}
-/**
- *@brief 打开输出文件
- *@param file_out 文件指针
- *@param outfile_path 输出文件路径
- */
-int open_outfile(std::ofstream &file_out, const char *outfile_path)
-{
-	file_out.open(outfile_path);    //默认以ofstream::out | ofstream::trunc方式打开
-	if (!file_out)
-	{
-		std::cout<<"error: open cipher_file " << outfile_path << " failed!" << std::endl;
-		return -1;
-	}
-}
-/**
- *@brief 解析命令行，判断用户输入的信息格式是否正确
- *@param argc 命令行参数的个数
- *@param argv 命令行字符串参数数组
- */
-int parse_cmdline(int argc, char **argv)
-{
-	//! 1. 判断用户输入命令行基本参数个数是否正确
-	if (argc < 4)
-	{
-		printf("argc = %d, Usage: ./getcipher alg_name pwd_file cipher_file [extra_name=extra_value]\n", argc);
-		return -1;
-	}
-	
-	//! 2. 判断map中是否存在用户输入的算法名
-	if (myAlgMap.count(argv[1]) <= 0)
-	{
-		printf("error: alg_name:%s is not exist!\n", argv[1]);
-		return -1;
-	}
-	
-	//! 3. 打开输入输出文件，不正确报错退出
-	
-    if (open_infile(file_in, argv[2]) == -1)
-		return -1;
-	
-	if (open_outfile(file_out, argv[3]) == -1)
-		return -1;
-	//! 4. 处理用户输入的附加信息
-    for (int i = 4; i < argc; ++i)
-	{
-		//! 4.1 利用‘=’切割获取到附加信息名称和值
-		std::string str_extra_info = argv[i];
-        int index = 0;
-		index = str_extra_info.find('=');
-		if (index == std::string::npos)
-		{
-			std::cout<<"error: [no '='], the format of extra_info" << str_extra_info << " is wrong!"<<std::endl;
-			return -1;
-		}
-		std::string str_extra_name = str_extra_info.substr(0, index);
-		std::string str_extra_value = str_extra_info.substr(index + 1);
-		
-		//! 4.2 首先检查附加信息名称是否在名称-模式map中存在
-		if (extra_value_pattern.count(str_extra_name) <= 0)
-		{
-			std::cout << "error: extra_name: " << str_extra_name << " is not valid!" << std::endl;
-			return -1;
-		}
-		//! 4.3 再利用c++正则表达式，检查值的格式是否正确
-		try {
-			std::regex r(extra_value_pattern[str_extra_name]);
-			if (!std::regex_match(str_extra_value, r))
-			{
-				std::cout << "error: extra_value: " << str_extra_value << " is not valid!" << std::endl;
-				return -1;
-			}
-		} catch (std::regex_error e) {
-			std::cout << e.what() << "\nerror code: " << e.code() << std::endl;
-			return -1;
-		}
-		//! 4.4 如果附加信息是salt_charset，就先处理成09az这种形式
-		if (str_extra_name == std::string("salt_charset"))
-		{
-			//! 4.4.1 计算字符集的子集个数
-			int optionValue = 0;   
-			for (int i = 0; i < str_extra_value.size(); ++i)
-			{
-				if (str_extra_value[i] == '[')
-					++optionValue;
-			}
-			//! 4.4.2 把附加信息值(eg:[0-9][a-z])解析成09az存储在std::string中
-			std::string str_value_tmp = str_extra_value;
-			int index;
-			std::string charset;
-			for (int i = 0; i < optionValue; ++i)
-			{
-				index = -1;
-				index = str_value_tmp.find('-');
-				charset.push_back(str_value_tmp[index - 1]);
-				charset.push_back(str_value_tmp[index + 1]);
-				str_value_tmp = str_value_tmp.substr(index + 3);    //[0-9][a-z]，从”-“跳到”[a-z]",越过3个字符每次
-			}
-			//！4.4.3 把附加信息名称和值添加到名称-值map中
-			extra_name_value.insert(std::make_pair(str_extra_name, charset));
-			continue;
-		}
-		//! 4.5 把正确识别的附加信息名称和值插入名称-值map中
-		extra_name_value.insert(std::make_pair(str_extra_name, str_extra_value));    
-	}
-	
-	return 0;
-}
-/**
- *@brief main()函数，处理用户输入命令行参数，调用相应加密算法产生密文文件
- */
-int main(int argc, char **argv)
-{
-	
-	//在main()中注册所有算法，以及附加信息与其对应值的正则表达式
-	if (register_all() != 0)
-    {
-		std::cout<<"error: register_all() is wrong!"<<std::endl;
-		return -1;
-	}
-	
-	if (parse_cmdline(argc, argv) != 0)
-	{
-		std::cout<<"error: parse_cmdline() is wrong!"<<std::endl;
-		return -1;
-	}
-	
-	#ifdef _MAIN_DEBUG
-		std::map<std::string, std::string>::iterator it;
-		for (it = extra_name_value.begin(); it != extra_name_value.end(); ++it)
-		{
-			std::cout << "map extra_name_value: key = " << it->first << ", value = " << it->second << std::endl;
-		}
-	#endif
-	
-	//根据算法名得到算法描述结构体
-	cur_alg_desp = myAlgMap[argv[1]];
-	
-	//初始化算法描述结构体
-	if (cur_alg_desp.init_alg_desp(cur_alg_desp.extra) != 0)
-	{
-		std::cout << "error: init_alg_desp() is wrong!" << std::endl;
-		return -1;
-	}
-	
-	//再次检查用户输入的信息，设置算法描述结构体的当前值
-	if (cur_alg_desp.check_cmdline(cur_alg_desp.extra, extra_name_value) != 0)
-	{
-		std::cout << "error: check_cmdline() is wrong!" << std::endl;
-		return -1;
-	}
-	
-	std::string pwd;
-	while (getline(file_in, pwd))    //每次从口令文件读取一行口令进行加密处理
-	{
-		/*********************************算法过程*********************************/
-		ByteVector bv_salt;
-		bv_salt = cur_alg_desp.get_random_salt(cur_alg_desp.extra);
-		if (bv_salt.isEmpty())
-		{
-			std::cout<<"error: get_random_salt() is wrong!"<<std::endl;
-			return -1;
-		}
-
-		ByteVector bv_pwd;
-		bv_pwd = cur_alg_desp.prepare_pwd(pwd); 
-		if (bv_pwd.isEmpty())
-		{
-			std::cout<<"error: prepare_pwd() is wrong!"<<std::endl;
-			return -1;
-		}
-
-		ByteVector bv_hash;
-		bv_hash = cur_alg_desp.hash_pwd(bv_pwd, bv_salt, cur_alg_desp.extra); 
-		if (bv_hash.isEmpty())
-		{
-			std::cout<<"error: hash_pwd() is wrong!"<<std::endl;
-			return -1;
-		}
-		
-		std::string cipher;
-		cipher = cur_alg_desp.get_cipher(bv_hash, bv_salt, cur_alg_desp.extra);
-		if (cipher.empty())
-		{
-			std::cout<<"error: get_cipher() is wrong!"<<std::endl;
-			return -1;
-		}
-		#ifdef _MAIN_DEBUG
-			file_out << cipher << std::endl;
-		#endif
-	}
-	file_in.close();
-	file_out.close();
-	
-	return 0;
-}
+/**
+ *@file getcipher.cpp
+ *@brief 处理用户输入命令行的主函数文件
+ *@version 0.1
+ */
+/*
+ * 程序使用命令：
+ *   ./getcipher [-v] [-t thread_num] [-b batch_size] [-u] [-L max_pwd_len] [--records] [-w direct|fsync] [-c checkpoint_file [-C seconds] [--restore]] [--shard k/n] [-m seconds] [--metrics-file prom_file] alg_name pwd [extra_name=extra_value]
+ *   ./getcipher crack [-v] [-t thread_num] [-b batch_size] [-L max_pwd_len] [-I index_file] [-r rules_file] [--pot potfile] [-c checkpoint_file [-C seconds] [--restore]] [--shard k/n] [-m seconds] [--metrics-file prom_file] alg_name cipher_file pwd_file [found_file]
+ *   ./getcipher crack [options] --mask mask [-1 charset] [-2 charset] [-3 charset] [-4 charset] alg_name cipher_file [found_file]
+ *   ./getcipher verify [-v] [-t thread_num] [-b batch_size] [-u] [-w direct|fsync] [-c checkpoint_file [-C seconds] [--restore]] [--shard k/n] [-m seconds] [--metrics-file prom_file] alg_name pair_file result_file
+ *   ./getcipher merge merged_file shard_cipher_file...
+ * 输入：
+ *   -v          输出附加信息、每个盐和密文等调试信息，缺省不输出
+ *   -t          hash工作线程数，缺省为1
+ *   -b          每批口令个数，缺省为256
+ *   -u          密文按计算完成顺序输出，缺省按口令输入顺序输出
+ *   -L          口令最大长度，超过的部分被截断，缺省不限制
+ *   --records   pwd_file每行为"口令[\t盐[\t迭代次数标识]]"，每条记录使用自己的盐和迭代次数(如导出的wordpress用户表)，
+ *               省略或为空的盐按记录序号产生随机盐，省略或为空的迭代次数标识使用iter_pos，空行被忽略，不能与-L同时使用；
+ *               迭代次数2^7..2^30相差很大，每批记录按参数排序、按代价切分为任务，由工作窃取线程池最贵的任务先执行
+ *   -w          密文文件写入策略，direct：O_DIRECT写入，fsync：结束时fsync，可以同时指定
+ *   -c          检查点文件，每隔一段时间原子地记录已完成的口令在口令文件中的偏移和已写出的密文，
+ *               收到SIGINT/SIGTERM时处理完已读入的口令、写最后一个检查点后退出，正常结束时删除，不能与-u同时使用
+ *   -C          写检查点的间隔秒数，缺省为60
+ *   --restore   从-c指定的检查点恢复：密文文件截断到检查点处并追加，口令文件从检查点的偏移继续读取
+ *   --shard     只处理口令文件(破解模式为字典文件)的第k片(共n片，k从1开始)，按字节均分，边界对齐到行首，
+ *               只hash本片的口令，本片之前的内容只扫描换行符以确定本片的起始行号；
+ *               产生密文模式在密文文件旁写cipher_file.manifest清单，记录本片的字节范围和行号范围。
+ *               各片的记录序号从本片的起始行号开始，与不分片运行时同一行的序号相同，
+ *               所以salt_mode=index时合并后的密文与不分片运行完全相同，不能与cipher_file为"-"同时使用
+ *   -m          每隔seconds秒向标准错误输出各级(读取、产生盐、预处理、hash、产生密文、写入)的调用次数、
+ *               平均并发数和延迟分位数、队列深度以及hash/s，结束时输出总计；缺省不统计
+ *   --metrics-file 同时把统计写成Prometheus文本格式文件，供node exporter的textfile收集器读取，
+ *               没有-m时每10秒输出一次
+ *   pwd_file    口令文件，"-"表示标准输入；标准输入和管道流式读取，不能与-c、--shard同时使用
+ *   cipher_file 密文文件，"-"表示标准输出，此时其余信息输出到标准错误，不能与-w、-c、--shard同时使用；
+ *               输出管道的读端关闭时停止并正常退出
+ *   alg_name    算法名称    字符串(不超过31字节)    来自于标准算法名称表
+ *   pwd         口令        口令                    一般为ASCII可输入字符
+ *   extra_name  附加信息名称 字符串(不超过31字节)   典型的名称包括
+ *               salt_len    salt长度    //0号位置 SALT_LEN_INDEX = 0
+ *               iter_count  迭代次数    //1号位置 ITER_COUNT_INDEX = 1
+ *               pwd_len     口令长度    //2号位置 PWD_LEN_INDEX = 2
+ *               seed        随机盐种子  //4号位置 SEED_INDEX = 4
+ *               salt_mode   随机盐产生方式stream或index  //5号位置 SALT_MODE_INDEX = 5
+ *               ssid        WPA的SSID
+ *               其余的根据特定算法决定
+ *   extra_value 附加信息数值 字符串(不超过31字节)或者整数    数据类型由extra_name决定
+ * 破解模式：
+ *   crack       用字典pwd_file中的候选口令破解cipher_file中的密文，-t缺省为CPU核数，字典为"-"时从标准输入读取
+ *   -I          密文库的二进制索引文件，存在并且与cipher_file一致时直接mmap，否则解析cipher_file后生成
+ *   --mask      不读取字典，按掩码枚举候选口令：?l小写字母，?u大写字母，?d数字，?s特殊字符(含空格)，
+ *               ?a前四者之和，?1..?4为-1..-4定义的字符集，??为'?'，[x-y]为一段连续字符，其余字符原样出现，
+ *               例如?l?l?d?d?d；口令空间按下标编号，最后一个位置变化最快，--shard和--restore都按下标范围
+ *   -r          规则文件，字典中的每个口令按每条规则变形后作为候选口令，兼容John the Ripper规则的常用子集，
+ *               变形后超过-L或231字节的口令被跳过，不能与--mask同时使用
+ *   --pot       potfile，不存在时创建；启动时把其中已破解的密文标记出来，不再输出，组内密文都已破解的盐不再计算，
+ *               新的匹配结果以"密文:口令"逐次原子地追加到potfile，多次运行、多个进程可以共用同一个potfile
+ *   -1..-4      自定义字符集，与salt_charset相同的[a-z][0-9]语法，也可以包含?l等内置字符集和单个字符
+ *   found_file  匹配的"密文:口令"输出文件，缺省或为"-"时输出到标准输出，此时其余信息输出到标准错误；使用-c时必须指定，
+ *               恢复时追加，文件中已有的密文不再重复输出
+ * 校验模式：
+ *   verify      pair_file每行为"密文:口令"(与found_file格式相同)，口令可以含':'，空行被忽略，"-"表示标准输入；
+ *               每个密文自带盐和迭代次数，按迭代次数分段、按代价由工作窃取线程池批量计算后常数时间比较，
+ *               按输入顺序向result_file每行输出"密文:match"、"密文:mismatch"或"密文:invalid"，-t缺省为CPU核数
+ * 合并模式：
+ *   merge       按片号顺序流式拼接各片的密文文件，根据清单检查片是否齐全、字节范围和行号范围首尾相接，以及长度和SHA-256；
+ *               合并后口令的顺序与口令文件相同，salt_mode=index时与不分片运行的密文文件完全相同
+ *
+ * author: liufeng
+ * date:   2018/8/1
+ */
+
+#include "include/extra_info.h"
+#include "include/alg_registry.h"
+#include "include/pipeline.h"
+#include "include/crack.h"
+#include "include/rng.h"
+#include "include/checkpoint.h"
+#include "include/shard.h"
+#include "include/metrics.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <thread>
+
+//存储解析命令行后得到的附加信息和值
+static std::map<std::string, std::string>extra_name_value;  
+
+//根据用户输入的算法名得到的算法描述
+static struct alg_desp cur_alg_desp;    
+
+//用户输入的算法名
+static std::string cur_alg_name;
+
+//命令行-t -b -u -L -w选项设置的流水线运行参数
+static struct pipeline_option run_option;
+
+static PwdReader file_in;
+static CipherWriter file_out;
+
+//1：字典破解模式，0：产生密文模式
+static int crack_mode = 0;
+
+//1：校验模式，除计算级外与产生密文模式相同
+static int verify_mode = 0;
+
+//1：产生密文模式的--records，每条记录自带盐和迭代次数标识
+static int records_mode = 0;
+
+//破解模式的密文文件路径、-I选项指定的二进制索引文件路径，以及是否指定了匹配结果输出文件
+static const char *cipher_path = NULL;
+static const char *index_path = NULL;
+static int has_found_file = 0;
+static const char *found_path = NULL;
+
+//破解模式--mask指定的掩码和-1..-4定义的自定义字符集，mask_text为空表示字典模式
+static std::string mask_text;
+static std::string mask_custom[MASK_CUSTOM_NUM];
+static MaskGenerator mask_gen;
+
+//破解模式-r指定的规则文件和编译后的规则，rules_path为NULL表示不使用规则
+static const char *rules_path = NULL;
+static RuleSet rule_set;
+
+//--restore时读取的检查点
+static struct checkpoint restore_ckpt;
+
+//--shard指定的片号和总片数，shard_num为0表示不分片；产生密文模式的密文文件路径，用于写清单
+static int shard_index = 0;
+static int shard_num = 0;
+static const char *outfile_name = NULL;
+
+//1：合并模式，merge_argv为合并后的文件和各片的密文文件
+static int merge_mode = 0;
+static char **merge_argv = NULL;
+static int merge_argc = 0;
+
+//-m指定的统计输出间隔秒数，0表示不统计；--metrics-file指定的Prometheus文本格式文件
+static int metrics_interval = 0;
+static const char *metrics_path = NULL;
+
+/**
+ *@brief 打开输入文件
+ *@param file_in 口令文件读取器
+ *@param infile_path 输入文件路径
+ */
+int open_infile(PwdReader &file_in, const char *infile_path)
+{
+	if (file_in.open(infile_path, run_option.max_pwd_len) != 0)    //只读mmap整个口令文件
+	{
+		std::cout<<"error: open pwd_file " << infile_path << " failed!" << std::endl;
+		return -1;
+	}
+	//流式读取不能定位，不能使用检查点和分片
+	if (file_in.streaming() && (run_option.checkpoint_path != NULL || shard_num > 0))
+	{
+		std::cout<<"error: -c and --shard can not be used with pwd_file " << infile_path << " from stdin or pipe!" << std::endl;
+		return -1;
+	}
+	//分片时只读取本片，记录序号为本片之前的行数，与不分片运行时同一行的序号相同
+	if (shard_num > 0)
+	{
+		file_in.shard(shard_index, shard_num);
+		if (!run_option.restore)
+			run_option.first_record = file_in.count_lines(0, file_in.range_begin());
+	}
+	//从检查点恢复时口令文件必须没有变化，从检查点的偏移继续读取
+	if (run_option.restore)
+	{
+		if ((long long)file_in.file_size() != restore_ckpt.input_size || file_in.seek(restore_ckpt.input_offset) != 0)
+		{
+			std::cout<<"error: pwd_file " << infile_path << " does not match checkpoint!" << std::endl;
+			return -1;
+		}
+	}
+	return 0;
+}
+/**
+ *@brief 解析掩码，按--shard只产生本片的下标范围，按检查点定位
+ *@param mask 掩码候选口令产生器
+ */
+int open_mask(MaskGenerator &mask)
+{
+	if (mask.parse(mask_text, mask_custom) != 0)
+	{
+		std::cout<<"error: " << mask.error() << "!" << std::endl;
+		return -1;
+	}
+	//分片时按下标均分口令空间，记录序号从本片的第一个下标开始
+	if (shard_num > 0)
+	{
+		mask.shard(shard_index, shard_num);
+		if (!run_option.restore)
+			run_option.first_record = mask.range_begin();
+	}
+	//从检查点恢复时口令空间必须相同，从检查点的下标继续产生
+	if (run_option.restore)
+	{
+		if ((long long)mask.keyspace() != restore_ckpt.input_size || restore_ckpt.input_offset < 0
+			|| mask.seek(restore_ckpt.input_offset) != 0)
+		{
+			std::cout<<"error: mask " << mask_text << " does not match checkpoint!" << std::endl;
+			return -1;
+		}
+	}
+	return 0;
+}
+/**
+ *@brief 打开输出文件
+ *@param file_out 缓冲写入的密文文件
+ *@param outfile_path 输出文件路径
+ */
+int open_outfile(CipherWriter &file_out, const char *outfile_path)
+{
+	//从检查点恢复时，产生密文模式丢弃检查点之后写出的密文，破解模式保留所有匹配结果，都以追加方式打开
+	int flags = run_option.write_flags;
+	if (strcmp(outfile_path, "-") == 0 && (flags != 0 || run_option.checkpoint_path != NULL))
+	{
+		std::cout<<"error: -w and -c can not be used with stdout!" << std::endl;
+		return -1;
+	}
+	//清单要在结束后重新读取密文文件计算SHA-256，标准输出无法读取
+	if (strcmp(outfile_path, "-") == 0 && shard_num > 0)
+	{
+		std::cout<<"error: --shard can not be used with stdout!" << std::endl;
+		return -1;
+	}
+	if (run_option.restore)
+	{
+		struct stat st;
+		if (!crack_mode && (stat(outfile_path, &st) != 0 || st.st_size < restore_ckpt.output_bytes
+			|| truncate(outfile_path, restore_ckpt.output_bytes) != 0))
+		{
+			std::cout<<"error: cipher_file " << outfile_path << " does not match checkpoint!" << std::endl;
+			return -1;
+		}
+		flags |= WRITER_APPEND;
+	}
+	size_t buffer_size = strcmp(outfile_path, "-") == 0 ? STREAM_WRITE_BUFFER_SIZE : DEFAULT_WRITE_BUFFER_SIZE;
+	if (file_out.open(outfile_path, flags, buffer_size) != 0)    //以截断或追加方式打开
+	{
+		std::cout<<"error: open cipher_file " << outfile_path << " failed!" << std::endl;
+		return -1;
+	}
+	return 0;
+}
+/**
+ *@brief 解析命令行，判断用户输入的信息格式是否正确
+ *@param argc 命令行参数的个数
+ *@param argv 命令行字符串参数数组
+ */
+int parse_cmdline(int argc, char **argv)
+{
+	//! 0. 处理算法名之前的crack以及-t -b -u -L -w选项，破解模式缺省使用所有CPU核
+	init_pipeline_option(&run_option);
+	int argi = 1;
+	if (argc > 1 && std::string(argv[1]) == "merge")
+	{
+		if (argc < 4)
+		{
+			printf("Usage: ./getcipher merge merged_file shard_cipher_file...\n");
+			return -1;
+		}
+		merge_mode = 1;
+		merge_argv = argv + 2;
+		merge_argc = argc - 2;
+		return 0;
+	}
+	if (argc > 1 && (std::string(argv[1]) == "crack" || std::string(argv[1]) == "verify"))
+	{
+		crack_mode = std::string(argv[1]) == "crack";
+		verify_mode = !crack_mode;
+		int cores = std::thread::hardware_concurrency();
+		run_option.thread_num = cores < 1 ? 1 : (cores > MAX_THREAD_NUM ? MAX_THREAD_NUM : cores);
+		++argi;
+	}
+	for (; argi < argc && argv[argi][0] == '-'; ++argi)
+	{
+		std::string option = argv[argi];
+		if (option == "-u")
+			run_option.unordered = 1;
+		else if (option == "-v")
+			alg_debug = 1;
+		else if (option == "-I" && crack_mode && argi + 1 < argc)
+			index_path = argv[++argi];
+		else if (option == "--pot" && crack_mode && argi + 1 < argc)
+			run_option.pot_path = argv[++argi];
+		else if (option == "-r" && crack_mode && argi + 1 < argc)
+			rules_path = argv[++argi];
+		else if (option == "--records" && !crack_mode && !verify_mode)
+			records_mode = 1;
+		else if (option == "--mask" && crack_mode && argi + 1 < argc)
+			mask_text = argv[++argi];
+		else if (option.size() == 2 && option[1] >= '1' && option[1] < '1' + MASK_CUSTOM_NUM && crack_mode && argi + 1 < argc)
+			mask_custom[option[1] - '1'] = argv[++argi];
+		else if (option == "-c" && argi + 1 < argc)
+			run_option.checkpoint_path = argv[++argi];
+		else if (option == "--restore")
+			run_option.restore = 1;
+		else if (option == "--shard" && argi + 1 < argc)
+		{
+			if (parse_shard(argv[++argi], shard_index, shard_num) != 0)
+			{
+				printf("error: shard %s must be k/n with 1 <= k <= n <= %d!\n", argv[argi], MAX_SHARD_NUM);
+				return -1;
+			}
+		}
+		else if (option == "--metrics-file" && argi + 1 < argc)
+			metrics_path = argv[++argi];
+		else if (option == "-m" && argi + 1 < argc)
+		{
+			metrics_interval = atoi(argv[++argi]);
+			if (metrics_interval < 1 || metrics_interval > 86400)
+			{
+				printf("error: metrics interval %s must be in [1, 86400]!\n", argv[argi]);
+				return -1;
+			}
+		}
+		else if (option == "-C" && argi + 1 < argc)
+		{
+			run_option.checkpoint_interval = atoi(argv[++argi]);
+			if (run_option.checkpoint_interval < 1 || run_option.checkpoint_interval > 86400)
+			{
+				printf("error: checkpoint interval %s must be in [1, 86400]!\n", argv[argi]);
+				return -1;
+			}
+		}
+		else if (option == "-w" && argi + 1 < argc)
+		{
+			std::string policy = argv[++argi];
+			if (policy == "direct")
+				run_option.write_flags |= WRITER_DIRECT;
+			else if (policy == "fsync")
+				run_option.write_flags |= WRITER_FSYNC;
+			else
+			{
+				printf("error: write policy %s is not valid!\n", argv[argi]);
+				return -1;
+			}
+		}
+		else if ((option == "-t" || option == "-b" || option == "-L") && argi + 1 < argc)
+		{
+			int value = atoi(argv[++argi]);
+			if (option == "-L")
+			{
+				if (value < 1 || value > MAX_PWD_LEN)
+				{
+					printf("error: max_pwd_len %s must be in [1, %d]!\n", argv[argi], MAX_PWD_LEN);
+					return -1;
+				}
+				run_option.max_pwd_len = value;
+				continue;
+			}
+			if (option == "-t" && (value < 1 || value > MAX_THREAD_NUM))
+			{
+				printf("error: thread_num %s must be in [1, %d]!\n", argv[argi], MAX_THREAD_NUM);
+				return -1;
+			}
+			if (option == "-b" && (value < 1 || value > MAX_BATCH_SIZE))
+			{
+				printf("error: batch_size %s must be in [1, %d]!\n", argv[argi], MAX_BATCH_SIZE);
+				return -1;
+			}
+			if (option == "-t")
+				run_option.thread_num = value;
+			else
+				run_option.batch_size = value;
+		}
+		else
+		{
+			printf("error: option %s is not valid!\n", argv[argi]);
+			return -1;
+		}
+	}
+	argc -= argi - 1;
+	argv += argi - 1;
+
+	//! 0.1 检查点要求按输入顺序输出；恢复时先读取检查点，打开文件时据此定位
+	if (run_option.checkpoint_path != NULL && run_option.unordered)
+	{
+		printf("error: -c can not be used with -u!\n");
+		return -1;
+	}
+	if (run_option.restore)
+	{
+		if (run_option.checkpoint_path == NULL || load_checkpoint(run_option.checkpoint_path, &restore_ckpt) != 0)
+		{
+			printf("error: --restore needs a valid checkpoint_file given by -c!\n");
+			return -1;
+		}
+		const char *mode = crack_mode ? CHECKPOINT_CRACK : (verify_mode ? CHECKPOINT_VERIFY : (records_mode ? CHECKPOINT_RECORDS : CHECKPOINT_GENERATE));
+		if (restore_ckpt.mode != mode)
+		{
+			printf("error: checkpoint %s is not for %s mode!\n", run_option.checkpoint_path, mode);
+			return -1;
+		}
+		run_option.first_record = restore_ckpt.records;
+	}
+
+	//! 1. 判断用户输入命令行基本参数个数是否正确，掩码模式没有字典文件
+	if (argc < (mask_text.empty() ? 4 : 3))
+	{
+		printf("argc = %d, Usage: ./getcipher [-v] [-t thread_num] [-b batch_size] [-u] [-L max_pwd_len] [--records] [-w direct|fsync] [-c checkpoint_file [-C seconds] [--restore]] [--shard k/n] [-m seconds] [--metrics-file prom_file] alg_name pwd_file cipher_file [extra_name=extra_value]\n", argc);
+		printf("       ./getcipher crack [-v] [-t thread_num] [-b batch_size] [-L max_pwd_len] [-I index_file] [-r rules_file] [--pot potfile] [-c checkpoint_file [-C seconds] [--restore]] [--shard k/n] [-m seconds] [--metrics-file prom_file] alg_name cipher_file pwd_file [found_file]\n");
+		printf("       ./getcipher crack [options] --mask mask [-1 charset] [-2 charset] [-3 charset] [-4 charset] alg_name cipher_file [found_file]\n");
+		printf("       ./getcipher verify [-v] [-t thread_num] [-b batch_size] [-u] [-w direct|fsync] [-c checkpoint_file [-C seconds] [--restore]] [--shard k/n] [-m seconds] [--metrics-file prom_file] alg_name pair_file result_file\n");
+		printf("       ./getcipher merge merged_file shard_cipher_file...\n");
+		return -1;
+	}
+	
+	//! 2. 判断map中是否存在用户输入的算法名
+	if (find_alg_desp(argv[1]) == NULL)
+	{
+		printf("error: alg_name:%s is not exist!\n", argv[1]);
+		return -1;
+	}
+	cur_alg_name = argv[1];
+	if (run_option.restore && restore_ckpt.alg_name != cur_alg_name)
+	{
+		printf("error: checkpoint %s is not for %s!\n", run_option.checkpoint_path, argv[1]);
+		return -1;
+	}
+	
+	//! 2.1 破解模式：打开密文文件、字典文件和可选的匹配结果输出文件，不接受附加信息
+	if (crack_mode && !mask_text.empty())
+	{
+		if (rules_path != NULL)
+		{
+			printf("error: -r can not be used with --mask!\n");
+			return -1;
+		}
+		if (argc > 4)
+		{
+			printf("Usage: ./getcipher crack [options] --mask mask [-1 charset] [-2 charset] [-3 charset] [-4 charset] alg_name cipher_file [found_file]\n");
+			return -1;
+		}
+		if (run_option.checkpoint_path != NULL && (argc != 4 || strcmp(argv[3], "-") == 0))
+		{
+			printf("error: -c in crack mode needs found_file!\n");
+			return -1;
+		}
+		cipher_path = argv[2];
+		if (open_mask(mask_gen) == -1)
+			return -1;
+		if (argc == 4 && strcmp(argv[3], "-") != 0)
+		{
+			if (open_outfile(file_out, argv[3]) == -1)
+				return -1;
+			has_found_file = 1;
+			found_path = argv[3];
+		}
+		return 0;
+	}
+	if (crack_mode)
+	{
+		if (argc > 5)
+		{
+			printf("Usage: ./getcipher crack [-v] [-t thread_num] [-b batch_size] [-L max_pwd_len] [-I index_file] [-r rules_file] [--pot potfile] [-c checkpoint_file [-C seconds] [--restore]] [--shard k/n] [-m seconds] [--metrics-file prom_file] alg_name cipher_file pwd_file [found_file]\n");
+			return -1;
+		}
+		if (run_option.checkpoint_path != NULL && (argc != 5 || strcmp(argv[4], "-") == 0))
+		{
+			printf("error: -c in crack mode needs found_file!\n");
+			return -1;
+		}
+		cipher_path = argv[2];
+		if (rules_path != NULL && rule_set.load(rules_path) != 0)
+		{
+			std::cout << "error: " << rule_set.error() << "!" << std::endl;
+			return -1;
+		}
+		if (open_infile(file_in, argv[3]) == -1)
+			return -1;
+		if (argc == 5 && strcmp(argv[4], "-") != 0)
+		{
+			if (open_outfile(file_out, argv[4]) == -1)
+				return -1;
+			has_found_file = 1;
+			found_path = argv[4];
+		}
+		return 0;
+	}
+	
+	//! 2.2 校验模式的参数来自每个密文，不接受附加信息；截断会改变口令，不能使用-L
+	if (verify_mode && (argc > 4 || run_option.max_pwd_len > 0))
+	{
+		printf("Usage: ./getcipher verify [-v] [-t thread_num] [-b batch_size] [-u] [-w direct|fsync] [-c checkpoint_file [-C seconds] [--restore]] [--shard k/n] [-m seconds] [--metrics-file prom_file] alg_name pair_file result_file\n");
+		return -1;
+	}
+	//! 2.3 记录中的盐和迭代次数标识跟在口令之后，截断会丢掉它们
+	if (records_mode && run_option.max_pwd_len > 0)
+	{
+		printf("error: -L can not be used with --records!\n");
+		return -1;
+	}
+	
+	//! 3. 打开输入输出文件，不正确报错退出；密文写到标准输出时，其余信息改为输出到标准错误
+	if (strcmp(argv[3], "-") == 0)
+		std::cout.rdbuf(std::cerr.rdbuf());
+	
+    if (open_infile(file_in, argv[2]) == -1)
+		return -1;
+	
+	if (open_outfile(file_out, argv[3]) == -1)
+		return -1;
+	outfile_name = argv[3];
+	//! 4. 处理用户输入的附加信息，salt_charset的[0-9][a-z]处理成09az这种形式
+	for (int i = 4; i < argc; ++i)
+	{
+		std::string error;
+		if (parse_extra_arg(argv[i], extra_name_value, error) != 0)
+		{
+			std::cout << "error: " << error << std::endl;
+			return -1;
+		}
+	}
+	
+	return 0;
+}
+/**
+ *@brief SIGINT/SIGTERM的处理函数，通知流水线停止读取，之后写最后一个检查点
+ */
+static void on_interrupt(int)
+{
+	interrupt_pipeline();
+}
+
+/**
+ *@brief 使用检查点时安装SIGINT/SIGTERM处理函数，再次收到信号时按缺省方式终止
+ */
+static void install_interrupt_handler()
+{
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = on_interrupt;
+	sa.sa_flags = SA_RESETHAND;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+}
+
+/**
+ *@brief main()函数，处理用户输入命令行参数，调用相应加密算法产生密文文件
+ */
+int main(int argc, char **argv)
+{
+	
+	if (parse_cmdline(argc, argv) != 0)
+	{
+		std::cout<<"error: parse_cmdline() is wrong!"<<std::endl;
+		return -1;
+	}
+	
+	//合并模式不需要算法描述
+	if (merge_mode)
+		return merge_shards(merge_argv[0], merge_argv + 1, merge_argc - 1);
+	
+	if (alg_debug)
+	{
+		std::map<std::string, std::string>::iterator it;
+		for (it = extra_name_value.begin(); it != extra_name_value.end(); ++it)
+		{
+			std::cout << "map extra_name_value: key = " << it->first << ", value = " << it->second << std::endl;
+		}
+	}
+	
+	//根据算法名得到算法描述结构体，初始化后按用户输入的附加信息设置当前值
+	std::string error;
+	if (init_named_alg(cur_alg_name, extra_name_value, &cur_alg_desp, error) != 0)
+	{
+		std::cout << "error: " << error << std::endl;
+		return -1;
+	}
+	
+	if (run_option.checkpoint_path != NULL)
+		install_interrupt_handler();
+	
+	//输出管道的读端关闭时由write返回EPIPE，处理完后正常退出，不被SIGPIPE终止
+	signal(SIGPIPE, SIG_IGN);
+	
+	if (metrics_path != NULL && metrics_interval == 0)
+		metrics_interval = DEFAULT_METRICS_INTERVAL;
+	
+	//破解模式：密文自带迭代次数和盐，不使用编译期特化的实现
+	if (crack_mode)
+	{
+		//匹配结果写到标准输出时，其余信息改为输出到标准错误
+		if (!has_found_file)
+			std::cout.rdbuf(std::cerr.rdbuf());
+		if (metrics_interval > 0)
+			metrics_start(metrics_interval, metrics_path);
+		int ret = run_crack(&cur_alg_desp, cipher_path, index_path,
+			mask_text.empty() ? &file_in : NULL, mask_text.empty() ? NULL : &mask_gen,
+			rules_path != NULL ? &rule_set : NULL, has_found_file ? &file_out : NULL, found_path, &run_option);
+		metrics_stop();
+		if (file_in.truncated() > 0)
+			std::cout << "warning: " << file_in.truncated() << " pwd longer than " << file_in.truncated_len() << " bytes are truncated" << std::endl;
+		if (file_in.read_failed())
+		{
+			std::cout << "error: read pwd_file failed!" << std::endl;
+			ret = -1;
+		}
+		file_in.close();
+		if (has_found_file && file_out.close() != 0 && !file_out.broken_pipe())
+		{
+			std::cout << "error: write found_file failed!" << std::endl;
+			ret = -1;
+		}
+		if (ret == 0 && run_option.checkpoint_path != NULL)
+			unlink(run_option.checkpoint_path);    //任务已完成，不再需要检查点
+		return ret;
+	}
+	
+	//没有提供批量盐接口的算法逐个产生盐时，也使用seed作为各线程随机数产生器的种子
+	if (!verify_mode && cur_alg_desp.extra[SEED_INDEX].valid)
+		rng_set_process_seed(cur_alg_desp.extra[SEED_INDEX].cur_value.dlong);
+	
+	//根据附加信息的当前值选择编译期特化的算法实现，之后每条记录不再查表；
+	//校验模式和--records的参数来自每条记录，计算时按每段记录的参数在副本上特化
+	if (!verify_mode && !records_mode && cur_alg_desp.specialize_alg_desp != NULL && cur_alg_desp.specialize_alg_desp(&cur_alg_desp) != 0)
+	{
+		std::cout << "error: specialize_alg_desp() is wrong!" << std::endl;
+		return -1;
+	}
+	
+	//多线程流水线读取口令，计算密文并写入密文文件，校验模式写入校验结果
+	if (metrics_interval > 0)
+		metrics_start(metrics_interval, metrics_path);
+	int ret;
+	if (verify_mode)
+		ret = run_verify(&cur_alg_desp, file_in, file_out, &run_option);
+	else if (records_mode)
+		ret = run_records(&cur_alg_desp, file_in, file_out, &run_option);
+	else
+		ret = run_pipeline(&cur_alg_desp, file_in, file_out, &run_option);
+	metrics_stop();
+	if (file_in.truncated() > 0)
+		std::cout << "warning: " << file_in.truncated() << " pwd longer than " << file_in.truncated_len() << " bytes are truncated" << std::endl;
+	if (file_in.read_failed())
+	{
+		std::cout << "error: read pwd_file failed!" << std::endl;
+		ret = -1;
+	}
+	struct shard_manifest manifest;
+	if (shard_num > 0)
+	{
+		manifest.k = shard_index;
+		manifest.n = shard_num;
+		manifest.alg_name = cur_alg_name;
+		manifest.input_size = file_in.file_size();
+		manifest.byte_begin = file_in.range_begin();
+		manifest.byte_end = file_in.range_end();
+		manifest.line_begin = file_in.count_lines(0, file_in.range_begin());
+		manifest.line_end = manifest.line_begin + file_in.count_lines(file_in.range_begin(), file_in.range_end());
+	}
+	file_in.close();
+	if (file_out.close() != 0 && !file_out.broken_pipe())
+	{
+		std::cout << "error: write cipher_file failed!" << std::endl;
+		ret = -1;
+	}
+	//本片完成后写清单，合并时据此检查；管道(如FIFO)的读端关闭时只输出了一部分密文，不写清单
+	if (file_out.broken_pipe() && shard_num > 0)
+		std::cout << "warning: cipher_file " << outfile_name << " is incomplete, manifest is not written" << std::endl;
+	else if (ret == 0 && shard_num > 0 && write_shard_manifest(outfile_name, &manifest) != 0)
+	{
+		std::cout << "error: write manifest of " << outfile_name << " failed!" << std::endl;
+		ret = -1;
+	}
+	double seconds = file_out.seconds();
+	double io_seconds = file_out.io_seconds();
+	std::cout << "write " << file_out.bytes_written() << " bytes in " << seconds << " s, "
+		<< (seconds > 0 ? file_out.bytes_written() / seconds / (1 << 20) : 0) << " MB/s, io "
+		<< io_seconds << " s, " << (io_seconds > 0 ? file_out.bytes_written() / io_seconds / (1 << 20) : 0) << " MB/s" << std::endl;
+	if (ret == 0 && run_option.checkpoint_path != NULL)
+		unlink(run_option.checkpoint_path);    //任务已完成，不再需要检查点
+	
+	return ret;
+}
@@ -0,0 +1,22 @@
+/**
+ *@file alg_registry.h
+ *@brief 算法名称表和附加信息解析的声明文件，getcipher和libmyjtr共用
+ *@version 0.1
+ */
+#ifndef _ALG_REGISTRY_H
+#define _ALG_REGISTRY_H
+
+#include "extra_info.h"
+#include <string>
+#include <map>
+
+//! 按算法名取得注册的算法描述，未注册的算法返回NULL
+const struct alg_desp *find_alg_desp(const std::string &alg_name);
+
+//! 检查一个"名称=值"形式的附加信息，salt_charset的[x-y]...转换为xy...形式，加入extra_name_value，格式不对返回-1并设置error
+int parse_extra_arg(const std::string &extra_arg, std::map<std::string, std::string> &extra_name_value, std::string &error);
+
+//! 复制alg_name注册的算法描述到desp，初始化并按extra_name_value设置当前值，出错返回-1并设置error
+int init_named_alg(const std::string &alg_name, std::map<std::string, std::string> &extra_name_value, struct alg_desp *desp, std::string &error);
+
+#endif
@@ -0,0 +1,76 @@
+/**
+ *@file batch_arena.h
+ *@brief 每批记录使用的线性分配器声明文件
+ *@version 0.1
+ */
+#ifndef _BATCH_ARENA_H
+#define _BATCH_ARENA_H
+
+#include "bytevector.h"
+#include <stddef.h>
+#include <string.h>
+
+#define ARENA_ALIGN 16                  //缺省对齐字节数，满足SSE加载和md5_mb_lane
+#define ARENA_MIN_BLOCK_SIZE (64 << 10) //新分配的内存块至少64KB
+
+/**
+ *@brief 线性(bump)分配器，一批记录的口令、盐、hash值等都从同一块连续内存中顺序分配，
+ * 处理完一批后reset()整体回收，不逐个释放。
+ * 一块用完时再追加新块，reset()时把所有块合并为一块足够大的内存，之后同样规模的批次只使用一块
+ * 一个分配器只由持有该批次的线程使用，不需要加锁
+ */
+class BatchArena
+{
+	public:
+		explicit BatchArena(size_t block_size = ARENA_MIN_BLOCK_SIZE);
+		~BatchArena();
+
+		//! 分配size字节，按align对齐，align必须是2的幂
+		Byte *alloc(size_t size, size_t align = ARENA_ALIGN)
+		{
+			size_t offset = (head_used + align - 1) & ~(align - 1);
+			if (offset + size > head_size)
+				return alloc_slow(size, align);
+			head_used = offset + size;
+			return head + offset;
+		}
+
+		//! 复制len字节到分配器中，返回指向副本的视图
+		ByteView copy(const Byte *p, int len)
+		{
+			Byte *dst = alloc(len, 1);
+			if (len > 0)
+				memcpy(dst, p, len);
+			return ByteView(dst, len);
+		}
+
+		//! 回收所有分配，之后分配的内存从头开始复用
+		void reset();
+
+		//! 当前已分配的字节数
+		size_t used() const { return retired_used + head_used; }
+
+		//! 占用的内存字节数
+		size_t capacity() const { return retired_size + head_size; }
+
+	private:
+		BatchArena(const BatchArena &);
+		BatchArena& operator= (const BatchArena &);
+
+		Byte *alloc_slow(size_t size, size_t align);
+
+		//! 每块内存的开头保存上一块的地址，形成链表
+		struct block {
+			struct block *prev;
+			size_t size;
+		};
+
+		struct block *head_block;   //当前分配的块
+		Byte *head;                 //当前块的可用区起始地址
+		size_t head_size;           //当前块的可用字节数
+		size_t head_used;           //当前块已分配的字节数
+		size_t retired_size;        //之前各块的可用字节数之和
+		size_t retired_used;        //之前各块已分配的字节数之和
+};
+
+#endif
@@ -0,0 +1,72 @@
+/**
+ *@file bounded_queue.h
+ *@brief 线程间传递数据的有界阻塞队列
+ *@version 0.1
+ */
+#ifndef _BOUNDED_QUEUE_H
+#define _BOUNDED_QUEUE_H
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+/**
+ *@brief 有界阻塞队列，队列满时push阻塞，队列空时pop阻塞
+ * close()之后push失败，pop取完剩余元素后返回false
+ */
+template <typename T>
+class BoundedQueue
+{
+	public:
+		explicit BoundedQueue(int cap) : queue_capacity(cap), closed(false) {}
+
+		//! 放入一个元素，队列已关闭返回false
+		bool push(const T &item)
+		{
+			std::unique_lock<std::mutex> lock(queue_mutex);
+			not_full.wait(lock, [this] { return closed || (int)items.size() < queue_capacity; });
+			if (closed)
+				return false;
+			items.push_back(item);
+			not_empty.notify_one();
+			return true;
+		}
+
+		//! 取出一个元素，队列已关闭并且为空时返回false
+		bool pop(T &item)
+		{
+			std::unique_lock<std::mutex> lock(queue_mutex);
+			not_empty.wait(lock, [this] { return closed || !items.empty(); });
+			if (items.empty())
+				return false;
+			item = items.front();
+			items.pop_front();
+			not_full.notify_one();
+			return true;
+		}
+
+		//! 关闭队列，唤醒所有等待的线程
+		void close()
+		{
+			std::lock_guard<std::mutex> lock(queue_mutex);
+			closed = true;
+			not_empty.notify_all();
+			not_full.notify_all();
+		}
+
+		int size()
+		{
+			std::lock_guard<std::mutex> lock(queue_mutex);
+			return items.size();
+		}
+
+	private:
+		int queue_capacity;
+		bool closed;
+		std::deque<T> items;
+		std::mutex queue_mutex;
+		std::condition_variable not_empty;
+		std::condition_variable not_full;
+};
+
+#endif
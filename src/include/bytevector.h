@@ -8,33 +8,48 @@
 #include <stdint.h>
 #include <iostream>
 #include <string>
+#include <stddef.h>
 
-#define DEFAULT_CAPACITY 64    //default ByteVector capacity
+#define DEFAULT_CAPACITY 48    //内联存储的字节数，盐、摘要和常见口令都不需要堆分配
 typedef unsigned char Byte;
 
+/**
+ *@brief 字节容器，不超过DEFAULT_CAPACITY字节时存放在对象内部的缓冲区中，更长时才在堆上分配。
+ * 支持拷贝和移动，按值返回时不复制堆上的内容
+ */
 class ByteVector
 {
     public:
 	    /*输出运算符<<，因为第一个参数是ostream类型，所以只能重载为友元函数。eg: cout << ByteVector，*/
 	    friend std::ostream& operator<< (std::ostream& os, const ByteVector &bv);
 		
-	    /*Constructor function*/
+	    /*Constructor function，cap不超过DEFAULT_CAPACITY时不分配内存*/
 		ByteVector(int cap = DEFAULT_CAPACITY, int sz = 0);
 		
+		/*从len字节的数组构造*/
+		ByteVector(const Byte *p, int len);
+		
+		/*拷贝构造和移动构造，移动时接管rhs的堆内存*/
+		ByteVector(const ByteVector &rhs);
+		ByteVector(ByteVector &&rhs);
+		
 		/*override the operator [], v[index] ， 单目运算符最好重载为成员函数*/
 		Byte& operator[] (int);
 		
 		Byte& operator[] (int) const;    // const
 		
-		/*override the operator ==, v1 == v2 */
+		/*override the operator ==, v1 == v2，按内容比较 */
 		friend bool operator== (const ByteVector &lhs, const ByteVector &rhs);
 		
 		//== 与 != 运算符应该成对出现
 		friend bool operator!= (const ByteVector &lhs, const ByteVector &rhs);
 		
-		/*override the operator =, v1 = v2 */
+		/*override the operator =, v1 = v2，容量足够时复用已有的存储 */
 		ByteVector& operator= (const ByteVector &);
 		
+		/*移动赋值，rhs在堆上时直接接管 */
+		ByteVector& operator= (ByteVector &&);
+		
 		/*override the operator +, v1 + v2, 双目运算符最好重载为友元函数，赋值运算符=除外 */
 		friend ByteVector operator+ (const ByteVector &lhs, const ByteVector &rhs);
 		
@@ -48,34 +63,71 @@ class ByteVector
 		int capacity() const { return byte_capacity; }
         void resize(int newSize);
 		void reserve(int newCapacity);
+		void clear() { byte_size = 0; }
+		//! 把内容替换为len字节的数组
+		void assign(const Byte *p, int len);
+		//! 在末尾追加len字节的数组
+		void append(const Byte *p, int len);
 		bool isEmpty() const { return byte_size ? false : true; }
 		Byte *getByte_p() const { return byte_p; }
 		
 	private:
+		void release();
+
+		Byte *byte_p;    //element head pointer，指向inline_buf或堆内存
 	    int byte_capacity;
 		int byte_size;
-		Byte *byte_p;    //element head pointer
+		Byte inline_buf[DEFAULT_CAPACITY];
 };
 
-void BV2chararray(char *hash, const ByteVector &bv);
+/**
+ *@brief 不拥有内存的字节视图，算法接口用它引用ByteVector、口令文件映射内存或密文库中的数据，不复制内容。
+ * 视图在所引用的数据释放或改变大小之前有效
+ */
+class ByteView
+{
+	public:
+		ByteView() : view_p(NULL), view_size(0) {}
+		ByteView(const Byte *p, int len) : view_p(p), view_size(len) {}
+		ByteView(const ByteVector &bv) : view_p(bv.getByte_p()), view_size(bv.size()) {}
+
+		int size() const { return view_size; }
+		bool isEmpty() const { return view_size == 0; }
+		const Byte *getByte_p() const { return view_p; }
+		const Byte& operator[] (int index) const { return view_p[index]; }
+
+	private:
+		const Byte *view_p;
+		int view_size;
+};
+
+void BV2chararray(char *hash, const ByteView &bv);
 
 //! 通用的基础函数，实现ByteVector到string的base64编码的转换
-std::string BV2string_base64(const ByteVector &bv);
+std::string BV2string_base64(const ByteView &bv);
 
 //! 实现从ByteVector到string的ASCII编码的转换
-std::string BV2string_raw(const ByteVector &bv);
+std::string BV2string_raw(const ByteView &bv);
 
 //! 通用的基础函数，实现从ASCII可见字符串到ByteVector的转换
 ByteVector string2BV_raw(const std::string &s);
 
+//! 实现从长度为len的字符数组到ByteVector的转换，一次分配、一次复制
+ByteVector chararray2BV_raw(const char *s, int len);
+
 //! 实现从ASCII的字符串到UCS-2的ByteVector的转化
 ByteVector string2BV_UCS2(const std::string &s);
 
 /*构造一个通用的基础函数，实现get_random_bit()*/
 //ByteVector set_random_bit(int bits, const std::string &salt_charset);
 
-//! 通用的基础函数，实现set_random_charset
+struct rng_state;
+
+//! 通用的基础函数，实现set_random_charset，使用当前线程的随机数产生器
 ByteVector set_random_charset(int bits, char *charset, int charset_size);
+
+//! 使用指定的随机数产生器实现set_random_charset
+ByteVector set_random_charset(int bits, char *charset, int charset_size, struct rng_state *rng);
 //! 通用的基础函数，实现MD5
 ByteVector MD5(const ByteVector &pwd);
 
@@ -0,0 +1,40 @@
+/**
+ *@file checkpoint.h
+ *@brief 长时间运行任务的检查点声明文件
+ *@version 0.1
+ */
+#ifndef _CHECKPOINT_H
+#define _CHECKPOINT_H
+
+#include <string>
+
+#define CHECKPOINT_MAGIC "MYJTR_CHECKPOINT 1"    //检查点文件第一行，格式变化时修改
+#define DEFAULT_CHECKPOINT_INTERVAL 60           //缺省每60秒写一次检查点
+#define CHECKPOINT_GENERATE "generate"           //产生密文模式
+#define CHECKPOINT_CRACK "crack"                 //字典破解模式
+#define CHECKPOINT_VERIFY "verify"               //校验模式
+#define CHECKPOINT_RECORDS "records"             //带参数的记录模式
+
+/**
+ *@brief 检查点记录的是按输入顺序已经完成的前缀，恢复时从input_offset继续读取，不重复计算
+ * 产生密文模式：前records条口令的密文都已写入密文文件的前output_bytes字节；
+ * 校验模式、带参数的记录模式与产生密文模式相同，校验模式的密文文件为校验结果文件；
+ * 破解模式：字典中前records个候选口令都已尝试，匹配结果都已写入匹配结果文件的前output_bytes字节
+ */
+struct checkpoint {
+	std::string mode;         //CHECKPOINT_GENERATE、CHECKPOINT_CRACK、CHECKPOINT_VERIFY或CHECKPOINT_RECORDS
+	std::string alg_name;
+	long long input_size;     //口令文件(破解模式为字典文件)的字节数，恢复时必须相同
+	long long input_offset;   //已完成的口令在口令文件中的结束偏移
+	long long records;        //已完成的口令个数
+	long long output_bytes;   //密文文件(破解模式为匹配结果文件)中已完成部分的字节数
+	long long found;          //破解模式写检查点时已破解的密文个数
+};
+
+//! 写检查点，先写临时文件并fsync，再改名为path，任何时候path都是一个完整的检查点
+int save_checkpoint(const char *path, const struct checkpoint *ckpt);
+
+//! 读取检查点
+int load_checkpoint(const char *path, struct checkpoint *ckpt);
+
+#endif
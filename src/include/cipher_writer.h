@@ -0,0 +1,82 @@
+/**
+ *@file cipher_writer.h
+ *@brief 大块缓冲的密文文件写入声明文件
+ *@version 0.1
+ */
+#ifndef _CIPHER_WRITER_H
+#define _CIPHER_WRITER_H
+
+#include <stddef.h>
+#include <sys/time.h>
+
+#define DEFAULT_WRITE_BUFFER_SIZE (4 << 20)    //缺省写缓冲区4MB
+#define STREAM_WRITE_BUFFER_SIZE (64 << 10)    //写到标准输出时缓冲区64KB，与管道容量相当，读端关闭后尽快发现
+#define WRITE_ALIGN 4096                       //O_DIRECT要求的地址和长度对齐
+
+#define WRITER_DIRECT 0x1    //以O_DIRECT方式写入，绕过页缓存
+#define WRITER_FSYNC 0x2     //关闭文件前fsync
+#define WRITER_APPEND 0x4    //不截断，从文件末尾继续写，用于从检查点恢复
+
+/**
+ *@brief 密文文件写入器
+ * 密文先复制到对齐的大缓冲区，缓冲区满时用一次write/writev写出，
+ * 取代每行一次std::endl刷新，写入的内容与逐行写入完全相同
+ * 路径为"-"时写到标准输出，读端关闭(EPIPE)时写入失败并记录，由调用者正常结束
+ */
+class CipherWriter
+{
+	public:
+		CipherWriter();
+		~CipherWriter();
+
+		//! 以截断方式打开文件，"-"表示标准输出，flags为WRITER_DIRECT | WRITER_FSYNC | WRITER_APPEND的组合
+		int open(const char *path, int flags = 0, size_t buffer_size = DEFAULT_WRITE_BUFFER_SIZE);
+
+		//! 追加len字节，缓冲区满时写出
+		int write(const char *data, size_t len);
+
+		//! 写出缓冲区中所有数据
+		int flush();
+
+		//! 写出缓冲区中所有数据并fdatasync，之后文件中包含到目前为止追加的所有数据
+		int sync();
+		//! 写出剩余数据，按策略fsync后关闭文件
+		int close();
+
+		bool is_open() const { return fd >= 0; }
+
+		//! 写入失败是因为管道的读端已经关闭
+		bool broken_pipe() const { return pipe_closed; }
+
+		//! 已经交给内核的字节数
+		long long bytes_written() const { return total_bytes; }
+		//! 到目前为止追加的数据在文件中的结束偏移，包括打开前文件中已有的数据
+		long long offset() const { return start_offset + total_bytes + used; }
+
+		//! 从打开到现在(或到关闭)的秒数
+		double seconds() const;
+
+		//! 花在write/writev/fsync系统调用上的秒数
+		double io_seconds() const { return io_time; }
+
+	private:
+		CipherWriter(const CipherWriter &);
+		CipherWriter& operator= (const CipherWriter &);
+
+		int write_all(const char *data, size_t len);
+		void add_io_time(const struct timeval &begin);
+
+		int fd;
+		int writer_flags;
+		bool pipe_closed;      //write返回过EPIPE
+		char *buffer;          //WRITE_ALIGN对齐的写缓冲区
+		size_t buffer_size;
+		size_t used;           //缓冲区中尚未写出的字节数
+		long long total_bytes;
+		long long start_offset;    //打开时第一次写入的文件偏移，WRITER_APPEND时不为0
+		double io_time;
+		struct timeval start_time;
+		struct timeval end_time;
+};
+
+#endif
@@ -1,18 +1,54 @@
-/**
- *@file common.h
- *@brief 共各种算法使用的通用函数声明
- *@version 0.1
- */
-
-#ifndef _COMMON_H
-#define _COMMON_H
-#include <string>
-//! wordpress算法base64加密算法的字符集声明
-extern unsigned char base64Char2[65];    //wordpress
-
-//! base64加密算法声明
-void encode64(const unsigned char *hash, int count, unsigned char *base64Code);
-//! md5加密算法声明
-void md5(unsigned char*hash, const std::string &pwd);
-
+/**
+ *@file common.h
+ *@brief 共各种算法使用的通用函数声明
+ *@version 0.1
+ */
+
+#ifndef _COMMON_H
+#define _COMMON_H
+#include <string>
+#include <stdint.h>
+
+#define MD5_BLOCK_SIZE 64           //MD5分组字节数
+#define MD5_DIGEST_SIZE 16          //MD5摘要字节数
+#define MD5_CHAIN_STACK_BLOCKS 8    //md5_chain在栈上保存的最大分组数，超过时在堆上分配一次
+
+/**
+ *@brief MD5链式迭代引擎，反复计算 digest = MD5(digest || pwd)
+ * 初始化时一次性构造好 16字节摘要 + pwd 的填充后的消息分组，
+ * 每轮只改写前16字节(前4个字)并原地执行压缩函数，迭代过程没有任何内存分配
+ */
+struct md5_chain {
+	uint32_t *words;    //填充后的消息，按小端解码为32位字，共16 * nblocks个
+	int nblocks;        //消息分组个数，pwd不超过39字节时为1
+	uint32_t stack_words[16 * MD5_CHAIN_STACK_BLOCKS];
+};
+
+//! wordpress算法base64加密算法的字符集声明
+extern unsigned char base64Char2[65];    //wordpress
+
+//! base64加密算法声明
+void encode64(const unsigned char *hash, int count, unsigned char *base64Code);
+//! 16字节MD5摘要编码为22个base64字符的向量化实现
+void encode64_md5(const unsigned char *hash, unsigned char *base64Code);
+//! base64解码算法声明，encode64的逆过程
+int decode64(const unsigned char *base64Code, int count, unsigned char *hash);
+//! 22个base64字符解码为16字节MD5摘要的向量化实现
+int decode64_md5(const unsigned char *base64Code, unsigned char *hash);
+//! md5加密算法声明
+void md5(unsigned char*hash, const std::string &pwd);
+//! 两段数据拼接后的md5，不需要先拼接成一个字符串
+void md5_concat(unsigned char *hash, const unsigned char *a, int alen, const unsigned char *b, int blen);
+//! MD5压缩函数，对16个字的消息分组更新state
+void md5_compress(uint32_t state[4], const uint32_t block[16]);
+//! 16字节摘要与4个小端32位字之间的转换
+void md5_bytes2words(uint32_t words[4], const unsigned char *bytes);
+void md5_words2bytes(unsigned char *bytes, const uint32_t words[4]);
+//! 初始化MD5链式迭代引擎
+int md5_chain_init(struct md5_chain *chain, const unsigned char *pwd, int pwd_len);
+//! 执行count轮 digest = MD5(digest || pwd)
+void md5_chain_iterate(struct md5_chain *chain, uint32_t digest[4], uint32_t count);
+//! 释放MD5链式迭代引擎在堆上分配的消息
+void md5_chain_free(struct md5_chain *chain);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,19 @@
+/**
+ *@file crack.h
+ *@brief 字典破解模式声明文件
+ *@version 0.1
+ */
+#ifndef _CRACK_H
+#define _CRACK_H
+
+#include "extra_info.h"
+#include "pwd_reader.h"
+#include "cipher_writer.h"
+#include "pipeline.h"
+#include "mask.h"
+#include "rules.h"
+
+//! 读取密文文件和字典文件(或使用掩码产生候选口令)，多线程计算每个候选口令在每个不同盐下的hash值，输出匹配的密文和口令
+int run_crack(struct alg_desp *desp, const char *cipher_path, const char *index_path, PwdReader *pwd_in, MaskGenerator *mask, const RuleSet *rules, CipherWriter *found_out, const char *found_path, const struct pipeline_option *option);
+
+#endif
@@ -1,79 +1,141 @@
-/**
- *@file extra_info.h
- *@brief 各种算法附加信息基础函数声明文件
- *@version 0.1
- */
-#ifndef _EXTRA_INFO_H
-#define _EXTRA_INFO_H
-
-#include "bytevector.h"
-#include <string>
-#include <vector>
-#include <map>
-
-#define SALT_LEN_INDEX 0
-#define ITER_POS_INDEX 1    //迭代次数标识
-#define PWD_LEN_INDEX 2
-#define SALT_CHARSET_INDEX 3
-
-union extra_data {    //附加信息数值类型
-	char dchar[32];
-	int dint;
-};
-
-/**
- *@brief 附加信息结构体
- */
-struct extra_info {    //附加信息
-	int valid;    //1:有效， 0：无效
-	std::string extra_name;    //附加信息名称
-	union extra_data def_value;    //命令行的参数默认缺省值
-	union extra_data cur_value;    //命令行设定的参数当前值
-	int optionvalue;    //指示当前values有多少个效值
-	union extra_data values[8];    //一个附加信息名称最多有8个可选值
-	union extra_data min_value;    //最小值
-	union extra_data max_value;    //最大值
-};
-
-/**
- *@brief 每一个算法都由一个struct alg_desp结构定义
- * 包括一系列函数指针以及算法名称和附加信息数组
- */
-struct alg_desp {
-	
-	//! 初始化当前的算法描述
-	int (*init_alg_desp)(struct extra_info *extra);    
-	
-	//! 再次检查用户输入的信息，设置算法描述的当前值
-	int (*check_cmdline)(struct extra_info *extra, std::map<std::string, std::string> &extra_name_value);    
-	
-	//! 产生salt_len_in_bit位随机盐
-	ByteVector (*get_random_salt)(struct extra_info *extra);     
-	
-	//! 对pwd进行预处理，例如ASCII码到UCS2的转换    
-	ByteVector (*prepare_pwd)(std::string &pwd);
-	
-	//! 根据pwd,salt，附加信息产生hash值
-	ByteVector (*hash_pwd)(ByteVector &pwd, ByteVector &salt, struct extra_info *extra);  
-
-	//! 根据hash,salt,附加信息产生符合hashcat规范的密文字符串
-	std::string (*get_cipher)(ByteVector &hash, ByteVector &salt, struct extra_info *extra);	
-	//! 算法名称
-	std::string alg_name;  
-	//! 最多32个有效信息	
-	struct extra_info extra[32];    
-};
-
-//! 清除extra的所有有效位
-int clear_extra_valid(struct extra_info *extra);
-
-//! 设置当前算法描述结构体的extra数组的extra_index位置的默认附加信息，该附加信息的值是整形数组	
-int set_extra_intarray(struct extra_info *extra, int extra_index, const std::string&extra_name, std::vector<int> intarray);
-
-//! 附加信息的值是字符数组
-int set_extra_chararray(struct extra_info *extra, int extra_index, const std::string&extra_name, const std::string &chararray);
-
-//! 根据extra设置算法的全局的字符集
-int expand_charset(char *charset, struct extra_info *extra, int subcharset_size);
-
+/**
+ *@file extra_info.h
+ *@brief 各种算法附加信息基础函数声明文件
+ *@version 0.1
+ */
+#ifndef _EXTRA_INFO_H
+#define _EXTRA_INFO_H
+
+#include "bytevector.h"
+#include "batch_arena.h"
+#include <string>
+#include <vector>
+#include <map>
+
+#define SALT_LEN_INDEX 0
+#define ITER_POS_INDEX 1    //迭代次数标识
+#define PWD_LEN_INDEX 2
+#define SALT_CHARSET_INDEX 3
+#define SEED_INDEX 4         //随机盐种子
+#define SALT_MODE_INDEX 5    //随机盐产生方式，RNG_MODE_STREAM或RNG_MODE_INDEX
+
+#define CIPHER_MAX_SALT 32    //parse_cipher输出盐的最大字节数
+#define CIPHER_MAX_HASH 64    //parse_cipher输出hash值的最大字节数
+#define CIPHER_MAX_PARAMS 8   //密文自带参数的最大个数
+
+union extra_data {    //附加信息数值类型
+	char dchar[32];
+	int dint;
+	long long dlong;
+};
+
+/**
+ *@brief 附加信息结构体
+ */
+struct extra_info {    //附加信息
+	int valid;    //1:有效， 0：无效
+	std::string extra_name;    //附加信息名称
+	union extra_data def_value;    //命令行的参数默认缺省值
+	union extra_data cur_value;    //命令行设定的参数当前值
+	int optionvalue;    //指示当前values有多少个效值
+	union extra_data values[8];    //一个附加信息名称最多有8个可选值
+	union extra_data min_value;    //最小值
+	union extra_data max_value;    //最大值
+};
+
+/**
+ *@brief 每一个算法都由一个struct alg_desp结构定义
+ * 包括一系列函数指针以及算法名称和附加信息数组
+ */
+struct alg_desp {
+	
+	//! 初始化当前的算法描述
+	int (*init_alg_desp)(struct extra_info *extra);    
+	
+	//! 再次检查用户输入的信息，设置算法描述的当前值
+	int (*check_cmdline)(struct extra_info *extra, std::map<std::string, std::string> &extra_name_value);    
+	
+	//! 产生salt_len_in_bit位随机盐
+	ByteVector (*get_random_salt)(struct extra_info *extra);     
+	
+	//! 对pwd进行预处理，例如ASCII码到UCS2的转换    
+	ByteVector (*prepare_pwd)(const char *pwd, int pwd_len);
+	
+	//! 根据pwd,salt，附加信息产生hash值
+	ByteVector (*hash_pwd)(ByteView pwd, ByteView salt, struct extra_info *extra);  
+
+	//! 根据hash,salt,附加信息产生符合hashcat规范的密文字符串
+	std::string (*get_cipher)(ByteView hash, ByteView salt, struct extra_info *extra);	
+
+	/*
+	 * 批量接口：一次处理连续数组中的n条记录，以便分摊每条记录的开销或交给向量内核。
+	 * 都可以为NULL，此时由alg_*_batch()逐条调用上面对应的单条接口。
+	 * 输入用ByteView视图传递，可以直接引用口令文件映射内存或密文库中的数据，不复制；
+	 * 输出的盐和hash值从本批的分配器arena中分配，视图在arena.reset()之前有效
+	 */
+	//! 批量产生n个随机盐，first_index为第一个盐对应记录的序号
+	int (*get_random_salt_batch)(ByteView *salt, int n, long long first_index, BatchArena &arena, struct extra_info *extra);
+
+	//! 批量根据n个pwd,salt产生hash值
+	int (*hash_pwd_batch)(const ByteView *pwd, const ByteView *salt, ByteView *hash, int n, BatchArena &arena, struct extra_info *extra);
+
+	//! 批量产生n个密文字符串，每个密文后加'\n'追加到out中
+	int (*get_cipher_batch)(const ByteView *hash, const ByteView *salt, int n, struct extra_info *extra, std::string &out);
+
+	//! check_cmdline之后调用一次，根据附加信息的当前值把批量接口换成编译期特化的实现，可以为NULL
+	int (*specialize_alg_desp)(struct alg_desp *desp);
+
+	//! 解析一个密文字符串得到salt和hash值，密文自带的参数(如迭代次数)写入extra的当前值，不支持破解模式的算法为NULL
+	//! salt、hash由调用者提供，分别至少CIPHER_MAX_SALT、CIPHER_MAX_HASH字节，加载大量密文时不分配内存
+	int (*parse_cipher)(const char *cipher, int cipher_len, unsigned char *salt, int &salt_len, unsigned char *hash, int &hash_len, struct extra_info *extra);
+
+	//! 密文自带的参数，即parse_cipher写入当前值的附加信息在extra中的下标，破解模式按这些参数把密文分段；
+	//! seed、salt_mode等只属于本次运行的附加信息不在其中，按参数保存的索引文件在以后的运行中仍然可以使用
+	int cipher_param_num;
+	int cipher_params[CIPHER_MAX_PARAMS];
+
+	//! 估计一条记录的计算代价(MD5压缩次数)，params为按cipher_params顺序的参数值，用于按代价切分任务；
+	//! 为NULL时按一次MD5(口令)估计
+	long long (*estimate_cost)(int pwd_len, const union extra_data *params);
+
+	//! 检查--records一行中的盐和参数字段(如迭代次数标识，可以为空)，params为按cipher_params顺序的参数值，
+	//! 调用前为命令行的当前值，由本行的盐长度和参数覆盖；为NULL时记录只能有口令，参数都使用命令行的当前值
+	int (*parse_record_params)(int salt_len, const char *field, int len, const struct extra_info *extra, union extra_data *params);
+
+	//! 算法名称
+	std::string alg_name;  
+	//! 最多32个有效信息	
+	struct extra_info extra[32];    
+};
+
+//! 非0时各算法输出盐和密文等调试信息，由命令行-v打开，缺省关闭
+extern int alg_debug;
+
+//! 清除extra的所有有效位
+int clear_extra_valid(struct extra_info *extra);
+
+//! 设置当前算法描述结构体的extra数组的extra_index位置的默认附加信息，该附加信息的值是整形数组	
+int set_extra_intarray(struct extra_info *extra, int extra_index, const std::string&extra_name, std::vector<int> intarray);
+
+//! 附加信息的值是字符数组
+int set_extra_chararray(struct extra_info *extra, int extra_index, const std::string&extra_name, const std::string &chararray);
+
+//! 批量产生n个随机盐，算法没有提供批量接口时逐个调用get_random_salt
+int alg_get_random_salt_batch(struct alg_desp *desp, ByteView *salt, int n, long long first_index, BatchArena &arena);
+
+//! 批量计算n个hash值，算法没有提供批量接口时逐个调用hash_pwd
+int alg_hash_pwd_batch(struct alg_desp *desp, const ByteView *pwd, const ByteView *salt, ByteView *hash, int n, BatchArena &arena);
+
+//! 批量产生n个密文并追加到out中，算法没有提供批量接口时逐个调用get_cipher
+int alg_get_cipher_batch(struct alg_desp *desp, const ByteView *hash, const ByteView *salt, int n, std::string &out);
+
+//! 设置所有算法共用的随机盐附加信息seed、salt_mode的缺省值
+int set_extra_random(struct extra_info *extra);
+
+//! 处理附加信息seed、salt_mode，返回1表示已处理，0表示不是这两个名称，-1表示出错
+int check_extra_random(struct extra_info *extra, const std::string &extra_name, const std::string &extra_value);
+
+//! 根据extra展开算法的字符集，charset至少256字节
+int expand_charset(char *charset, struct extra_info *extra, int subcharset_size);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,70 @@
+/**
+ *@file mask.h
+ *@brief 破解模式的掩码候选口令产生器声明文件
+ *@version 0.1
+ */
+#ifndef _MASK_H
+#define _MASK_H
+
+#include "batch_arena.h"
+#include <string>
+#include <vector>
+
+#define MASK_MAX_LEN 64          //掩码展开后口令的最大长度
+#define MASK_CUSTOM_NUM 4        //自定义字符集?1..?4的个数
+
+/**
+ *@brief 掩码候选口令产生器
+ * 掩码的每个位置是一个字符集：?l小写字母，?u大写字母，?d数字，?s特殊字符，?a前四者之和，
+ * ?1..?4为自定义字符集，??为'?'本身，[x-y]为一段连续字符，其他字符原样出现。
+ * 自定义字符集使用与salt_charset相同的[a-z][0-9]语法，各段合并去重。
+ * 口令空间按下标编号，最后一个位置变化最快；产生器按下标范围[begin, end)顺序产生，
+ * 当前口令保存在一个缓冲区中，每产生一个只改写变化的位置，再整体复制到批次的arena中，不经过字符串
+ */
+class MaskGenerator
+{
+	public:
+		MaskGenerator();
+
+		//! 解析掩码，custom为?1..?4的定义，空字符串表示未定义，出错返回-1并设置error()
+		int parse(const std::string &mask, const std::string *custom);
+
+		//! 口令空间的大小
+		unsigned long long keyspace() const { return total; }
+		//! 口令长度
+		int length() const { return (int)sets.size(); }
+		//! 出错原因
+		const std::string &error() const { return error_msg; }
+
+		//! 只产生下标在[begin, end)中的口令
+		int set_range(unsigned long long begin, unsigned long long end);
+		//! 只产生第k段(共n段，k从1开始)口令，按下标均分口令空间
+		int shard(int k, int n);
+		//! 下一个口令从下标index开始，index必须在当前范围中
+		int seek(unsigned long long index);
+
+		//! 产生最多n个口令，写入arena，返回个数，小于n表示范围已经产生完
+		int generate(BatchArena &arena, const char **pwd, int *len, int n);
+
+		//! 下一个口令的下标，即已产生的口令之后的位置
+		unsigned long long offset() const { return pos; }
+		unsigned long long range_begin() const { return begin_pos; }
+		unsigned long long range_end() const { return end_pos; }
+
+	private:
+		void set_position(unsigned long long index);
+
+		std::vector<std::string> sets;    //每个位置的字符集
+		std::vector<int> digit;           //当前口令每个位置在字符集中的下标
+		char current[MASK_MAX_LEN];       //当前口令
+		unsigned long long total;
+		unsigned long long pos;
+		unsigned long long begin_pos;
+		unsigned long long end_pos;
+		std::string error_msg;
+};
+
+//! 把[a-z][0-9]形式的字符集展开为字符串，按出现顺序去重，格式错误返回-1
+int parse_mask_charset(const std::string &spec, std::string &chars);
+
+#endif
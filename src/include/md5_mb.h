@@ -0,0 +1,61 @@
+/**
+ *@file md5_mb.h
+ *@brief 多缓冲(multi-buffer) MD5链式迭代声明文件
+ *
+ * 一条 digest = MD5(digest || pwd) 迭代链内部无法并行，但不同口令的链互相独立，
+ * 多缓冲内核把4/8/16条链放在向量寄存器的不同通道中同步推进。
+ * 启动时根据CPUID选择SSE2、AVX2或AVX-512内核
+ *@version 0.1
+ */
+#ifndef _MD5_MB_H
+#define _MD5_MB_H
+
+#include <stdint.h>
+
+#define MD5_MB_MAX_LANES 16    //内核最大通道数(AVX-512)
+#define MD5_MB_MAX_BLOCKS 4    //向量内核支持的最大消息分组数，即口令不超过231字节
+#define MD5_MB_FIXED_MIN_LOG2 11    //编译期特化内核的最小迭代轮数2^11，即iter_pos为'9'
+#define MD5_MB_FIXED_NUM 4          //编译期特化内核个数，迭代轮数2^11..2^14，即iter_pos为'9' 'A' 'B' 'C'
+
+/**
+ *@brief 一条MD5迭代链
+ */
+struct md5_mb_lane {
+	const unsigned char *pwd;    //口令
+	int pwd_len;                 //口令字节数
+	uint32_t digest[4];          //输入为初始摘要，输出为迭代后的摘要，小端32位字
+};
+
+//! 对n条独立的链各执行count轮 digest = MD5(digest || pwd)
+void md5_mb_chain_iterate(struct md5_mb_lane *lanes, int n, uint32_t count);
+
+//! 迭代轮数为编译期常量2^LOG2的md5_mb_chain_iterate，直接调用特化的内核，LOG2为11..14(见MD5_MB_FIXED_NUM)
+template <int LOG2>
+void md5_mb_chain_iterate_fixed(struct md5_mb_lane *lanes, int n);
+
+//! 当前选择的内核名称：avx512、avx2、sse2或scalar
+const char *md5_mb_kernel_name();
+
+//! 当前选择的内核通道数，scalar内核为1
+int md5_mb_kernel_lanes();
+
+//! 编译进来的内核个数，包括scalar
+int md5_mb_kernel_num();
+
+//! 第i个内核的名称，0 <= i < md5_mb_kernel_num()
+const char *md5_mb_kernel_name_at(int i);
+
+//! 用第i个内核执行md5_mb_chain_iterate，CPU不支持该内核时返回-1
+int md5_mb_chain_iterate_kernel(int i, struct md5_mb_lane *lanes, int n, uint32_t count);
+
+//各指令集内核，参数含义见md5_mb_impl.h中的md5_mb_iterate()
+typedef void (*md5_mb_iterate_fn)(const uint32_t *msg, const uint32_t *last_mask, int nblocks, uint32_t *digest, uint32_t count);
+void md5_mb_iterate_sse2(const uint32_t *msg, const uint32_t *last_mask, int nblocks, uint32_t *digest, uint32_t count);
+void md5_mb_iterate_avx2(const uint32_t *msg, const uint32_t *last_mask, int nblocks, uint32_t *digest, uint32_t count);
+void md5_mb_iterate_avx512(const uint32_t *msg, const uint32_t *last_mask, int nblocks, uint32_t *digest, uint32_t count);
+//各指令集迭代轮数为编译期常量的内核，下标为log2(迭代轮数) - MD5_MB_FIXED_MIN_LOG2
+extern const md5_mb_iterate_fn md5_mb_fixed_sse2[MD5_MB_FIXED_NUM];
+extern const md5_mb_iterate_fn md5_mb_fixed_avx2[MD5_MB_FIXED_NUM];
+extern const md5_mb_iterate_fn md5_mb_fixed_avx512[MD5_MB_FIXED_NUM];
+
+#endif
@@ -0,0 +1,209 @@
+/**
+ *@file md5_mb_impl.h
+ *@brief 多缓冲MD5链式迭代的通用实现，由各指令集的实现文件以不同的向量类型实例化
+ *
+ * 只能被md5_mb_sse2.cpp、md5_mb_avx2.cpp、md5_mb_avx512.cpp包含，
+ * 每个实现文件用自己的编译选项(-mavx2等)编译，模板都在匿名命名空间中，不会跨文件合并
+ *@version 0.1
+ */
+#ifndef _MD5_MB_IMPL_H
+#define _MD5_MB_IMPL_H
+
+#include <stdint.h>
+
+namespace {
+
+/**
+ *@brief 向量类型V需要提供：
+ *   vec                   向量类型，每个32位通道对应一条MD5链
+ *   LANES                 通道数
+ *   set1/load/store       广播、非对齐读写
+ *   add/band/bor/bandnot  32位加法与位运算，bandnot(a, b) = ~a & b
+ *   F/G/H/I               MD5的四个基本函数
+ *   rotl<s>               循环左移
+ */
+#define MD5_MB_STEP(f, a, b, c, d, m, t, s) \
+	a = V::add(a, V::add(V::f(b, c, d), V::add(m, V::set1(t)))); \
+	a = V::add(V::template rotl<s>(a), b);
+
+/**
+ *@brief 对LANES条链同时执行一次MD5压缩
+ *@param state 4个状态向量，输入为压缩前状态，输出为压缩后状态
+ *@param m 16个消息向量
+ */
+template <class V>
+inline void md5_mb_compress(typename V::vec state[4], const typename V::vec m[16])
+{
+	typename V::vec a = state[0], b = state[1], c = state[2], d = state[3];
+
+	MD5_MB_STEP(F, a, b, c, d, m[0], 0xd76aa478, 7)
+	MD5_MB_STEP(F, d, a, b, c, m[1], 0xe8c7b756, 12)
+	MD5_MB_STEP(F, c, d, a, b, m[2], 0x242070db, 17)
+	MD5_MB_STEP(F, b, c, d, a, m[3], 0xc1bdceee, 22)
+	MD5_MB_STEP(F, a, b, c, d, m[4], 0xf57c0faf, 7)
+	MD5_MB_STEP(F, d, a, b, c, m[5], 0x4787c62a, 12)
+	MD5_MB_STEP(F, c, d, a, b, m[6], 0xa8304613, 17)
+	MD5_MB_STEP(F, b, c, d, a, m[7], 0xfd469501, 22)
+	MD5_MB_STEP(F, a, b, c, d, m[8], 0x698098d8, 7)
+	MD5_MB_STEP(F, d, a, b, c, m[9], 0x8b44f7af, 12)
+	MD5_MB_STEP(F, c, d, a, b, m[10], 0xffff5bb1, 17)
+	MD5_MB_STEP(F, b, c, d, a, m[11], 0x895cd7be, 22)
+	MD5_MB_STEP(F, a, b, c, d, m[12], 0x6b901122, 7)
+	MD5_MB_STEP(F, d, a, b, c, m[13], 0xfd987193, 12)
+	MD5_MB_STEP(F, c, d, a, b, m[14], 0xa679438e, 17)
+	MD5_MB_STEP(F, b, c, d, a, m[15], 0x49b40821, 22)
+
+	MD5_MB_STEP(G, a, b, c, d, m[1], 0xf61e2562, 5)
+	MD5_MB_STEP(G, d, a, b, c, m[6], 0xc040b340, 9)
+	MD5_MB_STEP(G, c, d, a, b, m[11], 0x265e5a51, 14)
+	MD5_MB_STEP(G, b, c, d, a, m[0], 0xe9b6c7aa, 20)
+	MD5_MB_STEP(G, a, b, c, d, m[5], 0xd62f105d, 5)
+	MD5_MB_STEP(G, d, a, b, c, m[10], 0x02441453, 9)
+	MD5_MB_STEP(G, c, d, a, b, m[15], 0xd8a1e681, 14)
+	MD5_MB_STEP(G, b, c, d, a, m[4], 0xe7d3fbc8, 20)
+	MD5_MB_STEP(G, a, b, c, d, m[9], 0x21e1cde6, 5)
+	MD5_MB_STEP(G, d, a, b, c, m[14], 0xc33707d6, 9)
+	MD5_MB_STEP(G, c, d, a, b, m[3], 0xf4d50d87, 14)
+	MD5_MB_STEP(G, b, c, d, a, m[8], 0x455a14ed, 20)
+	MD5_MB_STEP(G, a, b, c, d, m[13], 0xa9e3e905, 5)
+	MD5_MB_STEP(G, d, a, b, c, m[2], 0xfcefa3f8, 9)
+	MD5_MB_STEP(G, c, d, a, b, m[7], 0x676f02d9, 14)
+	MD5_MB_STEP(G, b, c, d, a, m[12], 0x8d2a4c8a, 20)
+
+	MD5_MB_STEP(H, a, b, c, d, m[5], 0xfffa3942, 4)
+	MD5_MB_STEP(H, d, a, b, c, m[8], 0x8771f681, 11)
+	MD5_MB_STEP(H, c, d, a, b, m[11], 0x6d9d6122, 16)
+	MD5_MB_STEP(H, b, c, d, a, m[14], 0xfde5380c, 23)
+	MD5_MB_STEP(H, a, b, c, d, m[1], 0xa4beea44, 4)
+	MD5_MB_STEP(H, d, a, b, c, m[4], 0x4bdecfa9, 11)
+	MD5_MB_STEP(H, c, d, a, b, m[7], 0xf6bb4b60, 16)
+	MD5_MB_STEP(H, b, c, d, a, m[10], 0xbebfbc70, 23)
+	MD5_MB_STEP(H, a, b, c, d, m[13], 0x289b7ec6, 4)
+	MD5_MB_STEP(H, d, a, b, c, m[0], 0xeaa127fa, 11)
+	MD5_MB_STEP(H, c, d, a, b, m[3], 0xd4ef3085, 16)
+	MD5_MB_STEP(H, b, c, d, a, m[6], 0x04881d05, 23)
+	MD5_MB_STEP(H, a, b, c, d, m[9], 0xd9d4d039, 4)
+	MD5_MB_STEP(H, d, a, b, c, m[12], 0xe6db99e5, 11)
+	MD5_MB_STEP(H, c, d, a, b, m[15], 0x1fa27cf8, 16)
+	MD5_MB_STEP(H, b, c, d, a, m[2], 0xc4ac5665, 23)
+
+	MD5_MB_STEP(I, a, b, c, d, m[0], 0xf4292244, 6)
+	MD5_MB_STEP(I, d, a, b, c, m[7], 0x432aff97, 10)
+	MD5_MB_STEP(I, c, d, a, b, m[14], 0xab9423a7, 15)
+	MD5_MB_STEP(I, b, c, d, a, m[5], 0xfc93a039, 21)
+	MD5_MB_STEP(I, a, b, c, d, m[12], 0x655b59c3, 6)
+	MD5_MB_STEP(I, d, a, b, c, m[3], 0x8f0ccc92, 10)
+	MD5_MB_STEP(I, c, d, a, b, m[10], 0xffeff47d, 15)
+	MD5_MB_STEP(I, b, c, d, a, m[1], 0x85845dd1, 21)
+	MD5_MB_STEP(I, a, b, c, d, m[8], 0x6fa87e4f, 6)
+	MD5_MB_STEP(I, d, a, b, c, m[15], 0xfe2ce6e0, 10)
+	MD5_MB_STEP(I, c, d, a, b, m[6], 0xa3014314, 15)
+	MD5_MB_STEP(I, b, c, d, a, m[13], 0x4e0811a1, 21)
+	MD5_MB_STEP(I, a, b, c, d, m[4], 0xf7537e82, 6)
+	MD5_MB_STEP(I, d, a, b, c, m[11], 0xbd3af235, 10)
+	MD5_MB_STEP(I, c, d, a, b, m[2], 0x2ad7d2bb, 15)
+	MD5_MB_STEP(I, b, c, d, a, m[9], 0xeb86d391, 21)
+
+	state[0] = V::add(state[0], a);
+	state[1] = V::add(state[1], b);
+	state[2] = V::add(state[2], c);
+	state[3] = V::add(state[3], d);
+}
+
+/**
+ *@brief LANES条链同时执行count轮 digest = MD5(digest || pwd)
+ * COUNT不为0时迭代轮数是编译期常量，忽略参数count，用于常用的iter_pos(9 A B C)
+ *@param msg 交织存放的填充消息，msg[(blk * 16 + word) * LANES + lane]，每轮改写第0个分组的前4个字
+ *@param last_mask 交织存放的掩码，last_mask[blk * LANES + lane]为全1表示该通道的消息在第blk个分组结束
+ *@param nblocks 各通道中最多的分组数
+ *@param digest 交织存放的摘要，digest[word * LANES + lane]，输入为初始摘要，输出为迭代后的摘要
+ *@param count 迭代轮数
+ */
+template <class V, uint32_t COUNT>
+void md5_mb_iterate(const uint32_t *msg, const uint32_t *last_mask, int nblocks, uint32_t *digest, uint32_t count)
+{
+	typedef typename V::vec vec;
+	if (COUNT != 0)
+		count = COUNT;
+	const int W = V::LANES;
+	vec res[4], state[4], m[16];
+
+	for (int i = 0; i < 4; ++i)
+		res[i] = V::load(digest + i * W);
+
+	//! 1. 所有通道都只有一个分组：消息后12个字在整个迭代过程中不变，只需加载一次
+	if (nblocks == 1)
+	{
+		for (int i = 4; i < 16; ++i)
+			m[i] = V::load(msg + i * W);
+		while (count--)
+		{
+			m[0] = res[0];
+			m[1] = res[1];
+			m[2] = res[2];
+			m[3] = res[3];
+			state[0] = V::set1(0x67452301);
+			state[1] = V::set1(0xefcdab89);
+			state[2] = V::set1(0x98badcfe);
+			state[3] = V::set1(0x10325476);
+			md5_mb_compress<V>(state, m);
+			res[0] = state[0];
+			res[1] = state[1];
+			res[2] = state[2];
+			res[3] = state[3];
+		}
+	}
+	//! 2. 多分组：各通道分组数不同时，按掩码取每个通道最后一个分组之后的状态
+	else
+	{
+		while (count--)
+		{
+			state[0] = V::set1(0x67452301);
+			state[1] = V::set1(0xefcdab89);
+			state[2] = V::set1(0x98badcfe);
+			state[3] = V::set1(0x10325476);
+			for (int blk = 0; blk < nblocks; ++blk)
+			{
+				const uint32_t *block = msg + blk * 16 * W;
+				int first = 0;
+				if (blk == 0)
+				{
+					for (int i = 0; i < 4; ++i)
+						m[i] = res[i];
+					first = 4;
+				}
+				for (int i = first; i < 16; ++i)
+					m[i] = V::load(block + i * W);
+				md5_mb_compress<V>(state, m);
+				vec mask = V::load(last_mask + blk * W);
+				for (int i = 0; i < 4; ++i)
+					res[i] = V::bor(V::band(mask, state[i]), V::bandnot(mask, res[i]));
+			}
+		}
+	}
+
+	for (int i = 0; i < 4; ++i)
+		V::store(digest + i * W, res[i]);
+}
+
+#undef MD5_MB_STEP
+
+}
+
+/**
+ *@brief 定义一个指令集的运行时迭代轮数内核md5_mb_iterate_<isa>()
+ * 以及迭代轮数为2^11..2^14的编译期特化内核表md5_mb_fixed_<isa>[]
+ */
+#define MD5_MB_DEFINE_KERNELS(isa, V) \
+	void md5_mb_iterate_##isa(const uint32_t *msg, const uint32_t *last_mask, int nblocks, uint32_t *digest, uint32_t count) \
+	{ \
+		md5_mb_iterate<V, 0>(msg, last_mask, nblocks, digest, count); \
+	} \
+	const md5_mb_iterate_fn md5_mb_fixed_##isa[MD5_MB_FIXED_NUM] = { \
+		md5_mb_iterate<V, 1u << 11>, \
+		md5_mb_iterate<V, 1u << 12>, \
+		md5_mb_iterate<V, 1u << 13>, \
+		md5_mb_iterate<V, 1u << 14>, \
+	};
+
+#endif
@@ -0,0 +1,78 @@
+/**
+ *@file metrics.h
+ *@brief 运行时性能指标声明文件
+ *@version 0.1
+ */
+#ifndef _METRICS_H
+#define _METRICS_H
+
+#include <stdint.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+#define METRICS_HIST_BUCKETS 48          //延迟直方图按时钟周期数的log2分桶，2^47个周期以上都放在最后一桶
+#define METRICS_MAX_THREADS 512          //最多记录的线程数，更多的线程共用最后一个槽
+#define DEFAULT_METRICS_INTERVAL 10      //只指定--metrics-file时缺省每10秒输出一次
+#define METRICS_QUEUE_NUM 3              //流水线各级之间的队列个数
+#define METRICS_PROM_BUCKETS 27          //Prometheus直方图的le从1us开始每次加倍，最大约67s
+
+/**
+ *@brief 计时的各级，读取级和输出级之外都是alg_desp接口的调用
+ */
+enum metric_stage {
+	METRIC_READ = 0,    //从口令文件读取一批
+	METRIC_SALT,        //get_random_salt
+	METRIC_PREPARE,     //prepare_pwd
+	METRIC_HASH,        //hash_pwd，记录数即hash次数
+	METRIC_CIPHER,      //get_cipher
+	METRIC_WRITE,       //写密文文件或匹配结果
+	METRIC_STAGE_NUM
+};
+
+//! 队列深度的采样函数，depth[i]为第i个队列中的元素个数，不存在的队列填-1
+typedef void (*metrics_sampler)(void *arg, int *depth);
+
+//! 是否开启统计，只在启动工作线程之前由metrics_start()/metrics_stop()修改
+extern bool metrics_enabled;
+
+//! 读取时钟周期计数器，不是x86时使用纳秒
+static inline uint64_t metrics_clock()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+//! 开始计时，关闭统计时返回0，之后的metrics_end()什么都不做
+static inline uint64_t metrics_begin()
+{
+	return metrics_enabled ? metrics_clock() : 0;
+}
+
+//! 把一次调用的耗时和处理的记录数累加到当前线程的计数器
+void metrics_record(int stage, uint64_t cycles, long long records);
+
+//! 结束计时，begin为metrics_begin()的返回值
+static inline void metrics_end(int stage, uint64_t begin, long long records)
+{
+	if (begin != 0)
+		metrics_record(stage, metrics_clock() - begin, records);
+}
+
+//! 开启统计并启动输出线程，每interval秒输出到标准错误，prom_path不为NULL时同时写Prometheus文本格式文件
+int metrics_start(int interval, const char *prom_path);
+
+//! 停止输出线程，输出整个运行期间的汇总，关闭统计
+void metrics_stop();
+
+//! 注册队列深度的采样函数，names为各队列的名称；sampler为NULL时取消注册，返回后不再调用之前的采样函数
+void metrics_watch_queues(metrics_sampler sampler, void *arg, const char *const *names);
+
+#endif
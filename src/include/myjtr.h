@@ -0,0 +1,68 @@
+/**
+ *@file myjtr.h
+ *@brief 可嵌入的批量hash库libmyjtr的接口声明文件
+ *
+ * 用法：进程启动时按算法名和附加信息open()一个AlgHandle，之后任意多个线程可以同时用同一个句柄
+ * 调用hash_batch()和verify_batch()。输入是调用者的口令、密文数组，输出写入调用者预先分配的缓冲区，
+ * 句柄open()之后只读，库中没有随批次变化的全局状态。
+ * 链接：-lmyjtr -lcrypto -pthread
+ *@version 0.1
+ */
+#ifndef _MYJTR_H
+#define _MYJTR_H
+
+#include <string>
+#include <vector>
+
+#define MYJTR_API_VERSION 1       //接口版本，接口不兼容地修改时增加
+
+#define MYJTR_MAX_CIPHER 128      //一个密文的最大字节数，hash_batch()的stride取此值总是足够
+
+#define MYJTR_MATCH 1             //口令与密文匹配
+#define MYJTR_MISMATCH 0          //口令与密文不匹配
+#define MYJTR_INVALID -1          //密文不能解析
+
+struct alg_handle_state;
+
+/**
+ *@brief 配置好的算法句柄
+ * 算法描述在open()时复制、初始化并按附加信息特化一次，之后只读；
+ * 每次调用使用自己的分配器和算法描述副本，多个线程共用一个句柄不需要加锁
+ */
+class AlgHandle
+{
+	public:
+		AlgHandle();
+		~AlgHandle();
+
+		//! 按算法名和"名称=值"形式的附加信息(与getcipher命令行相同)初始化，出错返回-1，原因见error()
+		//! 没有给出seed时每个句柄使用自己的随机种子
+		int open(const std::string &alg_name, const std::vector<std::string> &extra = std::vector<std::string>());
+
+		//! open()成功之后为true
+		bool is_open() const { return state != NULL; }
+
+		//! 最近一次open()出错的原因
+		const std::string &error() const { return error_msg; }
+
+		//! 计算n个口令的密文，每个口令产生一个新的随机盐
+		//! 第i个密文写入cipher + i * stride，不以'\0'结尾，字节数写入cipher_len[i]，出错返回-1
+		int hash_batch(const char *const *pwd, const int *pwd_len, int n, char *cipher, int stride, int *cipher_len) const;
+
+		//! 同上，第i个口令使用调用者给出的盐salt[i]，盐的字节数必须与附加信息salt_len一致
+		int hash_batch(const char *const *pwd, const int *pwd_len, const char *const *salt, const int *salt_len, int n,
+			char *cipher, int stride, int *cipher_len) const;
+
+		//! 校验n对(口令, 密文)，每个密文自带盐和参数，result[i]为MYJTR_MATCH、MYJTR_MISMATCH或MYJTR_INVALID，出错返回-1
+		int verify_batch(const char *const *pwd, const int *pwd_len, const char *const *cipher, const int *cipher_len, int n,
+			int *result) const;
+
+	private:
+		AlgHandle(const AlgHandle &);
+		AlgHandle& operator= (const AlgHandle &);
+
+		struct alg_handle_state *state;    //算法描述等实现细节，不在接口中暴露
+		std::string error_msg;
+};
+
+#endif
@@ -0,0 +1,60 @@
+/**
+ *@file param_record.h
+ *@brief 每条记录自带参数(盐、迭代次数标识)时按参数分段批量计算的声明文件
+ *@version 0.1
+ */
+#ifndef _PARAM_RECORD_H
+#define _PARAM_RECORD_H
+
+#include "extra_info.h"
+
+#define PARAM_TASK_COST (1LL << 22)    //一个任务的目标代价(MD5压缩次数)，迭代次数少的记录合并成一个任务
+
+/**
+ *@brief 一条自带参数的记录
+ */
+struct param_record {
+	int index;                              //在本批中的序号
+	int salt_len;                           //盐的字节数
+	unsigned char salt[CIPHER_MAX_SALT];
+	unsigned char hash[CIPHER_MAX_HASH];    //校验模式为密文中的hash值，产生密文模式为计算结果
+	int hash_len;
+	ByteView pwd;                           //预处理后的口令
+	union extra_data *values;               //参数，即算法声明的密文自带参数的当前值，按param_layout的顺序
+	long long cost;                         //估计的MD5压缩次数
+};
+
+/**
+ *@brief 作为每条记录参数的附加信息在desp->extra中的下标，即desp->cipher_params
+ */
+struct param_layout {
+	int num;
+	int index[32];
+};
+
+/**
+ *@brief 比较两条记录的盐长度和参数，相等的记录可以在同一次批量hash中计算
+ */
+struct param_record_less {
+	int param_num;
+	bool operator() (const struct param_record *a, const struct param_record *b) const;
+};
+
+//! 算法声明的密文自带参数(desp->cipher_params)是每条记录的参数，其余附加信息对所有记录相同
+void init_param_layout(const struct alg_desp *desp, struct param_layout *layout);
+
+//! 把desp中参数的当前值保存到rec->values(从arena中分配)，并估计rec的代价，rec->pwd必须已设置
+void save_param_values(const struct alg_desp *desp, const struct param_layout *layout, struct param_record *rec, BatchArena &arena);
+
+//! 把一行"口令[\t盐[\t迭代次数标识]]"解析为一条记录，没有盐时按record_index产生随机盐，格式或参数不对返回-1
+int parse_param_record(struct alg_desp *desp, const struct param_layout *layout, const char *line, int len,
+	long long record_index, struct param_record *rec, BatchArena &arena);
+
+//! 把按参数排序的n条记录切分为任务，返回任务个数，第k个任务为[first[k], first[k + 1])，代价为cost[k]，first至少n + 1个元素
+int split_param_tasks(struct param_record *const *order, int n, int param_num, int *first, long long *cost);
+
+//! 计算n条参数相同的记录的hash值，local为调用者自己的算法描述副本，参数写入其附加信息的当前值
+int hash_param_records(struct alg_desp *local, const struct param_layout *layout, struct param_record *const *order, int n,
+	ByteView *hash, BatchArena &arena);
+
+#endif
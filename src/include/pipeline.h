@@ -0,0 +1,54 @@
+/**
+ *@file pipeline.h
+ *@brief 多线程口令处理流水线声明文件
+ *@version 0.1
+ */
+#ifndef _PIPELINE_H
+#define _PIPELINE_H
+
+#include "extra_info.h"
+#include "pwd_reader.h"
+#include "cipher_writer.h"
+#include "checkpoint.h"
+
+#define DEFAULT_THREAD_NUM 1    //缺省hash工作线程数
+#define MAX_THREAD_NUM 256      //最大hash工作线程数
+#define DEFAULT_BATCH_SIZE 256  //缺省每批口令个数
+#define MAX_BATCH_SIZE 65536    //每批口令个数上限
+#define MAX_PWD_LEN 65536       //-L选项允许的口令最大长度上限
+
+/**
+ *@brief 流水线运行参数，由命令行的-t -b -u -L -w -c -C --restore选项设置
+ */
+struct pipeline_option {
+	int thread_num;    //hash工作线程数
+	int batch_size;    //每批口令个数
+	int unordered;     //1：按完成顺序输出密文，0：按输入顺序输出密文
+	int max_pwd_len;   //口令最大长度，超过的部分被截断，0表示不限制
+	int write_flags;   //密文文件写入策略，WRITER_DIRECT | WRITER_FSYNC
+	const char *checkpoint_path;    //检查点文件，NULL表示不写检查点
+	int checkpoint_interval;        //写检查点的间隔秒数
+	int restore;                    //1：从检查点恢复，口令文件已定位到检查点的偏移
+	long long first_record;         //第一条口令的记录序号，从检查点恢复时为之前已完成的口令个数
+	const char *pot_path;           //破解模式的potfile，NULL表示不使用
+};
+
+//! 设置流水线运行参数的缺省值
+void init_pipeline_option(struct pipeline_option *option);
+
+//! 收到SIGINT/SIGTERM时调用：读取级停止读取，已读入的口令处理完后写最后一个检查点再返回
+void interrupt_pipeline();
+
+//! 是否已经调用过interrupt_pipeline()
+bool pipeline_interrupted();
+
+//! 读取口令文件，多线程计算密文并写入密文文件
+int run_pipeline(struct alg_desp *desp, PwdReader &file_in, CipherWriter &file_out, const struct pipeline_option *option);
+
+//! 读取"密文:口令"文件，多线程校验并按输入顺序写入每个密文的校验结果
+int run_verify(struct alg_desp *desp, PwdReader &file_in, CipherWriter &file_out, const struct pipeline_option *option);
+
+//! 读取每行"口令[\t盐[\t迭代次数标识]]"的记录文件，按每条记录的盐和迭代次数多线程计算密文，按代价调度
+int run_records(struct alg_desp *desp, PwdReader &file_in, CipherWriter &file_out, const struct pipeline_option *option);
+
+#endif
@@ -0,0 +1,91 @@
+/**
+ *@file pwd_reader.h
+ *@brief 基于mmap的零拷贝口令文件读取声明文件
+ *@version 0.1
+ */
+#ifndef _PWD_READER_H
+#define _PWD_READER_H
+
+#include <stddef.h>
+#include <string>
+
+#define STREAM_BUFFER_SIZE (1 << 20)    //流式读取的缓冲区1MB，更长的行截断为缓冲区大小，其余部分丢弃
+
+/**
+ *@brief 口令文件读取器
+ * 把口令文件整个mmap到内存，按行切分为(指针, 长度)视图，不复制口令内容。
+ * 视图在close()之前一直有效。行尾的"\r\n"和"\n"都会去掉
+ * 路径为"-"(标准输入)或管道等不能映射的文件时流式读取：用固定大小的缓冲区分块read，
+ * 视图只在下一次next()之前有效，需要保留时用next_batch()复制；流式读取不能seek和分片。
+ * 流式读取的缓冲区大小固定，超过STREAM_BUFFER_SIZE的行与超过max_len的行一样截断并计数，内存占用不随输入增长
+ */
+class PwdReader
+{
+	public:
+		PwdReader();
+		~PwdReader();
+
+		//! 打开并映射口令文件，"-"表示标准输入，max_len为口令最大长度，超过的部分被截断，0表示不限制
+		int open(const char *path, int max_len = 0);
+
+		//! 读取下一行口令，到达文件末尾返回false
+		bool next(const char *&line, int &len);
+
+		//! 读取最多n行口令，流式读取时复制到store中，返回读到的行数，小于n表示到达文件末尾
+		int next_batch(const char **line, int *len, int n, std::string &store);
+
+		//! 是否流式读取
+		bool streaming() const { return stream_buf != NULL; }
+		//! 流式读取时read出错
+		bool read_failed() const { return read_error; }
+
+		//! 下一行口令在文件中的字节偏移
+		size_t offset() const { return pos; }
+
+		//! 从文件中的字节偏移offset继续读取，offset必须是某一行的开头，用于从检查点恢复
+		int seek(size_t offset);
+		//! 只读取第k片(共n片)，按字节均分文件，边界对齐到行首，k从1开始
+		int shard(int k, int n);
+		//! 读取范围的起止字节偏移，没有分片时为整个文件
+		size_t range_begin() const { return begin_pos; }
+		size_t range_end() const { return end_pos; }
+		//! [begin, end)中的行数，begin必须是行首
+		long long count_lines(size_t begin, size_t end) const;
+		//! 口令文件的字节数
+		size_t file_size() const { return size; }
+		//! 被截断的口令个数
+		long long truncated() const { return truncated_num; }
+		//! 口令被截断后的长度：max_len，不限制时为流式读取的缓冲区大小
+		int truncated_len() const { return max_pwd_len > 0 ? max_pwd_len : STREAM_BUFFER_SIZE; }
+
+		//! 取消映射并关闭文件
+		void close();
+
+	private:
+		PwdReader(const PwdReader &);
+		PwdReader& operator= (const PwdReader &);
+		size_t line_start(size_t offset) const;
+		bool next_stream(const char *&line, int &len);
+		bool fill_stream();
+
+		int fd;
+		const char *data;    //文件映射的起始地址
+		size_t size;         //文件字节数
+		size_t pos;          //下一行的起始偏移
+		size_t begin_pos;    //读取范围[begin_pos, end_pos)，分片时为本片，否则为整个文件
+		size_t end_pos;
+		int max_pwd_len;
+		long long truncated_num;
+		char *stream_buf;       //流式读取的缓冲区，映射文件时为NULL
+		size_t stream_cap;      //缓冲区字节数
+		size_t stream_begin;    //缓冲区中未读部分[stream_begin, stream_end)
+		size_t stream_end;
+		bool stream_eof;        //已经读到输入末尾
+		bool stream_skip;       //上一行超过缓冲区大小已截断，下一次读取前丢弃到下一个'\n'为止
+		bool read_error;
+};
+
+//! 在[p, end)中查找第一个'\n'，没有找到返回end
+const char *find_newline(const char *p, const char *end);
+
+#endif
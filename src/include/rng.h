@@ -0,0 +1,39 @@
+/**
+ *@file rng.h
+ *@brief 可设定种子、线程安全的随机盐产生器声明文件
+ *@version 0.1
+ */
+#ifndef _RNG_H
+#define _RNG_H
+
+#include <stdint.h>
+
+#define RNG_MODE_STREAM 0     //每批盐由(种子, 批次第一条记录序号)确定的一段随机流产生
+#define RNG_MODE_INDEX 1      //每条记录的盐只由(种子, 记录序号)确定，与批大小、线程数无关
+
+/**
+ *@brief xoshiro256**产生器状态，每个线程或每批各自持有，不共享
+ */
+struct rng_state {
+	uint64_t s[4];
+};
+
+//! 由(种子, 计数器)初始化产生器，相同的输入得到相同的随机序列
+void rng_seed(struct rng_state *rng, uint64_t seed, uint64_t counter);
+
+//! 产生下一个64位随机数
+uint64_t rng_next(struct rng_state *rng);
+
+//! 用拒绝采样从charset中无偏地选取len个字符
+void rng_fill_charset(struct rng_state *rng, unsigned char *out, int len, const char *charset, int charset_size);
+
+//! 当前线程的产生器，第一次使用时由进程种子和线程序号初始化
+struct rng_state *rng_thread_state();
+
+//! 设置进程种子，必须在启动工作线程之前调用
+void rng_set_process_seed(uint64_t seed);
+
+//! 进程种子，未设置时为启动时从random_device取得的随机值
+uint64_t rng_process_seed();
+
+#endif
@@ -0,0 +1,97 @@
+/**
+ *@file rules.h
+ *@brief 破解模式的字典变形规则声明文件
+ *@version 0.1
+ */
+#ifndef _RULES_H
+#define _RULES_H
+
+#include "batch_arena.h"
+#include "md5_mb.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#define RULE_BUF_LEN 512                                   //规则执行时口令缓冲区的字节数，超出的部分被丢弃
+#define RULE_MAX_LEN (MD5_MB_MAX_BLOCKS * 64 - 9 - 16)     //变形后口令的缺省最大长度，即向量内核支持的231字节
+#define RULE_MAX_EXPAND 1000000                            //一行规则经[...]展开后的最大条数
+#define RULE_DEDUP_MAX_SLOTS (1 << 18)                     //去重表的最大槽数，每槽8字节
+
+/**
+ *@brief 编译后的规则集
+ * 规则文件每行一条，空行和以#开头的行被忽略，命令兼容John the Ripper的常用子集：
+ *   :        不变              l u c C t  全小写、全大写、首字母大写、首字母小写其余大写、大小写互换
+ *   TN       第N个字符大小写互换  r d f      反转、重复、反转后追加
+ *   { }      循环左移、右移      [ ]        删除第一个、最后一个字符
+ *   $X ^X    追加、前插字符X     DN 'N      删除第N个字符、截断为N个字符
+ *   xNM      取从N开始的M个字符   iNX oNX    在N处插入、覆盖为字符X
+ *   sXY      所有X替换为Y        @X         删除所有X
+ *   AN"str"  在N处插入字符串，"可以是任意不在str中的分隔符
+ *   <N >N    长度不小于N、不大于N时丢弃   !X /X   包含X、不包含X时丢弃
+ * 位置N为0-9、A-Z(10-35)，AN中的z表示末尾。规则中的[...]按字符集展开为多条规则，
+ * 如$[0-9]$[0-9]展开为100条，\转义下一个字符，因此删除首尾字符的命令写为\[和\]，空格和制表符被忽略。
+ * 每条规则编译为一段字节码，执行时不再解析文本
+ */
+class RuleSet
+{
+	public:
+		RuleSet() {}
+
+		//! 读取并编译规则文件，出错返回-1并设置error()
+		int load(const char *path);
+		//! 编译一行规则，[...]展开后的每条规则追加到规则集，出错返回-1并设置error()
+		int add(const std::string &line);
+
+		//! 规则条数
+		int size() const { return (int)entry.size(); }
+		//! 出错原因
+		const std::string &error() const { return error_msg; }
+
+		//! 对长度为len的口令in执行第rule条规则，结果写入out(至少RULE_BUF_LEN字节)，返回结果长度，被丢弃返回-1
+		int apply(int rule, const char *in, int len, char *out) const;
+
+	private:
+		int compile(const std::string &rule);
+
+		std::vector<unsigned char> code;    //所有规则的字节码，每条以RULE_OP_END结束
+		std::vector<int> entry;             //每条规则在code中的起始位置
+		std::string error_msg;
+};
+
+/**
+ *@brief 把规则集逐条应用到一组基础口令上，产生候选口令
+ * 基础口令复制到一块连续内存中，依次对整组口令执行第0条规则、第1条规则……，
+ * 结果为空、超过最大长度或与本组已产生的候选口令重复时跳过。
+ * 重复用64位指纹的直接映射表检查，槽被覆盖时可能漏掉少数重复，只有指纹相同时才会误丢不同的候选口令
+ */
+class RuleBatch
+{
+	public:
+		RuleBatch(const RuleSet &rules, int max_len);
+
+		//! 设置一组基础口令，跳过空口令，之后从第0条规则开始产生
+		void set_words(const char *const *word, const int *len, int n);
+		//! 产生最多n个候选口令写入arena，返回个数，本组全部产生后返回值可能小于n
+		int generate(BatchArena &arena, const char **pwd, int *len, int n);
+		//! 本组的所有规则是否都已执行
+		bool done() const { return rule_index >= rules.size(); }
+
+		long long rejected() const { return rejected_num; }
+		long long duplicates() const { return duplicate_num; }
+
+	private:
+		RuleBatch(const RuleBatch &);
+		RuleBatch& operator= (const RuleBatch &);
+
+		const RuleSet &rules;
+		int max_len;
+		std::string words;                //本组基础口令，首尾相接
+		std::vector<int> word_begin;      //每个基础口令在words中的起始位置，最后一个元素为words的长度
+		int rule_index;
+		int word_index;
+		std::vector<uint64_t> seen;       //已产生的候选口令的指纹，0表示空槽
+		long long rejected_num;
+		long long duplicate_num;
+};
+
+#endif
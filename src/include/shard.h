@@ -0,0 +1,40 @@
+/**
+ *@file shard.h
+ *@brief 按字节范围把口令文件分给多台机器计算，以及合并各片密文的声明文件
+ *@version 0.1
+ */
+#ifndef _SHARD_H
+#define _SHARD_H
+
+#include <string>
+
+#define SHARD_MAGIC "MYJTR_SHARD 2"          //清单文件第一行，格式变化时修改
+#define SHARD_MANIFEST_SUFFIX ".manifest"    //清单文件名为密文文件名加此后缀
+#define MAX_SHARD_NUM 65536                  //最大分片数
+
+/**
+ *@brief 一片的清单，与该片的密文文件放在一起，合并时据此检查各片是否完整、连续
+ */
+struct shard_manifest {
+	int k;                      //片号，从1开始
+	int n;                      //总片数
+	std::string alg_name;
+	long long input_size;       //口令文件的字节数
+	long long byte_begin;       //本片在口令文件中的字节范围[byte_begin, byte_end)，都是行首
+	long long byte_end;
+	long long line_begin;       //本片在口令文件中的行号范围[line_begin, line_end)，从0开始，
+	long long line_end;         //line_begin也是本片第一条口令的记录序号，line_end - line_begin为密文条数
+	long long output_bytes;     //密文文件的字节数
+	std::string sha256;         //密文文件的SHA-256，十六进制
+};
+
+//! 解析"k/n"形式的分片参数
+int parse_shard(const char *spec, int &k, int &n);
+
+//! 计算密文文件的字节数和SHA-256，写入cipher_path加SHARD_MANIFEST_SUFFIX的清单文件
+int write_shard_manifest(const char *cipher_path, struct shard_manifest *manifest);
+
+//! 按片号顺序流式合并各片的密文文件，检查清单、长度和SHA-256
+int merge_shards(const char *out_path, char **shard_paths, int shard_num);
+
+#endif
@@ -0,0 +1,17 @@
+/**
+ *@file state_file.h
+ *@brief 检查点、分片清单、统计文件等状态文件的原子写入和"名称=值"格式读取声明文件
+ *@version 0.1
+ */
+#ifndef _STATE_FILE_H
+#define _STATE_FILE_H
+
+#include <stdio.h>
+
+//! 先由write把内容写入path.tmp，sync非0时fsync，再rename为path，任何时候path都是一个完整的文件
+int write_file_atomic(const char *path, int (*write)(FILE *fp, const void *arg), const void *arg, int sync);
+
+//! 读取第一行为magic、之后每行一个"名称=值"的文件，每行调用field，返回field识别的字段个数
+int read_state_file(const char *path, const char *magic, int (*field)(const char *name, const char *value, void *arg), void *arg);
+
+#endif
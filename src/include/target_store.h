@@ -0,0 +1,153 @@
+/**
+ *@file target_store.h
+ *@brief 破解模式的紧凑密文库声明文件
+ *@version 0.1
+ */
+#ifndef _TARGET_STORE_H
+#define _TARGET_STORE_H
+
+#include "extra_info.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define TARGET_INDEX_MAGIC "MYJTRIX2"    //二进制索引文件的魔数，格式变化时修改
+#define TARGET_SECTION_ALIGN 64          //索引文件中各数组的对齐字节数
+#define TARGET_BLOOM_MIN 8               //组内密文不少于8个时建立bloom过滤器，更少时直接比较
+#define TARGET_BLOOM_BITS 16             //bloom过滤器中每个密文占用的位数
+
+/**
+ *@brief 一段参数(如迭代次数、盐长度)相同的连续密文
+ */
+struct target_segment {
+	uint64_t first;      //本段第一个密文的下标
+	int32_t salt_len;    //本段密文的盐字节数
+	int32_t reserved;
+};
+
+/**
+ *@brief 一组(参数和盐都相同的连续密文)的bloom过滤器
+ */
+struct target_bloom {
+	uint64_t first;       //组内第一个密文的下标
+	uint32_t word_off;    //过滤器在bloom_words中的起始下标
+	uint32_t bit_mask;    //过滤器位数 - 1，位数为2的幂
+};
+
+/**
+ *@brief 二进制索引文件头，之后依次是hash、盐、段、段参数、bloom过滤器各数组，各自按TARGET_SECTION_ALIGN对齐
+ */
+struct target_index_header {
+	char magic[8];
+	char alg_name[32];
+	int64_t source_size;      //生成索引的密文文件大小和修改时间，不一致时重新生成
+	int64_t source_mtime;
+	uint32_t hash_size;       //每个hash值的字节数
+	uint32_t salt_size;       //盐数组每个元素的字节数，即最长盐的字节数
+	uint64_t target_num;
+	uint32_t param_num;       //每段保存的参数个数，即算法声明的密文自带参数
+	int32_t param_index[32];  //每段保存的参数在extra中的下标
+	uint32_t segment_num;
+	uint64_t bloom_num;
+	uint64_t bloom_word_num;
+	uint64_t hash_offset;
+	uint64_t salt_offset;
+	uint64_t segment_offset;
+	uint64_t value_offset;
+	uint64_t bloom_offset;
+	uint64_t bloom_word_offset;
+	uint64_t file_size;
+};
+
+/**
+ *@brief 按(参数, 盐, hash值)排序的密文库，hash值和盐分别存放在连续数组中(SoA)
+ * 参数和盐都相同的连续密文为一组，每个候选口令对一组只计算一次hash值。
+ * 密文库在内存中的布局与二进制索引文件完全相同，索引文件mmap后直接使用，不需要解析
+ */
+class TargetStore
+{
+	public:
+		TargetStore();
+		~TargetStore();
+
+		//! 解析密文文件建立密文库，desp->cipher_params提供参数的下标
+		int build(struct alg_desp *desp, const char *cipher_path);
+
+		//! 把密文库写成二进制索引文件，先写临时文件再改名
+		int save(const char *index_path);
+
+		//! mmap二进制索引文件，算法名不同或密文文件已改变时返回-1
+		int load(const char *index_path, const std::string &alg_name, const char *cipher_path);
+
+		void close();
+
+		//! 密文个数
+		long long size() const { return header ? header->target_num : 0; }
+
+		//! 密文库占用的字节数
+		size_t bytes() const { return header ? header->file_size : 0; }
+
+		int hash_size() const { return header->hash_size; }
+		const unsigned char *hash(long long i) const { return hashes + i * header->hash_size; }
+		const unsigned char *salt(long long i) const { return salts + i * header->salt_size; }
+
+		int segment_num() const { return header->segment_num; }
+		const struct target_segment &segment(int s) const { return segments[s]; }
+		//! 第s段的结束下标
+		long long segment_end(int s) const { return s + 1 < (int)header->segment_num ? segments[s + 1].first : header->target_num; }
+		//! 第s段的参数值，与param_index(k)一一对应
+		const union extra_data *segment_values(int s) const { return values + (size_t)s * header->param_num; }
+		int param_num() const { return header->param_num; }
+		int param_index(int k) const { return header->param_index[k]; }
+
+		//! 下标i所在的段
+		int segment_of(long long i) const;
+
+		//! 从first开始、不超过limit的组的结束下标
+		long long group_end(long long first, long long limit) const
+		{
+			long long end = first + 1;
+			while (end < limit && memcmp(salt(end), salt(first), header->salt_size) == 0)
+				++end;
+			return end;
+		}
+
+		//! 组[first, end)的bloom过滤器，没有时返回NULL
+		const struct target_bloom *bloom_of(long long first, long long end) const;
+
+		//! hash值可能在bloom过滤器对应的组中时返回true
+		bool bloom_test(const struct target_bloom *bloom, const unsigned char *h) const
+		{
+			uint32_t w0, w1;
+			memcpy(&w0, h, 4);
+			memcpy(&w1, h + 4, 4);
+			w0 &= bloom->bit_mask;
+			w1 &= bloom->bit_mask;
+			const uint64_t *words = bloom_words + bloom->word_off;
+			return ((words[w0 >> 6] >> (w0 & 63)) & (words[w1 >> 6] >> (w1 & 63)) & 1) != 0;
+		}
+
+		//! 在组[first, end)中查找hash值，返回密文下标，没有找到返回-1
+		long long find(long long first, long long end, const unsigned char *h) const;
+
+		//! 查找参数(extra中各参数的当前值)、盐、hash值都相同的密文，返回密文下标，没有找到返回-1
+		long long lookup(const struct extra_info *extra, const unsigned char *salt, int salt_len, const unsigned char *h) const;
+
+	private:
+		TargetStore(const TargetStore &);
+		TargetStore& operator= (const TargetStore &);
+
+		int attach(char *image);
+
+		char *image;          //密文库的内存映像，来自build时分配或load时mmap
+		size_t mapped_size;   //load时mmap的字节数，build时为0
+		const struct target_index_header *header;
+		const unsigned char *hashes;
+		const unsigned char *salts;
+		const struct target_segment *segments;
+		const union extra_data *values;
+		const struct target_bloom *blooms;
+		const uint64_t *bloom_words;
+};
+
+#endif
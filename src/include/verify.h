@@ -0,0 +1,34 @@
+/**
+ *@file verify.h
+ *@brief 批量校验(口令, 密文)对的声明文件
+ *@version 0.1
+ */
+#ifndef _VERIFY_H
+#define _VERIFY_H
+
+#include "extra_info.h"
+#include "param_record.h"
+
+#define VERIFY_MATCH 1       //口令与密文匹配
+#define VERIFY_MISMATCH 0    //口令与密文不匹配
+#define VERIFY_INVALID -1    //密文不能解析
+
+//! 常数时间比较两个len字节的摘要，耗时与第一个不同字节的位置无关
+bool verify_digest_equal(const unsigned char *a, const unsigned char *b, int len);
+
+//! 把一行"密文:口令"在第一个':'处切分，没有':'返回-1
+int split_verify_line(const char *line, int len, int &cipher_len, const char *&pwd, int &pwd_len);
+
+//! 解析n个密文并预处理口令，不能解析的result[i]为VERIFY_INVALID，其余记录按参数排序后放入order，返回记录个数，出错返回-1
+int verify_prepare(struct alg_desp *desp, const struct param_layout *layout, const char *const *pwd, const int *pwd_len,
+	const char *const *cipher, const int *cipher_len, int n, int *result, struct param_record **order, BatchArena &arena);
+
+//! 校验n条参数相同的记录，结果写入result[order[i]->index]，local为调用者自己的算法描述副本
+int verify_records(struct alg_desp *local, const struct param_layout *layout, struct param_record *const *order, int n,
+	int *result, BatchArena &arena);
+
+//! 校验n对(口令, 密文)，每个密文自带盐和参数，参数相同的记录一起交给批量hash接口，result[i]为VERIFY_*
+int verify_batch(struct alg_desp *desp, const char *const *pwd, const int *pwd_len, const char *const *cipher, const int *cipher_len,
+	int n, int *result, BatchArena &arena);
+
+#endif
@@ -0,0 +1,73 @@
+/**
+ *@file work_pool.h
+ *@brief 按代价调度的工作窃取线程池声明文件
+ *@version 0.1
+ */
+#ifndef _WORK_POOL_H
+#define _WORK_POOL_H
+
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+/**
+ *@brief 线程池中的一个任务
+ */
+struct pool_task {
+	void (*run)(void *arg, int worker);    //任务函数，worker为执行任务的线程序号，可以据此使用线程自己的资源
+	void *arg;
+	long long cost;                        //估计的代价，只用于调度
+};
+
+/**
+ *@brief 工作窃取线程池
+ * 每个线程有自己的任务队列，队列按代价从大到小排列。一次提交的一组任务按代价从大到小，
+ * 依次放入负载最小的队列(LPT)，已排队的任务中最贵的最先开始；
+ * 线程从自己队列的队首取任务，自己的队列空了就从排队代价最大的队列的队首窃取。
+ * 单个任务耗时相差几个数量级时，总耗时接近总代价除以线程数，而不是被分到贵任务的线程拖住
+ */
+class WorkStealingPool
+{
+	public:
+		explicit WorkStealingPool(int thread_num);
+		~WorkStealingPool();
+
+		//! 提交n个任务，之后可以立即改写task数组
+		void submit(const struct pool_task *task, int n);
+		//! 不再提交任务，已提交的任务全部执行完后线程退出
+		void close();
+		//! 等待所有线程退出
+		void join();
+
+		//! 被窃取执行的任务个数
+		long long steals() const { return steal_num; }
+
+	private:
+		WorkStealingPool(const WorkStealingPool &);
+		WorkStealingPool& operator= (const WorkStealingPool &);
+
+		//! 每个线程的任务队列，queued_cost和running_cost不加锁读取，用于选择放入和窃取的队列
+		struct task_queue {
+			std::mutex lock;
+			std::deque<struct pool_task> tasks;
+			std::atomic<long long> queued_cost;     //排队任务的代价之和
+			std::atomic<long long> running_cost;    //本线程正在执行的任务的代价
+		};
+
+		bool take(int worker, struct pool_task &task);
+		void worker_loop(int worker);
+
+		std::vector<struct task_queue *> queues;
+		std::vector<std::thread> threads;
+		std::vector<struct pool_task> sorted;    //submit()排序用的缓冲区，只由提交任务的线程使用
+		std::mutex idle_mutex;
+		std::condition_variable idle_cond;       //没有任务时线程在这里等待
+		std::atomic<long long> queued_num;       //已提交尚未取走的任务个数
+		bool closed;
+		std::atomic<long long> steal_num;
+};
+
+#endif
@@ -0,0 +1,290 @@
+/**
+ *@file mask.cpp
+ *@brief 破解模式的掩码候选口令产生器实现文件
+ *@version 0.1
+ */
+#include "include/mask.h"
+#include <stdint.h>
+#include <string.h>
+
+static const char mask_lower[] = "abcdefghijklmnopqrstuvwxyz";
+static const char mask_upper[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+static const char mask_digit[] = "0123456789";
+static const char mask_special[] = " !\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~";
+
+//! 把chars中没有出现过的字符追加到set中
+static void append_unique(std::string &set, const char *chars, int len)
+{
+	for (int i = 0; i < len; ++i)
+	{
+		if (set.find(chars[i]) == std::string::npos)
+			set.push_back(chars[i]);
+	}
+}
+
+//! 内置字符集，c为?之后的字符，不是内置字符集返回NULL
+static const char *builtin_charset(char c, std::string &store)
+{
+	switch (c)
+	{
+		case 'l': return mask_lower;
+		case 'u': return mask_upper;
+		case 'd': return mask_digit;
+		case 's': return mask_special;
+		case 'a':
+			store = std::string(mask_lower) + mask_upper + mask_digit + mask_special;
+			return store.c_str();
+		default: return NULL;
+	}
+}
+
+/**
+ *@brief 解析从p开始的[x-y]，成功时把字符追加到set并返回消耗的字符数，格式错误返回-1
+ */
+static int parse_range(const std::string &spec, size_t p, std::string &set)
+{
+	if (p + 4 >= spec.size())
+		return -1;
+	if (spec[p] != '[' || spec[p + 2] != '-' || spec[p + 4] != ']')
+		return -1;
+	unsigned char lo = spec[p + 1];
+	unsigned char hi = spec[p + 3];
+	if (lo > hi)
+		return -1;
+	for (unsigned c = lo; c <= hi; ++c)
+	{
+		char ch = (char)c;
+		append_unique(set, &ch, 1);
+	}
+	return 5;
+}
+
+/**
+ *@brief 展开自定义字符集，可以是[x-y]、?l等内置字符集以及单个字符的组合
+ *@param spec 字符集定义，如[a-z][0-9]
+ *@param chars 输出去重后的字符
+ *@return 成功返回0，格式错误返回-1
+ */
+int parse_mask_charset(const std::string &spec, std::string &chars)
+{
+	chars.clear();
+	size_t p = 0;
+	while (p < spec.size())
+	{
+		if (spec[p] == '[')
+		{
+			int used = parse_range(spec, p, chars);
+			if (used < 0)
+				return -1;
+			p += used;
+		}
+		else if (spec[p] == '?' && p + 1 < spec.size())
+		{
+			std::string store;
+			const char *set = builtin_charset(spec[p + 1], store);
+			if (set != NULL)
+				append_unique(chars, set, strlen(set));
+			else if (spec[p + 1] == '?')
+				append_unique(chars, "?", 1);
+			else
+				return -1;
+			p += 2;
+		}
+		else
+		{
+			append_unique(chars, &spec[p], 1);
+			p += 1;
+		}
+	}
+	return chars.empty() ? -1 : 0;
+}
+
+MaskGenerator::MaskGenerator()
+	: total(0), pos(0), begin_pos(0), end_pos(0)
+{
+	memset(current, 0, sizeof(current));
+}
+
+/**
+ *@brief 解析掩码
+ *@param mask 掩码，如?l?l?d?d?d
+ *@param custom MASK_CUSTOM_NUM个自定义字符集的定义，为空字符串的没有定义
+ *@return 成功返回0，出错返回-1
+ */
+int MaskGenerator::parse(const std::string &mask, const std::string *custom)
+{
+	sets.clear();
+	total = 0;
+	//! 1.展开自定义字符集
+	std::string custom_set[MASK_CUSTOM_NUM];
+	for (int i = 0; i < MASK_CUSTOM_NUM; ++i)
+	{
+		if (!custom[i].empty() && parse_mask_charset(custom[i], custom_set[i]) != 0)
+		{
+			error_msg = "custom charset -" + std::string(1, (char)('1' + i)) + " is invalid: " + custom[i];
+			return -1;
+		}
+	}
+	//! 2.逐个位置解析字符集
+	size_t p = 0;
+	while (p < mask.size())
+	{
+		std::string set;
+		if (mask[p] == '?')
+		{
+			if (p + 1 >= mask.size())
+			{
+				error_msg = "mask ends with a single '?'";
+				return -1;
+			}
+			char c = mask[p + 1];
+			std::string store;
+			const char *builtin = builtin_charset(c, store);
+			if (builtin != NULL)
+				set = builtin;
+			else if (c == '?')
+				set = "?";
+			else if (c >= '1' && c < '1' + MASK_CUSTOM_NUM)
+			{
+				set = custom_set[c - '1'];
+				if (set.empty())
+				{
+					error_msg = "mask uses ?" + std::string(1, c) + " but -" + std::string(1, c) + " is not given";
+					return -1;
+				}
+			}
+			else
+			{
+				error_msg = "unknown placeholder ?" + std::string(1, c) + " in mask";
+				return -1;
+			}
+			p += 2;
+		}
+		else if (mask[p] == '[')
+		{
+			int used = parse_range(mask, p, set);
+			if (used < 0)
+			{
+				error_msg = "invalid [x-y] group in mask at position " + std::to_string(p);
+				return -1;
+			}
+			p += used;
+		}
+		else
+		{
+			set = mask.substr(p, 1);
+			p += 1;
+		}
+		sets.push_back(set);
+	}
+	if (sets.empty() || sets.size() > MASK_MAX_LEN)
+	{
+		error_msg = "mask must describe 1.." + std::to_string(MASK_MAX_LEN) + " characters";
+		return -1;
+	}
+	//! 3.口令空间为各位置字符集大小之积，必须能用有符号64位整数表示
+	total = 1;
+	for (size_t i = 0; i < sets.size(); ++i)
+	{
+		if (total > (unsigned long long)INT64_MAX / sets[i].size())
+		{
+			total = 0;
+			error_msg = "mask keyspace exceeds 2^63";
+			return -1;
+		}
+		total *= sets[i].size();
+	}
+	digit.assign(sets.size(), 0);
+	begin_pos = 0;
+	end_pos = total;
+	set_position(0);
+	return 0;
+}
+
+/**
+ *@brief 把下标分解为每个位置的字符下标，并重建当前口令
+ */
+void MaskGenerator::set_position(unsigned long long index)
+{
+	pos = index;
+	if (index >= total)
+		return;
+	for (int i = (int)sets.size() - 1; i >= 0; --i)
+	{
+		unsigned long long size = sets[i].size();
+		digit[i] = (int)(index % size);
+		index /= size;
+		current[i] = sets[i][digit[i]];
+	}
+}
+
+int MaskGenerator::set_range(unsigned long long begin, unsigned long long end)
+{
+	if (begin > end || end > total)
+		return -1;
+	begin_pos = begin;
+	end_pos = end;
+	set_position(begin);
+	return 0;
+}
+
+/**
+ *@brief 第k段为[total*(k-1)/n, total*k/n)，用128位乘法避免溢出
+ */
+int MaskGenerator::shard(int k, int n)
+{
+	if (n <= 0 || k < 1 || k > n)
+		return -1;
+	unsigned long long begin = (unsigned long long)((unsigned __int128)total * (k - 1) / n);
+	unsigned long long end = (unsigned long long)((unsigned __int128)total * k / n);
+	return set_range(begin, end);
+}
+
+int MaskGenerator::seek(unsigned long long index)
+{
+	if (index < begin_pos || index > end_pos)
+		return -1;
+	set_position(index);
+	return 0;
+}
+
+/**
+ *@brief 产生最多n个口令
+ * 当前口令像里程表一样递增：最后一个位置加1，满了归零并向前进位，
+ * 大多数口令只改写最后一个字符
+ *@param arena 本批的分配器，口令复制到其中
+ *@param pwd 输出每个口令的地址
+ *@param len 输出每个口令的长度
+ *@param n 最多产生的个数
+ *@return 产生的个数
+ */
+int MaskGenerator::generate(BatchArena &arena, const char **pwd, int *len, int n)
+{
+	unsigned long long left = end_pos - pos;
+	int count = left < (unsigned long long)n ? (int)left : n;
+	if (count <= 0)
+		return 0;
+	int width = (int)sets.size();
+	//! 1.整批口令一次分配，每个口令紧接着上一个
+	char *dst = (char *)arena.alloc((size_t)count * width, 1);
+	for (int i = 0; i < count; ++i)
+	{
+		memcpy(dst, current, width);
+		pwd[i] = dst;
+		len[i] = width;
+		dst += width;
+		//! 2.递增到下一个口令
+		for (int j = width - 1; j >= 0; --j)
+		{
+			if (++digit[j] < (int)sets[j].size())
+			{
+				current[j] = sets[j][digit[j]];
+				break;
+			}
+			digit[j] = 0;
+			current[j] = sets[j][0];
+		}
+	}
+	pos += count;
+	return count;
+}
@@ -0,0 +1,252 @@
+/**
+ *@file md5_mb.cpp
+ *@brief 多缓冲MD5链式迭代的内核选择与分组调度
+ *@version 0.1
+ */
+#include "include/md5_mb.h"
+#include "include/common.h"
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+/**
+ *@brief 多缓冲MD5内核描述
+ */
+struct md5_mb_kernel {
+	const char *name;     //内核名称
+	int lanes;            //通道数
+	md5_mb_iterate_fn iterate;    //为NULL表示逐条链调用md5_chain_iterate()
+	const md5_mb_iterate_fn *fixed;    //迭代轮数为编译期常量的内核表
+};
+
+static const struct md5_mb_kernel md5_mb_kernels[] = {
+#if defined(__x86_64__) || defined(__i386__)
+	{"avx512", 16, md5_mb_iterate_avx512, md5_mb_fixed_avx512},
+	{"avx2", 8, md5_mb_iterate_avx2, md5_mb_fixed_avx2},
+	{"sse2", 4, md5_mb_iterate_sse2, md5_mb_fixed_sse2},
+#endif
+	{"scalar", 1, NULL, NULL},
+};
+
+/**
+ *@brief 判断CPU是否支持内核需要的指令集
+ */
+static bool cpu_supports_kernel(const struct md5_mb_kernel *kernel)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_cpu_init();
+	if (strcmp(kernel->name, "avx512") == 0)
+		return __builtin_cpu_supports("avx512f");
+	if (strcmp(kernel->name, "avx2") == 0)
+		return __builtin_cpu_supports("avx2");
+	if (strcmp(kernel->name, "sse2") == 0)
+		return __builtin_cpu_supports("sse2");
+#endif
+	return true;
+}
+
+/**
+ *@brief 选择CPU支持的最宽内核，环境变量MYJTR_MD5_KERNEL可以指定内核名称(用于对比测试)
+ */
+static const struct md5_mb_kernel *select_kernel()
+{
+	int kernel_num = sizeof(md5_mb_kernels) / sizeof(md5_mb_kernels[0]);
+	const char *forced = getenv("MYJTR_MD5_KERNEL");
+	for (int i = 0; i < kernel_num; ++i)
+	{
+		if (forced && strcmp(forced, md5_mb_kernels[i].name) != 0)
+			continue;
+		if (cpu_supports_kernel(&md5_mb_kernels[i]))
+			return &md5_mb_kernels[i];
+	}
+	return &md5_mb_kernels[kernel_num - 1];
+}
+
+/**
+ *@brief 第一次使用时选择一次内核
+ * 用函数内的静态对象而不是文件作用域的静态对象，嵌入libmyjtr的程序在自己的静态构造函数中调用时也已初始化，
+ * 局部静态对象的初始化是线程安全的
+ */
+static const struct md5_mb_kernel *cur_kernel()
+{
+	static const struct md5_mb_kernel *kernel = select_kernel();
+	return kernel;
+}
+
+const char *md5_mb_kernel_name()
+{
+	return cur_kernel()->name;
+}
+
+int md5_mb_kernel_lanes()
+{
+	return cur_kernel()->lanes;
+}
+
+//! 一条链每轮的消息分组数：16字节摘要 + 口令 + 1字节0x80 + 8字节长度
+static inline int md5_mb_lane_blocks(const struct md5_mb_lane *lane)
+{
+	return (MD5_DIGEST_SIZE + lane->pwd_len + 8) / MD5_BLOCK_SIZE + 1;
+}
+
+/**
+ *@brief 用md5_chain逐条执行一条链
+ */
+static void scalar_chain_iterate(struct md5_mb_lane *lane, uint32_t count)
+{
+	struct md5_chain chain;
+	md5_chain_init(&chain, lane->pwd, lane->pwd_len);
+	md5_chain_iterate(&chain, lane->digest, count);
+	md5_chain_free(&chain);
+}
+
+/**
+ *@brief 把最多kernel->lanes条链交织放入向量内核执行，不足的通道用第一条链填充，结果丢弃
+ *@param iterate 内核函数，运行时迭代轮数内核或编译期特化内核
+ *@param group 需要执行的链
+ *@param n 链的条数，不超过kernel->lanes
+ *@param count 迭代轮数
+ */
+static void simd_group_iterate(const struct md5_mb_kernel *kernel, md5_mb_iterate_fn iterate, struct md5_mb_lane **group, int n, uint32_t count)
+{
+	const int W = kernel->lanes;
+	alignas(64) uint32_t msg[MD5_MB_MAX_BLOCKS * 16 * MD5_MB_MAX_LANES];
+	alignas(64) uint32_t last_mask[MD5_MB_MAX_BLOCKS * MD5_MB_MAX_LANES];
+	alignas(64) uint32_t digest[4 * MD5_MB_MAX_LANES];
+	int nblocks = 1;
+
+	memset(last_mask, 0, sizeof(last_mask));
+	for (int lane = 0; lane < W; ++lane)
+	{
+		struct md5_mb_lane *src = group[lane < n ? lane : 0];
+		struct md5_chain chain;
+		md5_chain_init(&chain, src->pwd, src->pwd_len);
+		for (int blk = 0; blk < chain.nblocks; ++blk)
+		{
+			for (int i = 0; i < 16; ++i)
+				msg[(blk * 16 + i) * W + lane] = chain.words[blk * 16 + i];
+		}
+		last_mask[(chain.nblocks - 1) * W + lane] = 0xffffffff;
+		if (chain.nblocks > nblocks)
+			nblocks = chain.nblocks;
+		md5_chain_free(&chain);
+		for (int i = 0; i < 4; ++i)
+			digest[i * W + lane] = src->digest[i];
+	}
+
+	iterate(msg, last_mask, nblocks, digest, count);
+
+	for (int lane = 0; lane < n; ++lane)
+	{
+		for (int i = 0; i < 4; ++i)
+			group[lane]->digest[i] = digest[i * W + lane];
+	}
+}
+
+/**
+ *@brief 用指定的内核对n条独立的链各执行count轮 digest = MD5(digest || pwd)
+ * 分组数不超过MD5_MB_MAX_BLOCKS的链按分组数分桶，每kernel->lanes条一组交给向量内核，其余链逐条执行。
+ * 各链的结果写回自己的lanes[i]，执行顺序不影响调用者看到的顺序
+ *@param kernel 内核
+ *@param iterate 内核中的函数，运行时迭代轮数内核或迭代轮数为count的特化内核，scalar内核为NULL
+ *@param lanes 链数组
+ *@param n 链的条数
+ *@param count 迭代轮数
+ */
+static void kernel_chain_iterate(const struct md5_mb_kernel *kernel, md5_mb_iterate_fn iterate, struct md5_mb_lane *lanes, int n, uint32_t count)
+{
+	if (iterate == NULL)
+	{
+		for (int i = 0; i < n; ++i)
+			scalar_chain_iterate(&lanes[i], count);
+		return;
+	}
+
+	//! 1. 按每轮的消息分组数把链分桶，从分组数多的桶开始，每kernel->lanes条一组交给向量内核。
+	//     同步执行的一组链都要付出其中最长链的分组数，分桶后只有桶之间衔接处的一组混有不同长度；
+	//     不满一组的桶不单独执行，与下一个桶合并，混合组的代价是其中最长的链，比各桶各执行一次少
+	struct md5_mb_lane *group[MD5_MB_MAX_LANES];
+	int group_size = 0;
+	for (int i = 0; i < n; ++i)
+	{
+		if (md5_mb_lane_blocks(&lanes[i]) > MD5_MB_MAX_BLOCKS)
+			scalar_chain_iterate(&lanes[i], count);
+	}
+	for (int blocks = MD5_MB_MAX_BLOCKS; blocks >= 1; --blocks)
+	{
+		for (int i = 0; i < n; ++i)
+		{
+			if (md5_mb_lane_blocks(&lanes[i]) != blocks)
+				continue;
+			group[group_size++] = &lanes[i];
+			if (group_size == kernel->lanes)
+			{
+				simd_group_iterate(kernel, iterate, group, group_size, count);
+				group_size = 0;
+			}
+		}
+	}
+	if (group_size == 1)
+		scalar_chain_iterate(group[0], count);
+	else if (group_size > 1)
+		simd_group_iterate(kernel, iterate, group, group_size, count);
+}
+
+/**
+ *@brief 按迭代轮数选择内核中的函数，轮数为2^11..2^14时使用编译期特化的内核
+ */
+static md5_mb_iterate_fn count_iterate(const struct md5_mb_kernel *kernel, uint32_t count)
+{
+	if (kernel->iterate == NULL)
+		return NULL;
+	for (int i = 0; i < MD5_MB_FIXED_NUM; ++i)
+	{
+		if (count == 1u << (MD5_MB_FIXED_MIN_LOG2 + i))
+			return kernel->fixed[i];
+	}
+	return kernel->iterate;
+}
+
+void md5_mb_chain_iterate(struct md5_mb_lane *lanes, int n, uint32_t count)
+{
+	const struct md5_mb_kernel *kernel = cur_kernel();
+	kernel_chain_iterate(kernel, count_iterate(kernel, count), lanes, n, count);
+}
+
+/**
+ *@brief 迭代轮数为编译期常量2^LOG2时直接使用当前内核中对应的特化函数，不按count查找
+ */
+template <int LOG2>
+void md5_mb_chain_iterate_fixed(struct md5_mb_lane *lanes, int n)
+{
+	static_assert(LOG2 >= MD5_MB_FIXED_MIN_LOG2 && LOG2 < MD5_MB_FIXED_MIN_LOG2 + MD5_MB_FIXED_NUM, "no fixed kernel for LOG2");
+	const struct md5_mb_kernel *kernel = cur_kernel();
+	kernel_chain_iterate(kernel, kernel->iterate == NULL ? NULL : kernel->fixed[LOG2 - MD5_MB_FIXED_MIN_LOG2], lanes, n, 1u << LOG2);
+}
+
+template void md5_mb_chain_iterate_fixed<MD5_MB_FIXED_MIN_LOG2>(struct md5_mb_lane *lanes, int n);
+template void md5_mb_chain_iterate_fixed<MD5_MB_FIXED_MIN_LOG2 + 1>(struct md5_mb_lane *lanes, int n);
+template void md5_mb_chain_iterate_fixed<MD5_MB_FIXED_MIN_LOG2 + 2>(struct md5_mb_lane *lanes, int n);
+template void md5_mb_chain_iterate_fixed<MD5_MB_FIXED_MIN_LOG2 + 3>(struct md5_mb_lane *lanes, int n);
+
+int md5_mb_kernel_num()
+{
+	return sizeof(md5_mb_kernels) / sizeof(md5_mb_kernels[0]);
+}
+
+const char *md5_mb_kernel_name_at(int i)
+{
+	return md5_mb_kernels[i].name;
+}
+
+/**
+ *@brief 用第i个内核执行md5_mb_chain_iterate，不经过启动时的内核选择，用于自检对比各内核
+ *@return 0：正确，-1：CPU不支持该内核
+ */
+int md5_mb_chain_iterate_kernel(int i, struct md5_mb_lane *lanes, int n, uint32_t count)
+{
+	if (!cpu_supports_kernel(&md5_mb_kernels[i]))
+		return -1;
+	kernel_chain_iterate(&md5_mb_kernels[i], count_iterate(&md5_mb_kernels[i], count), lanes, n, count);
+	return 0;
+}
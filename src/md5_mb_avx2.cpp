@@ -0,0 +1,38 @@
+/**
+ *@file md5_mb_avx2.cpp
+ *@brief AVX2实现的8通道多缓冲MD5链式迭代，本文件以-mavx2编译
+ *@version 0.1
+ */
+#include "include/md5_mb.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#include "include/md5_mb_impl.h"
+
+namespace {
+
+//! AVX2向量运算，每个向量8个32位通道
+struct avx2_vec {
+	typedef __m256i vec;
+	static const int LANES = 8;
+	static inline vec set1(uint32_t x) { return _mm256_set1_epi32(x); }
+	static inline vec load(const uint32_t *p) { return _mm256_loadu_si256((const __m256i *)p); }
+	static inline void store(uint32_t *p, vec x) { _mm256_storeu_si256((__m256i *)p, x); }
+	static inline vec add(vec a, vec b) { return _mm256_add_epi32(a, b); }
+	static inline vec band(vec a, vec b) { return _mm256_and_si256(a, b); }
+	static inline vec bor(vec a, vec b) { return _mm256_or_si256(a, b); }
+	static inline vec bxor(vec a, vec b) { return _mm256_xor_si256(a, b); }
+	static inline vec bandnot(vec a, vec b) { return _mm256_andnot_si256(a, b); }
+	static inline vec F(vec x, vec y, vec z) { return bxor(z, band(x, bxor(y, z))); }
+	static inline vec G(vec x, vec y, vec z) { return bxor(y, band(z, bxor(x, y))); }
+	static inline vec H(vec x, vec y, vec z) { return bxor(bxor(x, y), z); }
+	static inline vec I(vec x, vec y, vec z) { return bxor(y, bor(x, bxor(z, set1(0xffffffff)))); }
+	template <int s> static inline vec rotl(vec x) { return bor(_mm256_slli_epi32(x, s), _mm256_srli_epi32(x, 32 - s)); }
+};
+
+}
+
+//AVX2的8通道多缓冲MD5链式迭代内核，参数含义见md5_mb_iterate()
+MD5_MB_DEFINE_KERNELS(avx2, avx2_vec)
+
+#endif
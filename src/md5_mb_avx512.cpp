@@ -0,0 +1,39 @@
+/**
+ *@file md5_mb_avx512.cpp
+ *@brief AVX-512实现的16通道多缓冲MD5链式迭代，本文件以-mavx512f编译
+ * 四个基本函数各用一条vpternlogd完成，循环移位使用vprold
+ *@version 0.1
+ */
+#include "include/md5_mb.h"
+
+#ifdef __AVX512F__
+#include <immintrin.h>
+#include "include/md5_mb_impl.h"
+
+namespace {
+
+//! AVX-512向量运算，每个向量16个32位通道
+struct avx512_vec {
+	typedef __m512i vec;
+	static const int LANES = 16;
+	static inline vec set1(uint32_t x) { return _mm512_set1_epi32(x); }
+	static inline vec load(const uint32_t *p) { return _mm512_loadu_si512((const void *)p); }
+	static inline void store(uint32_t *p, vec x) { _mm512_storeu_si512((void *)p, x); }
+	static inline vec add(vec a, vec b) { return _mm512_add_epi32(a, b); }
+	static inline vec band(vec a, vec b) { return _mm512_and_si512(a, b); }
+	static inline vec bor(vec a, vec b) { return _mm512_or_si512(a, b); }
+	static inline vec bandnot(vec a, vec b) { return _mm512_andnot_si512(a, b); }
+	//真值表下标为 x<<2 | y<<1 | z
+	static inline vec F(vec x, vec y, vec z) { return _mm512_ternarylogic_epi32(x, y, z, 0xca); }    //x ? y : z
+	static inline vec G(vec x, vec y, vec z) { return _mm512_ternarylogic_epi32(x, y, z, 0xe4); }    //z ? x : y
+	static inline vec H(vec x, vec y, vec z) { return _mm512_ternarylogic_epi32(x, y, z, 0x96); }    //x ^ y ^ z
+	static inline vec I(vec x, vec y, vec z) { return _mm512_ternarylogic_epi32(x, y, z, 0x39); }    //y ^ (x | ~z)
+	template <int s> static inline vec rotl(vec x) { return _mm512_rol_epi32(x, s); }
+};
+
+}
+
+//AVX-512的16通道多缓冲MD5链式迭代内核，参数含义见md5_mb_iterate()
+MD5_MB_DEFINE_KERNELS(avx512, avx512_vec)
+
+#endif
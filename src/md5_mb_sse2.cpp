@@ -0,0 +1,38 @@
+/**
+ *@file md5_mb_sse2.cpp
+ *@brief SSE2实现的4通道多缓冲MD5链式迭代
+ *@version 0.1
+ */
+#include "include/md5_mb.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#include "include/md5_mb_impl.h"
+
+namespace {
+
+//! SSE2向量运算，每个向量4个32位通道
+struct sse2_vec {
+	typedef __m128i vec;
+	static const int LANES = 4;
+	static inline vec set1(uint32_t x) { return _mm_set1_epi32(x); }
+	static inline vec load(const uint32_t *p) { return _mm_loadu_si128((const __m128i *)p); }
+	static inline void store(uint32_t *p, vec x) { _mm_storeu_si128((__m128i *)p, x); }
+	static inline vec add(vec a, vec b) { return _mm_add_epi32(a, b); }
+	static inline vec band(vec a, vec b) { return _mm_and_si128(a, b); }
+	static inline vec bor(vec a, vec b) { return _mm_or_si128(a, b); }
+	static inline vec bxor(vec a, vec b) { return _mm_xor_si128(a, b); }
+	static inline vec bandnot(vec a, vec b) { return _mm_andnot_si128(a, b); }
+	static inline vec F(vec x, vec y, vec z) { return bxor(z, band(x, bxor(y, z))); }
+	static inline vec G(vec x, vec y, vec z) { return bxor(y, band(z, bxor(x, y))); }
+	static inline vec H(vec x, vec y, vec z) { return bxor(bxor(x, y), z); }
+	static inline vec I(vec x, vec y, vec z) { return bxor(y, bor(x, bxor(z, set1(0xffffffff)))); }
+	template <int s> static inline vec rotl(vec x) { return bor(_mm_slli_epi32(x, s), _mm_srli_epi32(x, 32 - s)); }
+};
+
+}
+
+//SSE2的4通道多缓冲MD5链式迭代内核，参数含义见md5_mb_iterate()
+MD5_MB_DEFINE_KERNELS(sse2, sse2_vec)
+
+#endif
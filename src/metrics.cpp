@@ -0,0 +1,381 @@
+/**
+ *@file metrics.cpp
+ *@brief 运行时性能指标实现文件
+ *
+ * 每个线程第一次计时时分配一个按缓存行对齐的计数器槽，之后只修改自己的槽，线程之间不共享缓存行；
+ * 每级记录调用次数、记录数、总周期数和按log2(周期数)分桶的延迟直方图。
+ * 输出线程定期汇总所有槽，按两次汇总的差值计算区间内的吞吐量、各级平均并发数(load)和延迟分位数，
+ * 输出到标准错误，并原子地改写Prometheus文本格式文件。关闭统计时每次计时只多一次判断
+ *@version 0.1
+ */
+#include "include/metrics.h"
+#include "include/state_file.h"
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <stdio.h>
+#include <string.h>
+
+bool metrics_enabled = false;
+
+static const char *stage_names[METRIC_STAGE_NUM] = {"read", "salt", "prepare", "hash", "cipher", "write"};
+
+/**
+ *@brief 一级的计数器，只由所属线程累加，输出线程读取
+ */
+struct metric_counter {
+	std::atomic<uint64_t> calls;
+	std::atomic<uint64_t> records;
+	std::atomic<uint64_t> cycles;
+	std::atomic<uint64_t> hist[METRICS_HIST_BUCKETS];
+};
+
+//! 一个线程的计数器槽，按缓存行对齐
+struct alignas(64) metric_slot {
+	struct metric_counter stage[METRIC_STAGE_NUM];
+};
+
+/**
+ *@brief 一次汇总的结果，total为所有线程之和，thread_records和thread_cycles按线程和级展开
+ */
+struct metric_snapshot {
+	uint64_t clock;
+	uint64_t calls[METRIC_STAGE_NUM];
+	uint64_t records[METRIC_STAGE_NUM];
+	uint64_t cycles[METRIC_STAGE_NUM];
+	uint64_t hist[METRIC_STAGE_NUM][METRICS_HIST_BUCKETS];
+	std::vector<uint64_t> thread_records;
+	std::vector<uint64_t> thread_cycles;
+};
+
+static struct metric_slot slots[METRICS_MAX_THREADS];
+static std::atomic<int> slot_num(0);
+static std::atomic<int> generation(0);    //每次metrics_start()加1，线程据此重新分配槽
+static thread_local struct metric_slot *my_slot = NULL;
+static thread_local int my_generation = -1;
+
+static std::thread reporter;
+static std::mutex report_mutex;
+static std::condition_variable report_cond;
+static bool reporter_stop = false;
+static int report_interval = 0;
+static std::string prom_path;
+static uint64_t start_clock = 0;
+static std::chrono::steady_clock::time_point start_time;
+
+static std::mutex sampler_mutex;
+static metrics_sampler queue_sampler = NULL;
+static void *sampler_arg = NULL;
+static const char *const *queue_names = NULL;
+
+/**
+ *@brief 累加一次调用，线程第一次调用(或重新开启统计后第一次调用)时分配计数器槽
+ *@param stage 所在级
+ *@param cycles 耗时的时钟周期数
+ *@param records 处理的记录数
+ */
+void metrics_record(int stage, uint64_t cycles, long long records)
+{
+	if (my_generation != generation.load(std::memory_order_relaxed))
+	{
+		int i = slot_num.fetch_add(1);
+		my_slot = &slots[i < METRICS_MAX_THREADS ? i : METRICS_MAX_THREADS - 1];
+		my_generation = generation.load(std::memory_order_relaxed);
+	}
+	struct metric_counter &c = my_slot->stage[stage];
+	int bucket = cycles == 0 ? 0 : 63 - __builtin_clzll(cycles);
+	if (bucket >= METRICS_HIST_BUCKETS)
+		bucket = METRICS_HIST_BUCKETS - 1;
+	c.calls.fetch_add(1, std::memory_order_relaxed);
+	c.records.fetch_add(records, std::memory_order_relaxed);
+	c.cycles.fetch_add(cycles, std::memory_order_relaxed);
+	c.hist[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+//! 汇总所有线程的计数器
+static void take_snapshot(struct metric_snapshot *snap)
+{
+	memset(snap->calls, 0, sizeof(snap->calls));
+	memset(snap->records, 0, sizeof(snap->records));
+	memset(snap->cycles, 0, sizeof(snap->cycles));
+	memset(snap->hist, 0, sizeof(snap->hist));
+	int threads = slot_num.load();
+	if (threads > METRICS_MAX_THREADS)
+		threads = METRICS_MAX_THREADS;
+	snap->thread_records.assign((size_t)threads * METRIC_STAGE_NUM, 0);
+	snap->thread_cycles.assign((size_t)threads * METRIC_STAGE_NUM, 0);
+	snap->clock = metrics_clock();
+	for (int t = 0; t < threads; ++t)
+	{
+		for (int s = 0; s < METRIC_STAGE_NUM; ++s)
+		{
+			const struct metric_counter &c = slots[t].stage[s];
+			uint64_t records = c.records.load(std::memory_order_relaxed);
+			uint64_t cycles = c.cycles.load(std::memory_order_relaxed);
+			snap->calls[s] += c.calls.load(std::memory_order_relaxed);
+			snap->records[s] += records;
+			snap->cycles[s] += cycles;
+			for (int b = 0; b < METRICS_HIST_BUCKETS; ++b)
+				snap->hist[s][b] += c.hist[b].load(std::memory_order_relaxed);
+			snap->thread_records[t * METRIC_STAGE_NUM + s] = records;
+			snap->thread_cycles[t * METRIC_STAGE_NUM + s] = cycles;
+		}
+	}
+}
+
+//! 每秒的时钟周期数，由开启统计以来的周期数和时间估计
+static double clock_rate(uint64_t now)
+{
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+	if (seconds <= 0 || now <= start_clock)
+		return 1e9;
+	return (now - start_clock) / seconds;
+}
+
+//! 区间内第q分位的延迟上界，单位微秒
+static double percentile_us(const uint64_t *hist, const uint64_t *prev_hist, uint64_t count, double q, double rate)
+{
+	uint64_t sum = 0;
+	for (int b = 0; b < METRICS_HIST_BUCKETS; ++b)
+	{
+		sum += hist[b] - (prev_hist ? prev_hist[b] : 0);
+		if (sum >= q * count)
+			return (double)(2ULL << b) / rate * 1e6;
+	}
+	return (double)(1ULL << METRICS_HIST_BUCKETS) / rate * 1e6;
+}
+
+/**
+ *@brief 把cur相对prev(为NULL时相对开启统计时)的变化输出到标准错误
+ *@param rate 每秒的时钟周期数
+ *@param depth 各队列深度，为NULL时不输出
+ */
+static void print_report(const struct metric_snapshot &cur, const struct metric_snapshot *prev, double rate, const int *depth)
+{
+	uint64_t begin_clock = prev ? prev->clock : start_clock;
+	double seconds = (cur.clock - begin_clock) / rate;
+	double uptime = (cur.clock - start_clock) / rate;
+	uint64_t hashes = cur.records[METRIC_HASH] - (prev ? prev->records[METRIC_HASH] : 0);
+	char line[256];
+
+	snprintf(line, sizeof(line), "metrics: %s%.1f s, %.0f hash/s", prev ? "" : "total ", uptime, seconds > 0 ? hashes / seconds : 0);
+	std::cerr << line;
+	if (depth != NULL)
+	{
+		std::cerr << ", queue";
+		for (int q = 0; q < METRICS_QUEUE_NUM; ++q)
+			if (depth[q] >= 0)
+				std::cerr << " " << queue_names[q] << "=" << depth[q];
+	}
+	std::cerr << std::endl;
+
+	for (int s = 0; s < METRIC_STAGE_NUM; ++s)
+	{
+		uint64_t calls = cur.calls[s] - (prev ? prev->calls[s] : 0);
+		if (calls == 0)
+			continue;
+		uint64_t records = cur.records[s] - (prev ? prev->records[s] : 0);
+		uint64_t cycles = cur.cycles[s] - (prev ? prev->cycles[s] : 0);
+		snprintf(line, sizeof(line), "metrics:   %-8s calls=%llu records=%llu load=%.2f avg=%.1fus p50<%.1fus p99<%.1fus",
+			stage_names[s], (unsigned long long)calls, (unsigned long long)records,
+			seconds > 0 ? cycles / rate / seconds : 0, cycles / rate * 1e6 / calls,
+			percentile_us(cur.hist[s], prev ? prev->hist[s] : NULL, calls, 0.5, rate),
+			percentile_us(cur.hist[s], prev ? prev->hist[s] : NULL, calls, 0.99, rate));
+		std::cerr << line << std::endl;
+	}
+}
+
+/**
+ *@brief 写Prometheus文本格式文件需要的数据
+ */
+struct prom_data {
+	const struct metric_snapshot *cur;
+	double rate;         //时钟频率
+	double hash_rate;    //最近一个区间的hash/s
+	const int *depth;    //各队列的长度，为NULL时不输出
+};
+
+//! 以Prometheus文本格式写出累计值
+static int write_prom_fields(FILE *fp, const void *arg)
+{
+	const struct prom_data *data = (const struct prom_data *)arg;
+	const struct metric_snapshot &cur = *data->cur;
+	double rate = data->rate, hash_rate = data->hash_rate;
+	const int *depth = data->depth;
+
+	fprintf(fp, "# HELP myjtr_uptime_seconds Seconds since metrics were enabled.\n# TYPE myjtr_uptime_seconds gauge\n");
+	fprintf(fp, "myjtr_uptime_seconds %.3f\n", (cur.clock - start_clock) / rate);
+	fprintf(fp, "# HELP myjtr_hashes_per_second Hashes per second over the last interval.\n# TYPE myjtr_hashes_per_second gauge\n");
+	fprintf(fp, "myjtr_hashes_per_second %.1f\n", hash_rate);
+
+	fprintf(fp, "# HELP myjtr_stage_records_total Records processed by each stage.\n# TYPE myjtr_stage_records_total counter\n");
+	for (int s = 0; s < METRIC_STAGE_NUM; ++s)
+		fprintf(fp, "myjtr_stage_records_total{stage=\"%s\"} %llu\n", stage_names[s], (unsigned long long)cur.records[s]);
+
+	fprintf(fp, "# HELP myjtr_stage_latency_seconds Latency of one call of each stage.\n# TYPE myjtr_stage_latency_seconds histogram\n");
+	for (int s = 0; s < METRIC_STAGE_NUM; ++s)
+	{
+		//直方图按周期数分桶，换算成固定的le边界，抓取之间le不随时钟频率的估计值变化
+		uint64_t sum = 0;
+		int b = 0;
+		for (int k = 0; k < METRICS_PROM_BUCKETS; ++k)
+		{
+			double le = 1e-6 * (1 << k);
+			for (; b < METRICS_HIST_BUCKETS && (double)(2ULL << b) <= le * rate; ++b)
+				sum += cur.hist[s][b];
+			fprintf(fp, "myjtr_stage_latency_seconds_bucket{stage=\"%s\",le=\"%g\"} %llu\n",
+				stage_names[s], le, (unsigned long long)sum);
+		}
+		fprintf(fp, "myjtr_stage_latency_seconds_bucket{stage=\"%s\",le=\"+Inf\"} %llu\n", stage_names[s], (unsigned long long)cur.calls[s]);
+		fprintf(fp, "myjtr_stage_latency_seconds_sum{stage=\"%s\"} %.6f\n", stage_names[s], cur.cycles[s] / rate);
+		fprintf(fp, "myjtr_stage_latency_seconds_count{stage=\"%s\"} %llu\n", stage_names[s], (unsigned long long)cur.calls[s]);
+	}
+
+	fprintf(fp, "# HELP myjtr_thread_records_total Records processed by each thread and stage.\n# TYPE myjtr_thread_records_total counter\n");
+	for (size_t i = 0; i < cur.thread_records.size(); ++i)
+		if (cur.thread_records[i] > 0)
+			fprintf(fp, "myjtr_thread_records_total{thread=\"%d\",stage=\"%s\"} %llu\n",
+				(int)(i / METRIC_STAGE_NUM), stage_names[i % METRIC_STAGE_NUM], (unsigned long long)cur.thread_records[i]);
+	fprintf(fp, "# HELP myjtr_thread_busy_seconds_total Seconds spent by each thread in each stage.\n# TYPE myjtr_thread_busy_seconds_total counter\n");
+	for (size_t i = 0; i < cur.thread_cycles.size(); ++i)
+		if (cur.thread_cycles[i] > 0)
+			fprintf(fp, "myjtr_thread_busy_seconds_total{thread=\"%d\",stage=\"%s\"} %.6f\n",
+				(int)(i / METRIC_STAGE_NUM), stage_names[i % METRIC_STAGE_NUM], cur.thread_cycles[i] / rate);
+
+	if (depth != NULL)
+	{
+		fprintf(fp, "# HELP myjtr_queue_depth Batches waiting in each pipeline queue.\n# TYPE myjtr_queue_depth gauge\n");
+		for (int q = 0; q < METRICS_QUEUE_NUM; ++q)
+			if (depth[q] >= 0)
+				fprintf(fp, "myjtr_queue_depth{queue=\"%s\"} %d\n", queue_names[q], depth[q]);
+	}
+
+	return 0;
+}
+
+/**
+ *@brief 以Prometheus文本格式写出累计值，先写临时文件再改名，抓取时总是读到完整的文件
+ *@param hash_rate 最近一个区间的hash/s
+ *@return 0：正确，-1：出错
+ */
+static int write_prom(const struct metric_snapshot &cur, double rate, double hash_rate, const int *depth)
+{
+	struct prom_data data = {&cur, rate, hash_rate, depth};
+	return write_file_atomic(prom_path.c_str(), write_prom_fields, &data, 0);
+}
+
+/**
+ *@brief 汇总一次并输出
+ *@param prev 上一次汇总，为NULL时输出开启统计以来的总计
+ */
+static void report(const struct metric_snapshot &cur, const struct metric_snapshot *prev)
+{
+	double rate = clock_rate(cur.clock);
+	int depth[METRICS_QUEUE_NUM];
+	bool has_depth = false;
+	{
+		std::lock_guard<std::mutex> lock(sampler_mutex);
+		if (queue_sampler != NULL)
+		{
+			queue_sampler(sampler_arg, depth);
+			has_depth = true;
+		}
+	}
+	print_report(cur, prev, rate, has_depth ? depth : NULL);
+
+	if (!prom_path.empty())
+	{
+		uint64_t begin_clock = prev ? prev->clock : start_clock;
+		double seconds = (cur.clock - begin_clock) / rate;
+		uint64_t hashes = cur.records[METRIC_HASH] - (prev ? prev->records[METRIC_HASH] : 0);
+		if (write_prom(cur, rate, seconds > 0 ? hashes / seconds : 0, has_depth ? depth : NULL) != 0)
+			std::cerr << "warning: write metrics file " << prom_path << " failed" << std::endl;
+	}
+}
+
+//! 输出线程：每report_interval秒汇总一次，输出区间内的变化
+static void reporter_thread()
+{
+	struct metric_snapshot prev, cur;
+	take_snapshot(&prev);
+	prev.clock = start_clock;
+	std::unique_lock<std::mutex> lock(report_mutex);
+	while (!report_cond.wait_for(lock, std::chrono::seconds(report_interval), [] { return reporter_stop; }))
+	{
+		take_snapshot(&cur);
+		report(cur, &prev);
+		prev = cur;
+	}
+}
+
+/**
+ *@brief 开启统计并启动输出线程
+ *@param interval 输出间隔秒数
+ *@param path Prometheus文本格式文件路径，NULL表示只输出到标准错误
+ *@return 0：正确，-1：出错
+ */
+int metrics_start(int interval, const char *path)
+{
+	if (interval < 1)
+		return -1;
+	metrics_stop();
+	for (int t = 0; t < METRICS_MAX_THREADS && t < slot_num.load(); ++t)
+	{
+		for (int s = 0; s < METRIC_STAGE_NUM; ++s)
+		{
+			struct metric_counter &c = slots[t].stage[s];
+			c.calls = 0;
+			c.records = 0;
+			c.cycles = 0;
+			for (int b = 0; b < METRICS_HIST_BUCKETS; ++b)
+				c.hist[b] = 0;
+		}
+	}
+	slot_num = 0;
+	++generation;
+	report_interval = interval;
+	prom_path = path != NULL ? path : "";
+	reporter_stop = false;
+	start_time = std::chrono::steady_clock::now();
+	start_clock = metrics_clock();
+	metrics_enabled = true;
+	reporter = std::thread(reporter_thread);
+	return 0;
+}
+
+//! 停止输出线程，输出总计并最后一次写Prometheus文件
+void metrics_stop()
+{
+	if (!metrics_enabled)
+		return;
+	{
+		std::lock_guard<std::mutex> lock(report_mutex);
+		reporter_stop = true;
+	}
+	report_cond.notify_all();
+	reporter.join();
+
+	struct metric_snapshot cur;
+	take_snapshot(&cur);
+	report(cur, NULL);
+	metrics_enabled = false;
+}
+
+/**
+ *@brief 注册队列深度的采样函数，输出线程每次汇总时调用
+ *@param sampler 采样函数，NULL表示取消注册
+ *@param arg 传给采样函数的参数
+ *@param names METRICS_QUEUE_NUM个队列名称
+ */
+void metrics_watch_queues(metrics_sampler sampler, void *arg, const char *const *names)
+{
+	std::lock_guard<std::mutex> lock(sampler_mutex);
+	queue_sampler = sampler;
+	sampler_arg = arg;
+	queue_names = names;
+}
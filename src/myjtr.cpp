@@ -0,0 +1,197 @@
+/**
+ *@file myjtr.cpp
+ *@brief 可嵌入的批量hash库libmyjtr的实现文件
+ *
+ * 句柄在open()时完成算法名查找、附加信息解析、init_alg_desp和check_cmdline，只做一次；
+ * 产生密文使用按附加信息特化的算法描述，校验时每个密文的参数不同，在每次调用自己的副本上特化。
+ * 随机盐由(句柄的种子, 记录序号)确定，记录序号由原子计数器分配，同一个句柄的各次调用不会得到相同的盐序列
+ *@version 0.1
+ */
+#include "include/myjtr.h"
+#include "include/alg_registry.h"
+#include "include/verify.h"
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <random>
+#include <new>
+
+static_assert(MYJTR_MATCH == VERIFY_MATCH && MYJTR_MISMATCH == VERIFY_MISMATCH && MYJTR_INVALID == VERIFY_INVALID,
+	"MYJTR_* must be the same as VERIFY_*");
+
+/**
+ *@brief 句柄的实现细节，open()之后只有next_index改变
+ */
+struct alg_handle_state {
+	struct alg_desp base;                //check_cmdline()之后的算法描述，校验时复制后按每个密文的参数特化
+	struct alg_desp hash;                //按附加信息特化的算法描述，产生密文用
+	std::atomic<long long> next_index;   //下一次调用的第一个随机盐对应的记录序号
+};
+
+AlgHandle::AlgHandle()
+	: state(NULL)
+{
+}
+
+AlgHandle::~AlgHandle()
+{
+	delete state;
+}
+
+/**
+ *@brief 按算法名和附加信息初始化句柄，可以重新open()，但不能与其它线程对同一个句柄的调用同时进行
+ *@param alg_name 算法名，如wordpress
+ *@param extra "名称=值"形式的附加信息，如salt_len=32、iter_pos=C
+ *@return 0：正确，-1：算法名或附加信息不对
+ */
+int AlgHandle::open(const std::string &alg_name, const std::vector<std::string> &extra)
+{
+	delete state;
+	state = NULL;
+
+	//! 1. 解析附加信息，与命令行的格式相同
+	std::map<std::string, std::string> extra_name_value;
+	for (size_t i = 0; i < extra.size(); ++i)
+	{
+		if (parse_extra_arg(extra[i], extra_name_value, error_msg) != 0)
+			return -1;
+	}
+
+	//! 2. 初始化算法描述并设置当前值
+	struct alg_handle_state *s = new struct alg_handle_state;
+	if (init_named_alg(alg_name, extra_name_value, &s->base, error_msg) != 0)
+	{
+		delete s;
+		return -1;
+	}
+
+	//! 3. 没有给出seed时，句柄不使用进程种子，而是自己从random_device取一个，多个句柄的盐序列互不相同
+	if (s->base.extra[SEED_INDEX].valid && extra_name_value.count("seed") == 0)
+	{
+		std::random_device rd;
+		s->base.extra[SEED_INDEX].cur_value.dlong = ((uint64_t)rd() << 32) | rd();
+	}
+
+	//! 4. 产生密文用的副本选择编译期特化的实现
+	s->hash = s->base;
+	if (s->hash.specialize_alg_desp != NULL && s->hash.specialize_alg_desp(&s->hash) != 0)
+	{
+		error_msg = "specialize_alg_desp() is wrong!";
+		delete s;
+		return -1;
+	}
+	s->next_index = 0;
+	state = s;
+	error_msg.clear();
+	return 0;
+}
+
+/**
+ *@brief 用给定的盐计算n个口令的密文，写入调用者的缓冲区
+ *@param desp 特化后的算法描述，只读
+ *@param salt n个盐的视图
+ *@param arena 本次调用的分配器
+ *@return 0：正确，-1：预处理口令、计算hash值出错或密文超过stride
+ */
+static int hash_with_salts(struct alg_desp *desp, const char *const *pwd, const int *pwd_len, const ByteView *salt, int n,
+	char *cipher, int stride, int *cipher_len, BatchArena &arena)
+{
+	//! 1. 预处理口令，复制到arena中
+	ByteView *pwd_view = (ByteView *)arena.alloc(sizeof(ByteView) * n);
+	ByteView *hash = (ByteView *)arena.alloc(sizeof(ByteView) * n);
+	for (int i = 0; i < n; ++i)
+	{
+		ByteVector bv_pwd = desp->prepare_pwd(pwd[i], pwd_len[i]);
+		if (bv_pwd.isEmpty() && pwd_len[i] > 0)
+			return -1;
+		new (&pwd_view[i]) ByteView(arena.copy(bv_pwd.getByte_p(), bv_pwd.size()));
+		new (&hash[i]) ByteView();
+	}
+
+	//! 2. 批量计算hash值和密文
+	if (alg_hash_pwd_batch(desp, pwd_view, salt, hash, n, arena) != 0)
+		return -1;
+	std::string out;
+	out.reserve((size_t)n * (stride + 1));
+	if (alg_get_cipher_batch(desp, hash, salt, n, out) != 0)
+		return -1;
+
+	//! 3. 按每个密文后的'\n'切分，写入调用者的缓冲区
+	size_t pos = 0;
+	for (int i = 0; i < n; ++i)
+	{
+		size_t end = out.find('\n', pos);
+		if (end == std::string::npos || end - pos > (size_t)stride)
+			return -1;
+		memcpy(cipher + (size_t)i * stride, out.data() + pos, end - pos);
+		cipher_len[i] = end - pos;
+		pos = end + 1;
+	}
+	return 0;
+}
+
+/**
+ *@brief 计算n个口令的密文，每个口令产生一个新的随机盐
+ *@param pwd n个口令，不需要以'\0'结尾
+ *@param pwd_len n个口令的字节数
+ *@param n 口令个数
+ *@param cipher 输出缓冲区，至少n * stride字节
+ *@param stride 每个密文在cipher中占用的字节数，MYJTR_MAX_CIPHER总是足够
+ *@param cipher_len 输出n个密文的字节数
+ *@return 0：正确，-1：出错
+ */
+int AlgHandle::hash_batch(const char *const *pwd, const int *pwd_len, int n, char *cipher, int stride, int *cipher_len) const
+{
+	if (state == NULL || n < 0 || stride <= 0)
+		return -1;
+	if (n == 0)
+		return 0;
+	BatchArena arena;
+	ByteView *salt = (ByteView *)arena.alloc(sizeof(ByteView) * n);
+	for (int i = 0; i < n; ++i)
+		new (&salt[i]) ByteView();
+	if (alg_get_random_salt_batch(&state->hash, salt, n, state->next_index.fetch_add(n), arena) != 0)
+		return -1;
+	return hash_with_salts(&state->hash, pwd, pwd_len, salt, n, cipher, stride, cipher_len, arena);
+}
+
+/**
+ *@brief 用调用者给出的盐计算n个口令的密文，例如重新产生已有用户的密文
+ *@param salt n个盐，按字符原样使用
+ *@param salt_len n个盐的字节数，必须是附加信息salt_len的位数除以8
+ *@return 0：正确，-1：盐的长度不对或出错
+ */
+int AlgHandle::hash_batch(const char *const *pwd, const int *pwd_len, const char *const *salt, const int *salt_len, int n,
+	char *cipher, int stride, int *cipher_len) const
+{
+	if (state == NULL || n < 0 || stride <= 0)
+		return -1;
+	if (n == 0)
+		return 0;
+	const struct extra_info *salt_info = &state->hash.extra[SALT_LEN_INDEX];
+	BatchArena arena;
+	ByteView *salt_view = (ByteView *)arena.alloc(sizeof(ByteView) * n);
+	for (int i = 0; i < n; ++i)
+	{
+		if (salt_len[i] < 0 || salt_len[i] > CIPHER_MAX_SALT || (salt_info->valid && salt_len[i] * 8 != salt_info->cur_value.dint))
+			return -1;
+		new (&salt_view[i]) ByteView((const Byte *)salt[i], salt_len[i]);
+	}
+	return hash_with_salts(&state->hash, pwd, pwd_len, salt_view, n, cipher, stride, cipher_len, arena);
+}
+
+/**
+ *@brief 校验n对(口令, 密文)，密文的盐和迭代次数标识可以各不相同，与getcipher verify相同
+ *@param result 输出n个结果，MYJTR_MATCH、MYJTR_MISMATCH或MYJTR_INVALID
+ *@return 0：正确，-1：算法不支持解析密文或出错
+ */
+int AlgHandle::verify_batch(const char *const *pwd, const int *pwd_len, const char *const *cipher, const int *cipher_len, int n,
+	int *result) const
+{
+	if (state == NULL || n < 0)
+		return -1;
+	if (n == 0)
+		return 0;
+	BatchArena arena;
+	return ::verify_batch(&state->base, pwd, pwd_len, cipher, cipher_len, n, result, arena);
+}
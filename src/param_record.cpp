@@ -0,0 +1,185 @@
+/**
+ *@file param_record.cpp
+ *@brief 每条记录自带参数(盐、迭代次数标识)时按参数分段批量计算的实现文件
+ *
+ * 真实的wordpress用户表中每条记录可以有不同的迭代次数标识，经tbl换算为2^7..2^30轮MD5，
+ * 代价相差几百万倍。一批记录按(盐长度, 参数)排序后，参数相同的一段记录共用同一组参数和特化实现，
+ * 每次取向量内核通道数条记录，累积到PARAM_TASK_COST左右切分为一个任务，
+ * 迭代次数少的记录合并成大任务以分摊调度开销，迭代次数多的记录每个任务只占满一组通道，由线程池按代价调度
+ *@version 0.1
+ */
+#include "include/param_record.h"
+#include "include/common.h"
+#include "include/md5_mb.h"
+#include <string.h>
+#include <new>
+
+bool param_record_less::operator() (const struct param_record *a, const struct param_record *b) const
+{
+	if (a->salt_len != b->salt_len)
+		return a->salt_len < b->salt_len;
+	return memcmp(a->values, b->values, sizeof(union extra_data) * param_num) < 0;
+}
+
+void init_param_layout(const struct alg_desp *desp, struct param_layout *layout)
+{
+	layout->num = desp->cipher_param_num;
+	for (int k = 0; k < layout->num; ++k)
+		layout->index[k] = desp->cipher_params[k];
+}
+
+/**
+ *@brief 估计一条记录的MD5压缩次数，由算法的estimate_cost接口根据参数计算，没有该接口的算法按一次MD5(口令)估计
+ */
+static long long param_record_cost(const struct alg_desp *desp, const struct param_record *rec)
+{
+	if (desp->estimate_cost != NULL)
+		return desp->estimate_cost(rec->pwd.size(), rec->values);
+	return (rec->pwd.size() + 8) / MD5_BLOCK_SIZE + 1;
+}
+
+void save_param_values(const struct alg_desp *desp, const struct param_layout *layout, struct param_record *rec, BatchArena &arena)
+{
+	rec->values = (union extra_data *)arena.alloc(sizeof(union extra_data) * layout->num);
+	for (int k = 0; k < layout->num; ++k)
+		rec->values[k] = desp->extra[layout->index[k]].cur_value;
+	rec->cost = param_record_cost(desp, rec);
+}
+
+/**
+ *@brief 解析一行"口令[\t盐[\t迭代次数标识]]"，口令中不能有制表符
+ * 省略或为空的盐按record_index产生随机盐，与salt_mode=index相同，结果与批大小、线程数无关；
+ * 给定的盐按字符原样使用；盐长度和参数字段由算法的parse_record_params检查并写入本条记录的参数，
+ * 省略或为空的参数字段使用命令行的当前值(wordpress为iter_pos)
+ *@param desp 算法描述，只读
+ *@param layout 参数布局
+ *@param line 一行
+ *@param len 行的字节数
+ *@param record_index 记录序号
+ *@param rec 输出记录，index由调用者设置
+ *@param arena 本批的分配器，预处理后的口令、随机盐和参数都从中分配
+ *@return 0：正确，-1：字段过多、盐或参数不对、预处理口令出错
+ */
+int parse_param_record(struct alg_desp *desp, const struct param_layout *layout, const char *line, int len,
+	long long record_index, struct param_record *rec, BatchArena &arena)
+{
+	//! 1. 按制表符切分为最多3个字段
+	const char *field[3] = {line, line + len, line + len};
+	int field_len[3] = {len, 0, 0};
+	int num = 1;
+	for (int i = 0; i < len; ++i)
+	{
+		if (line[i] != '\t')
+			continue;
+		if (num == 3)
+			return -1;
+		field_len[num - 1] = line + i - field[num - 1];
+		field[num] = line + i + 1;
+		field_len[num] = line + len - field[num];
+		++num;
+	}
+
+	//! 2. 盐：给定时复制，否则产生随机盐；算法不能解析记录自带的参数时只能有口令
+	if (desp->parse_record_params == NULL && num > 1)
+		return -1;
+	if (field_len[1] > 0)
+	{
+		if (field_len[1] > CIPHER_MAX_SALT)
+			return -1;
+		memcpy(rec->salt, field[1], field_len[1]);
+		rec->salt_len = field_len[1];
+	}
+	else
+	{
+		ByteView salt;
+		if (alg_get_random_salt_batch(desp, &salt, 1, record_index, arena) != 0 || salt.size() > CIPHER_MAX_SALT)
+			return -1;
+		memcpy(rec->salt, salt.getByte_p(), salt.size());
+		rec->salt_len = salt.size();
+	}
+
+	//! 3. 预处理口令，复制到arena中
+	ByteVector bv_pwd = desp->prepare_pwd(field[0], field_len[0]);
+	if (bv_pwd.isEmpty() && field_len[0] > 0)
+		return -1;
+	new (&rec->pwd) ByteView(arena.copy(bv_pwd.getByte_p(), bv_pwd.size()));
+
+	//! 4. 参数从命令行的当前值开始，由算法按本行的盐长度和参数字段覆盖
+	save_param_values(desp, layout, rec, arena);
+	if (desp->parse_record_params != NULL
+		&& desp->parse_record_params(rec->salt_len, field[2], field_len[2], desp->extra, rec->values) != 0)
+		return -1;
+	rec->cost = param_record_cost(desp, rec);
+	rec->hash_len = 0;
+	return 0;
+}
+
+/**
+ *@brief 把按参数排序的n条记录切分为任务
+ * 参数相同的一段记录中，每次取最多一组向量通道数的记录，一组的代价为其中最贵的记录，
+ * 累积到PARAM_TASK_COST或本段结束时切分为一个任务
+ *@param order 按param_record_less排序的记录
+ *@param n 记录个数
+ *@param param_num 参数个数
+ *@param first 输出每个任务的第一条记录，first[任务个数]为n
+ *@param cost 输出每个任务的代价
+ *@return 任务个数
+ */
+int split_param_tasks(struct param_record *const *order, int n, int param_num, int *first, long long *cost)
+{
+	param_record_less less = {param_num};
+	int lanes = md5_mb_kernel_lanes();
+	int num = 0;
+	for (int i = 0; i < n; )
+	{
+		int end = i;
+		long long task_cost = 0;
+		while (end < n && task_cost < PARAM_TASK_COST && !less(order[i], order[end]))
+		{
+			long long group_cost = 0;
+			int group_end = end;
+			for (; group_end < n && group_end - end < lanes && !less(order[i], order[group_end]); ++group_end)
+			{
+				if (order[group_end]->cost > group_cost)
+					group_cost = order[group_end]->cost;
+			}
+			task_cost += group_cost;
+			end = group_end;
+		}
+		first[num] = i;
+		cost[num] = task_cost;
+		++num;
+		i = end;
+	}
+	first[num] = n;
+	return num;
+}
+
+/**
+ *@brief 计算n条参数相同的记录的hash值
+ *@param local 调用者自己的算法描述副本，附加信息的当前值改为这些记录的参数，并选择对应的特化实现
+ *@param layout 参数布局
+ *@param order n条参数相同的记录
+ *@param n 记录个数
+ *@param hash 输出n个hash值的视图
+ *@param arena 分配器，口令和盐的视图、迭代链和hash值都从中分配
+ *@return 0：正确，-1：出错
+ */
+int hash_param_records(struct alg_desp *local, const struct param_layout *layout, struct param_record *const *order, int n,
+	ByteView *hash, BatchArena &arena)
+{
+	if (n <= 0)
+		return 0;
+	for (int k = 0; k < layout->num; ++k)
+		local->extra[layout->index[k]].cur_value = order[0]->values[k];
+	if (local->specialize_alg_desp != NULL && local->specialize_alg_desp(local) != 0)
+		return -1;
+	ByteView *pwd = (ByteView *)arena.alloc(sizeof(ByteView) * n);
+	ByteView *salt = (ByteView *)arena.alloc(sizeof(ByteView) * n);
+	for (int i = 0; i < n; ++i)
+	{
+		new (&pwd[i]) ByteView(order[i]->pwd);
+		new (&salt[i]) ByteView(order[i]->salt, order[i]->salt_len);
+	}
+	return alg_hash_pwd_batch(local, pwd, salt, hash, n, arena);
+}
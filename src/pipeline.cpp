@@ -0,0 +1,824 @@
+/**
+ *@file pipeline.cpp
+ *@brief 多线程口令处理流水线实现文件
+ *
+ * 流水线分为三级：
+ *   读取级(调用线程)   从mmap的口令文件按批切分出口令视图，标准输入等流式输入复制到批次自己的缓冲区
+ *   计算级(工作线程池) 对每批口令调用get_random_salt、prepare_pwd、hash_pwd、get_cipher的批量接口；
+ *                      校验模式和带参数的记录模式每条记录的迭代次数可以不同，读取级把一批记录按参数排序、
+ *                      按代价切分为任务，交给工作窃取线程池，本批最后一个完成的任务产生输出
+ *   输出级(输出线程)   按批次序号恢复输入顺序(或按完成顺序)写入密文文件
+ * 各级之间通过有界队列传递批次，批次对象循环使用，内存占用与输入规模无关，流式输入输出时也不会积压。
+ * 密文写到管道而读端关闭(EPIPE)时停止读取，正常结束
+ * 每批的预处理口令、盐、hash值都从批次自己的arena中分配，计算下一批前整体回收。
+ * 按输入顺序输出时，输出级写完一批后已完成的口令是输入的一个前缀，检查点在这里定期写入。
+ * 开启统计时，读取、各alg_desp接口和写入分别计时，各队列深度由输出线程定期采样
+ *@version 0.1
+ */
+#include "include/pipeline.h"
+#include "include/bounded_queue.h"
+#include "include/batch_arena.h"
+#include "include/checkpoint.h"
+#include "include/metrics.h"
+#include "include/verify.h"
+#include "include/param_record.h"
+#include "include/work_pool.h"
+#include <string>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+/**
+ *@brief 一批口令及其计算结果
+ */
+struct pwd_batch {
+	long long seq;          //批次序号，从0开始
+	long long first_index;  //本批第一条口令的记录序号，用于产生可复现的随机盐
+	int count;              //本批有效口令个数
+	size_t end_offset;      //本批最后一条口令之后在口令文件中的偏移
+	int error;              //0：正确，非0：出错的步骤
+	const char **pwd;       //口令，指向口令文件映射内存或input的视图
+	std::string input;      //流式读取时本批口令的副本
+	int *pwd_len;           //口令字节数
+	BatchArena *arena;      //本批的预处理口令、盐、hash值所在的连续内存
+	ByteView *salt_view;    //随机盐
+	ByteView *pwd_view;     //预处理后的口令
+	ByteView *hash_view;    //hash值
+	std::string cipher;     //本批所有密文，每个密文一行；校验模式为每个密文的校验结果
+	int verified[3];        //校验模式本批匹配、不匹配、密文无效的记录数
+	int rec_num;                     //按任务计算时本批的记录数，空行不计，pwd的前rec_num个元素为这些记录所在的行
+	struct param_record *rec;        //按输入顺序的记录，从arena中分配
+	struct param_record **order;     //按参数排序的记录
+	int *result;                     //校验模式每条记录的校验结果
+	int *task_first;                 //每个任务的第一条记录在order中的下标
+	long long *task_cost;            //每个任务的代价
+	std::atomic<int> pending;        //尚未完成的任务数
+	std::atomic<int> task_error;     //第一个出错任务的出错步骤
+};
+
+//! 每条记录在arena中预留的字节数，口令、盐、hash值和迭代链都放得下时一批只用一块内存
+#define BATCH_ARENA_BYTES_PER_RECORD 128
+
+//! 批次处理出错的步骤
+#define BATCH_ERR_SALT 1
+#define BATCH_ERR_PREPARE 2
+#define BATCH_ERR_HASH 3
+#define BATCH_ERR_CIPHER 4
+#define BATCH_ERR_WRITE 5
+#define BATCH_ERR_CHECKPOINT 6
+#define BATCH_ERR_PIPE 7        //密文输出管道的读端已关闭，不是错误
+#define BATCH_ERR_RECORD 8      //口令文件中的记录格式不对，读取级已输出是哪条记录
+
+//! 收到SIGINT/SIGTERM后置1，只在信号处理函数中修改
+static std::atomic<int> interrupted(0);
+
+//! 计算级整批处理一批口令的函数
+typedef void (*batch_process)(struct alg_desp *desp, struct pwd_batch *batch);
+
+//! 校验结果的输出文字，按VERIFY_MATCH、VERIFY_MISMATCH、VERIFY_INVALID的顺序
+static const char *const verify_result_name[3] = {":match\n", ":mismatch\n", ":invalid\n"};
+
+struct pipeline_ctx;
+
+/**
+ *@brief 按任务计算的计算级：读取级调用plan把一批记录切分为任务，线程池中的线程调用run执行一个任务，
+ * 本批最后一个完成的任务调用finish产生输出
+ */
+struct task_stage {
+	int (*plan)(struct pipeline_ctx *ctx, struct pwd_batch *batch);    //返回任务个数，出错时设置batch->error并返回0
+	int (*run)(struct pipeline_ctx *ctx, struct pwd_batch *batch, int first, int end, BatchArena &arena);    //返回0或出错步骤
+	void (*finish)(struct pipeline_ctx *ctx, struct pwd_batch *batch);
+};
+
+/**
+ *@brief 线程池中的一个任务：一批中按参数排序后的[first, end)条记录
+ */
+struct batch_task {
+	struct pipeline_ctx *ctx;
+	struct pwd_batch *batch;
+	int first;
+	int end;
+};
+
+/**
+ *@brief 计算级的统计
+ */
+struct stage_stats {
+	long long records;        //已写出的记录数，按任务计算时不含空行
+	long long verified[3];    //校验模式已写出的匹配、不匹配、密文无效的记录数
+	long long tasks;          //线程池执行的任务数
+	long long steals;         //其中被窃取执行的任务数
+};
+
+/**
+ *@brief 流水线共享状态
+ */
+struct pipeline_ctx {
+	struct alg_desp *desp;
+	CipherWriter *file_out;
+	const struct pipeline_option *option;
+	BoundedQueue<struct pwd_batch *> *free_queue;    //空闲批次
+	BoundedQueue<struct pwd_batch *> *work_queue;    //待计算批次
+	BoundedQueue<struct pwd_batch *> *done_queue;    //已计算批次
+	batch_process process;                           //计算级整批处理的函数，按任务计算时为NULL
+	const struct task_stage *stage;                  //按任务计算的计算级，整批处理时为NULL
+	WorkStealingPool *pool;                          //按任务计算时的线程池
+	std::vector<BatchArena *> worker_arena;          //线程池中每个线程执行任务时使用的分配器
+	struct param_layout layout;                      //每条记录的参数布局
+	std::atomic<int> running_workers;                //尚未退出的工作线程数
+	std::atomic<int> stop;                           //出错后置1，通知读取级停止
+	int error;                                       //第一个出错批次的出错步骤
+	struct checkpoint ckpt;                          //已写出的前缀，只由输出线程修改
+	std::chrono::steady_clock::time_point last_checkpoint;
+	struct stage_stats stats;                        //已写出的记录的统计，只由输出线程修改
+	long long task_num;                              //已提交的任务数，只由读取级修改
+};
+
+static struct pwd_batch *new_batch(int batch_size)
+{
+	struct pwd_batch *batch = new struct pwd_batch;
+	batch->seq = 0;
+	batch->count = 0;
+	batch->error = 0;
+	batch->verified[0] = batch->verified[1] = batch->verified[2] = 0;
+	batch->rec_num = 0;
+	batch->pending = 0;
+	batch->task_error = 0;
+	batch->pwd = new const char *[batch_size];
+	batch->pwd_len = new int[batch_size];
+	batch->arena = new BatchArena((size_t)batch_size * BATCH_ARENA_BYTES_PER_RECORD);
+	batch->salt_view = new ByteView[batch_size];
+	batch->pwd_view = new ByteView[batch_size];
+	batch->hash_view = new ByteView[batch_size];
+	return batch;
+}
+
+static void delete_batch(struct pwd_batch *batch)
+{
+	delete[] batch->pwd;
+	delete[] batch->pwd_len;
+	delete batch->arena;
+	delete[] batch->salt_view;
+	delete[] batch->pwd_view;
+	delete[] batch->hash_view;
+	delete batch;
+}
+
+/**
+ *@brief 打印批次出错步骤对应的错误信息
+ */
+static void print_batch_error(int error)
+{
+	switch (error)
+	{
+		case BATCH_ERR_SALT:
+			std::cout << "error: get_random_salt() is wrong!" << std::endl;
+			break;
+		case BATCH_ERR_PREPARE:
+			std::cout << "error: prepare_pwd() is wrong!" << std::endl;
+			break;
+		case BATCH_ERR_HASH:
+			std::cout << "error: hash_pwd() is wrong!" << std::endl;
+			break;
+		case BATCH_ERR_CIPHER:
+			std::cout << "error: get_cipher() is wrong!" << std::endl;
+			break;
+		case BATCH_ERR_WRITE:
+			std::cout << "error: write cipher_file failed!" << std::endl;
+			break;
+		case BATCH_ERR_CHECKPOINT:
+			std::cout << "error: write checkpoint_file failed!" << std::endl;
+			break;
+		default:
+			break;
+	}
+}
+
+/**
+ *@brief 计算级：对一批口令计算密文
+ *@param desp 算法描述
+ *@param batch 待计算的批次
+ */
+static void hash_batch(struct alg_desp *desp, struct pwd_batch *batch)
+{
+	//! 0. 回收上一次使用本批次时的分配，产生随机盐，每批由记录序号确定随机流，不需要在线程间共享随机数状态
+	BatchArena &arena = *batch->arena;
+	arena.reset();
+	uint64_t begin = metrics_begin();
+	if (alg_get_random_salt_batch(desp, batch->salt_view, batch->count, batch->first_index, arena) != 0)
+	{
+		batch->error = BATCH_ERR_SALT;
+		return;
+	}
+	metrics_end(METRIC_SALT, begin, batch->count);
+
+	//! 1. 预处理口令，结果复制到arena中，常见长度的口令不分配内存
+	begin = metrics_begin();
+	for (int i = 0; i < batch->count; ++i)
+	{
+		ByteVector bv_pwd = desp->prepare_pwd(batch->pwd[i], batch->pwd_len[i]);
+		if (bv_pwd.isEmpty())
+		{
+			batch->error = BATCH_ERR_PREPARE;
+			return;
+		}
+		batch->pwd_view[i] = arena.copy(bv_pwd.getByte_p(), bv_pwd.size());
+	}
+	metrics_end(METRIC_PREPARE, begin, batch->count);
+
+	//! 2. 计算hash值，算法没有提供批量接口时逐个调用hash_pwd
+	begin = metrics_begin();
+	if (alg_hash_pwd_batch(desp, batch->pwd_view, batch->salt_view, batch->hash_view, batch->count, arena) != 0)
+	{
+		batch->error = BATCH_ERR_HASH;
+		return;
+	}
+	metrics_end(METRIC_HASH, begin, batch->count);
+
+	//! 3. 产生密文，写入本批的输出缓冲区
+	begin = metrics_begin();
+	batch->cipher.clear();
+	if (alg_get_cipher_batch(desp, batch->hash_view, batch->salt_view, batch->count, batch->cipher) != 0)
+	{
+		batch->error = BATCH_ERR_CIPHER;
+		return;
+	}
+	metrics_end(METRIC_CIPHER, begin, batch->count);
+}
+
+/**
+ *@brief 把按参数排序的n条记录切分为任务，任务边界和代价从本批的arena中分配
+ *@return 任务个数
+ */
+static int plan_param_tasks(struct pipeline_ctx *ctx, struct pwd_batch *batch, int n)
+{
+	batch->task_first = (int *)batch->arena->alloc(sizeof(int) * (n + 1));
+	batch->task_cost = (long long *)batch->arena->alloc(sizeof(long long) * (n + 1));
+	return split_param_tasks(batch->order, n, ctx->layout.num, batch->task_first, batch->task_cost);
+}
+
+/**
+ *@brief 读取级：去掉空行，切分每一行"密文:口令"，解析密文，按参数排序后切分为任务
+ * 没有':'的行密文长度为0，解析时判为无效
+ */
+static int plan_verify(struct pipeline_ctx *ctx, struct pwd_batch *batch)
+{
+	//! 0. 回收上一次使用本批次时的分配，非空行前移到pwd的前rec_num个元素
+	BatchArena &arena = *batch->arena;
+	arena.reset();
+	uint64_t begin = metrics_begin();
+	int n = 0;
+	const char **cipher = (const char **)arena.alloc(sizeof(const char *) * batch->count);
+	int *cipher_len = (int *)arena.alloc(sizeof(int) * batch->count);
+	const char **pwd = (const char **)arena.alloc(sizeof(const char *) * batch->count);
+	int *pwd_len = (int *)arena.alloc(sizeof(int) * batch->count);
+	for (int i = 0; i < batch->count; ++i)
+	{
+		if (batch->pwd_len[i] == 0)
+			continue;
+		batch->pwd[n] = batch->pwd[i];
+		batch->pwd_len[n] = batch->pwd_len[i];
+		cipher[n] = batch->pwd[n];
+		if (split_verify_line(batch->pwd[n], batch->pwd_len[n], cipher_len[n], pwd[n], pwd_len[n]) != 0)
+		{
+			cipher_len[n] = 0;
+			pwd[n] = batch->pwd[n];
+			pwd_len[n] = 0;
+		}
+		++n;
+	}
+	batch->rec_num = n;
+
+	//! 1. 解析密文、预处理口令，按密文自带的参数排序
+	batch->result = (int *)arena.alloc(sizeof(int) * n);
+	batch->order = (struct param_record **)arena.alloc(sizeof(struct param_record *) * n);
+	int valid = verify_prepare(ctx->desp, &ctx->layout, pwd, pwd_len, cipher, cipher_len, n, batch->result, batch->order, arena);
+	if (valid < 0)
+	{
+		batch->error = BATCH_ERR_PREPARE;
+		return 0;
+	}
+	metrics_end(METRIC_PREPARE, begin, n);
+	return plan_param_tasks(ctx, batch, valid);
+}
+
+//! 计算级：校验一个任务中参数相同的记录，算法描述使用副本
+static int run_verify_task(struct pipeline_ctx *ctx, struct pwd_batch *batch, int first, int end, BatchArena &arena)
+{
+	uint64_t begin = metrics_begin();
+	struct alg_desp local = *ctx->desp;
+	if (verify_records(&local, &ctx->layout, batch->order + first, end - first, batch->result, arena) != 0)
+		return BATCH_ERR_HASH;
+	metrics_end(METRIC_HASH, begin, end - first);
+	return 0;
+}
+
+/**
+ *@brief 按输入顺序输出"密文:match"、"密文:mismatch"或"密文:invalid"，没有':'的行原样输出整行
+ */
+static void finish_verify(struct pipeline_ctx *, struct pwd_batch *batch)
+{
+	batch->cipher.clear();
+	batch->verified[0] = batch->verified[1] = batch->verified[2] = 0;
+	for (int i = 0; i < batch->rec_num; ++i)
+	{
+		int cipher_len, pwd_len;
+		const char *pwd;
+		if (split_verify_line(batch->pwd[i], batch->pwd_len[i], cipher_len, pwd, pwd_len) != 0)
+			cipher_len = batch->pwd_len[i];
+		int k = batch->result[i] == VERIFY_MATCH ? 0 : (batch->result[i] == VERIFY_MISMATCH ? 1 : 2);
+		batch->cipher.append(batch->pwd[i], cipher_len);
+		batch->cipher += verify_result_name[k];
+		++batch->verified[k];
+	}
+}
+
+/**
+ *@brief 读取级：把每一行"口令[\t盐[\t迭代次数标识]]"解析为记录，空行被忽略，按参数排序后切分为任务
+ */
+static int plan_records(struct pipeline_ctx *ctx, struct pwd_batch *batch)
+{
+	//! 0. 回收上一次使用本批次时的分配，没有盐的记录按记录序号产生随机盐
+	BatchArena &arena = *batch->arena;
+	arena.reset();
+	uint64_t begin = metrics_begin();
+	batch->rec = (struct param_record *)arena.alloc(sizeof(struct param_record) * batch->count);
+	batch->order = (struct param_record **)arena.alloc(sizeof(struct param_record *) * batch->count);
+	int n = 0;
+	for (int i = 0; i < batch->count; ++i)
+	{
+		if (batch->pwd_len[i] == 0)
+			continue;
+		struct param_record *r = &batch->rec[n];
+		if (parse_param_record(ctx->desp, &ctx->layout, batch->pwd[i], batch->pwd_len[i], batch->first_index + i, r, arena) != 0)
+		{
+			std::cout << "error: record " << batch->first_index + i << " in pwd_file has too many fields, or an invalid salt or iter_pos!" << std::endl;
+			batch->error = BATCH_ERR_RECORD;
+			return 0;
+		}
+		r->index = n;
+		batch->order[n] = r;
+		++n;
+	}
+	batch->rec_num = n;
+
+	//! 1. 按参数排序，参数相同的记录交给同一个特化实现
+	param_record_less less = {ctx->layout.num};
+	std::stable_sort(batch->order, batch->order + n, less);
+	metrics_end(METRIC_PREPARE, begin, n);
+	return plan_param_tasks(ctx, batch, n);
+}
+
+//! 计算级：计算一个任务中参数相同的记录的hash值，保存到各自的记录中
+static int run_records_task(struct pipeline_ctx *ctx, struct pwd_batch *batch, int first, int end, BatchArena &arena)
+{
+	uint64_t begin = metrics_begin();
+	struct alg_desp local = *ctx->desp;
+	int n = end - first;
+	ByteView *hash = (ByteView *)arena.alloc(sizeof(ByteView) * n);
+	for (int i = 0; i < n; ++i)
+		new (&hash[i]) ByteView();
+	if (hash_param_records(&local, &ctx->layout, batch->order + first, n, hash, arena) != 0)
+		return BATCH_ERR_HASH;
+	for (int i = 0; i < n; ++i)
+	{
+		struct param_record *r = batch->order[first + i];
+		if (hash[i].size() > CIPHER_MAX_HASH)
+			return BATCH_ERR_HASH;
+		memcpy(r->hash, hash[i].getByte_p(), hash[i].size());
+		r->hash_len = hash[i].size();
+	}
+	metrics_end(METRIC_HASH, begin, n);
+	return 0;
+}
+
+/**
+ *@brief 按输入顺序产生密文，相邻的参数相同的记录一次交给get_cipher的批量接口
+ */
+static void finish_records(struct pipeline_ctx *ctx, struct pwd_batch *batch)
+{
+	uint64_t begin = metrics_begin();
+	struct alg_desp local = *ctx->desp;
+	int n = batch->rec_num;
+	for (int i = 0; i < n; ++i)
+	{
+		batch->hash_view[i] = ByteView(batch->rec[i].hash, batch->rec[i].hash_len);
+		batch->salt_view[i] = ByteView(batch->rec[i].salt, batch->rec[i].salt_len);
+	}
+	batch->cipher.clear();
+	size_t values_size = sizeof(union extra_data) * ctx->layout.num;
+	for (int first = 0, end; first < n; first = end)
+	{
+		for (end = first + 1; end < n && batch->rec[end].salt_len == batch->rec[first].salt_len
+			&& memcmp(batch->rec[end].values, batch->rec[first].values, values_size) == 0; ++end)
+			;
+		for (int k = 0; k < ctx->layout.num; ++k)
+			local.extra[ctx->layout.index[k]].cur_value = batch->rec[first].values[k];
+		if (alg_get_cipher_batch(&local, batch->hash_view + first, batch->salt_view + first, end - first, batch->cipher) != 0)
+		{
+			batch->error = BATCH_ERR_CIPHER;
+			return;
+		}
+	}
+	metrics_end(METRIC_CIPHER, begin, n);
+}
+
+//! 校验模式的计算级
+static const struct task_stage verify_stage = {plan_verify, run_verify_task, finish_verify};
+
+//! 带参数的记录模式的计算级
+static const struct task_stage records_stage = {plan_records, run_records_task, finish_records};
+
+/**
+ *@brief 线程池执行的任务函数，本批最后一个完成的任务产生输出并交给输出级
+ *@param arg struct batch_task
+ *@param worker 线程序号，使用该线程自己的分配器
+ */
+static void run_batch_task(void *arg, int worker)
+{
+	struct batch_task *task = (struct batch_task *)arg;
+	struct pipeline_ctx *ctx = task->ctx;
+	struct pwd_batch *batch = task->batch;
+	if (!ctx->stop && batch->task_error == 0)
+	{
+		BatchArena &arena = *ctx->worker_arena[worker];
+		arena.reset();
+		int error = ctx->stage->run(ctx, batch, task->first, task->end, arena);
+		int expected = 0;
+		if (error != 0)
+			batch->task_error.compare_exchange_strong(expected, error);
+	}
+	//! pending的递减是读改写操作，最后一个任务能看到其它任务写入的结果
+	if (--batch->pending == 0)
+	{
+		batch->error = batch->task_error;
+		if (!batch->error && !ctx->stop)
+			ctx->stage->finish(ctx, batch);
+		ctx->done_queue->push(batch);
+	}
+}
+
+/**
+ *@brief 读取级：把一批记录切分为任务提交给线程池，没有任务的批次直接交给输出级
+ *@param tasks 提交用的缓冲区，只由读取级使用
+ */
+static void dispatch_batch(struct pipeline_ctx *ctx, struct pwd_batch *batch, std::vector<struct pool_task> &tasks)
+{
+	int num = ctx->stage->plan(ctx, batch);
+	if (num == 0)
+	{
+		if (!batch->error)
+			ctx->stage->finish(ctx, batch);
+		ctx->done_queue->push(batch);
+		return;
+	}
+	struct batch_task *arg = (struct batch_task *)batch->arena->alloc(sizeof(struct batch_task) * num);
+	tasks.resize(num);
+	for (int k = 0; k < num; ++k)
+	{
+		arg[k].ctx = ctx;
+		arg[k].batch = batch;
+		arg[k].first = batch->task_first[k];
+		arg[k].end = batch->task_first[k + 1];
+		tasks[k].run = run_batch_task;
+		tasks[k].arg = &arg[k];
+		tasks[k].cost = batch->task_cost[k];
+	}
+	batch->task_error = 0;
+	batch->pending = num;
+	ctx->task_num += num;
+	ctx->pool->submit(&tasks[0], num);
+}
+
+/**
+ *@brief 工作线程：循环从work_queue取批次计算，放入done_queue
+ * 最后一个退出的工作线程负责关闭done_queue
+ */
+static void worker_thread(struct pipeline_ctx *ctx)
+{
+	struct pwd_batch *batch;
+	while (ctx->work_queue->pop(batch))
+	{
+		if (!ctx->stop)
+			ctx->process(ctx->desp, batch);
+		ctx->done_queue->push(batch);
+	}
+	if (--ctx->running_workers == 0)
+		ctx->done_queue->close();
+}
+
+/**
+ *@brief 把密文文件已写出的部分落盘，再写检查点
+ *@return 0：正确，-1：出错
+ */
+static int write_checkpoint(struct pipeline_ctx *ctx)
+{
+	if (ctx->file_out->sync() != 0)
+		return -1;
+	ctx->ckpt.output_bytes = ctx->file_out->offset();
+	ctx->last_checkpoint = std::chrono::steady_clock::now();
+	return save_checkpoint(ctx->option->checkpoint_path, &ctx->ckpt);
+}
+
+/**
+ *@brief 把一批密文写入密文文件，出错则通知读取级停止
+ * 写检查点时批次按输入顺序写出，写完这一批后输入中它之前的口令都已完成
+ */
+static void write_batch(struct pipeline_ctx *ctx, struct pwd_batch *batch)
+{
+	if (batch->error && !ctx->error)
+	{
+		ctx->error = batch->error;
+		ctx->stop = 1;
+	}
+	uint64_t begin = metrics_begin();
+	if (!ctx->error && ctx->file_out->write(batch->cipher.data(), batch->cipher.size()) != 0)
+	{
+		ctx->error = ctx->file_out->broken_pipe() ? BATCH_ERR_PIPE : BATCH_ERR_WRITE;
+		ctx->stop = 1;
+	}
+	else if (!ctx->error)
+	{
+		metrics_end(METRIC_WRITE, begin, batch->count);
+		ctx->stats.records += ctx->stage != NULL ? batch->rec_num : batch->count;
+		for (int k = 0; k < 3; ++k)
+			ctx->stats.verified[k] += batch->verified[k];
+	}
+	if (!ctx->error && ctx->option->checkpoint_path != NULL)
+	{
+		ctx->ckpt.input_offset = batch->end_offset;
+		ctx->ckpt.records += batch->count;
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - ctx->last_checkpoint;
+		if (elapsed.count() >= ctx->option->checkpoint_interval && write_checkpoint(ctx) != 0)
+		{
+			ctx->error = BATCH_ERR_CHECKPOINT;
+			ctx->stop = 1;
+		}
+	}
+	ctx->free_queue->push(batch);
+}
+
+//! 统计输出中各队列的名称
+static const char *const queue_names[METRICS_QUEUE_NUM] = {"free", "work", "done"};
+
+//! 采样各队列中的批次个数
+static void sample_queues(void *arg, int *depth)
+{
+	struct pipeline_ctx *ctx = (struct pipeline_ctx *)arg;
+	depth[0] = ctx->free_queue->size();
+	depth[1] = ctx->work_queue->size();
+	depth[2] = ctx->done_queue->size();
+}
+
+/**
+ *@brief 输出线程：按批次序号恢复输入顺序写入密文，unordered时按完成顺序写入
+ */
+static void writer_thread(struct pipeline_ctx *ctx)
+{
+	std::map<long long, struct pwd_batch *> pending;    //先于前面批次完成的批次
+	long long next_seq = 0;
+	struct pwd_batch *batch;
+
+	while (ctx->done_queue->pop(batch))
+	{
+		if (ctx->option->unordered)
+		{
+			write_batch(ctx, batch);
+			continue;
+		}
+		pending.insert(std::make_pair(batch->seq, batch));
+		std::map<long long, struct pwd_batch *>::iterator it;
+		while ((it = pending.find(next_seq)) != pending.end())
+		{
+			write_batch(ctx, it->second);
+			pending.erase(it);
+			++next_seq;
+		}
+	}
+}
+
+/**
+ *@brief 设置流水线运行参数的缺省值
+ *@param option 流水线运行参数
+ */
+void init_pipeline_option(struct pipeline_option *option)
+{
+	option->thread_num = DEFAULT_THREAD_NUM;
+	option->batch_size = DEFAULT_BATCH_SIZE;
+	option->unordered = 0;
+	option->max_pwd_len = 0;
+	option->write_flags = 0;
+	option->checkpoint_path = NULL;
+	option->checkpoint_interval = DEFAULT_CHECKPOINT_INTERVAL;
+	option->restore = 0;
+	option->first_record = 0;
+	option->pot_path = NULL;
+}
+
+//! 只修改一个原子变量，可以在信号处理函数中调用
+void interrupt_pipeline()
+{
+	interrupted = 1;
+}
+
+bool pipeline_interrupted()
+{
+	return interrupted != 0;
+}
+
+/**
+ *@brief 读取输入文件，多线程处理后写入输出文件
+ *@param desp 已初始化的算法描述
+ *@param file_in 已映射或流式读取的输入文件
+ *@param file_out 缓冲写入的输出文件
+ *@param option 流水线运行参数
+ *@param process 计算级整批处理的函数，为NULL时按stage切分为任务
+ *@param stage 按任务计算的计算级
+ *@param mode 检查点记录的模式
+ *@param stats 不为NULL时输出已写出的记录数、校验结果和任务数
+ *@return 0：正确或输出管道的读端已关闭，-1：出错
+ */
+static int run_stages(struct alg_desp *desp, PwdReader &file_in, CipherWriter &file_out, const struct pipeline_option *option,
+	batch_process process, const struct task_stage *stage, const char *mode, struct stage_stats *stats)
+{
+	//! 1. 创建队列和循环使用的批次，每个线程最多同时持有两个批次
+	int batch_num = 2 * option->thread_num + 2;
+	BoundedQueue<struct pwd_batch *> free_queue(batch_num);
+	BoundedQueue<struct pwd_batch *> work_queue(batch_num);
+	BoundedQueue<struct pwd_batch *> done_queue(batch_num);
+	std::vector<struct pwd_batch *> batches;
+	for (int i = 0; i < batch_num; ++i)
+	{
+		batches.push_back(new_batch(option->batch_size));
+		free_queue.push(batches[i]);
+	}
+
+	struct pipeline_ctx ctx;
+	ctx.desp = desp;
+	ctx.file_out = &file_out;
+	ctx.option = option;
+	ctx.free_queue = &free_queue;
+	ctx.work_queue = &work_queue;
+	ctx.done_queue = &done_queue;
+	ctx.process = process;
+	ctx.stage = stage;
+	ctx.pool = NULL;
+	init_param_layout(desp, &ctx.layout);
+	memset(&ctx.stats, 0, sizeof(ctx.stats));
+	ctx.task_num = 0;
+	ctx.running_workers = option->thread_num;
+	ctx.stop = 0;
+	ctx.error = 0;
+	ctx.ckpt.mode = mode;
+	ctx.ckpt.alg_name = desp->alg_name;
+	ctx.ckpt.input_size = file_in.file_size();
+	ctx.ckpt.input_offset = file_in.offset();
+	ctx.ckpt.records = option->first_record;
+	ctx.ckpt.output_bytes = file_out.offset();
+	ctx.ckpt.found = 0;
+	ctx.last_checkpoint = std::chrono::steady_clock::now();
+	if (metrics_enabled)
+		metrics_watch_queues(sample_queues, &ctx, queue_names);
+
+	//! 2. 启动工作线程(按任务计算时为线程池)和输出线程
+	std::vector<std::thread> workers;
+	std::vector<struct pool_task> tasks;
+	if (stage != NULL)
+	{
+		for (int i = 0; i < option->thread_num; ++i)
+			ctx.worker_arena.push_back(new BatchArena());
+		ctx.pool = new WorkStealingPool(option->thread_num);
+	}
+	else
+	{
+		for (int i = 0; i < option->thread_num; ++i)
+			workers.push_back(std::thread(worker_thread, &ctx));
+	}
+	std::thread writer(writer_thread, &ctx);
+
+	//! 3. 读取级：按批切分口令，记录每批第一条口令的序号，恢复时序号接着检查点继续
+	long long seq = 0;
+	long long record_index = option->first_record;
+	bool eof = false;
+	while (!eof && !ctx.stop && !interrupted)
+	{
+		struct pwd_batch *batch;
+		free_queue.pop(batch);
+		batch->seq = seq++;
+		batch->first_index = record_index;
+		batch->error = 0;
+		uint64_t begin = metrics_begin();
+		batch->count = file_in.next_batch(batch->pwd, batch->pwd_len, option->batch_size, batch->input);
+		metrics_end(METRIC_READ, begin, batch->count);
+		eof = batch->count < option->batch_size;
+		batch->end_offset = file_in.offset();
+		record_index += batch->count;
+		if (stage != NULL)
+			dispatch_batch(&ctx, batch, tasks);
+		else
+			work_queue.push(batch);
+	}
+	work_queue.close();
+
+	//! 4. 等待所有线程退出，释放批次；线程池执行完所有任务后，所有批次都已交给输出级
+	if (stage != NULL)
+	{
+		ctx.pool->close();
+		ctx.pool->join();
+		ctx.stats.tasks = ctx.task_num;
+		ctx.stats.steals = ctx.pool->steals();
+		delete ctx.pool;
+		done_queue.close();
+		for (int i = 0; i < option->thread_num; ++i)
+			delete ctx.worker_arena[i];
+	}
+	for (size_t i = 0; i < workers.size(); ++i)
+		workers[i].join();
+	writer.join();
+	if (metrics_enabled)
+		metrics_watch_queues(NULL, NULL, NULL);
+	for (int i = 0; i < batch_num; ++i)
+		delete_batch(batches[i]);
+	if (stats != NULL)
+		*stats = ctx.stats;
+
+	//! 5. 结束或出错时都写最后一个检查点，已完成的前缀仍然有效
+	if (option->checkpoint_path != NULL && write_checkpoint(&ctx) != 0 && !ctx.error)
+		ctx.error = BATCH_ERR_CHECKPOINT;
+	if (ctx.error == BATCH_ERR_PIPE)
+		return 0;
+	if (ctx.error)
+	{
+		print_batch_error(ctx.error);
+		return -1;
+	}
+	if (interrupted && !eof)
+	{
+		std::cout << "error: interrupted after " << ctx.ckpt.records << " pwd";
+		if (option->checkpoint_path != NULL)
+			std::cout << ", resume with -c " << option->checkpoint_path << " --restore";
+		std::cout << std::endl;
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ *@brief 读取口令文件，多线程计算密文并写入密文文件
+ *@param desp 已初始化的算法描述
+ *@param file_in 已映射或流式读取的口令文件
+ *@param file_out 缓冲写入的密文文件
+ *@param option 流水线运行参数
+ *@return 0：正确或输出管道的读端已关闭，-1：出错
+ */
+int run_pipeline(struct alg_desp *desp, PwdReader &file_in, CipherWriter &file_out, const struct pipeline_option *option)
+{
+	return run_stages(desp, file_in, file_out, option, hash_batch, NULL, CHECKPOINT_GENERATE, NULL);
+}
+
+/**
+ *@brief 读取"密文:口令"文件，多线程校验并按输入顺序写入每个密文的校验结果
+ *@param desp 已初始化的算法描述，必须提供parse_cipher
+ *@param file_in 已映射或流式读取的输入文件
+ *@param file_out 缓冲写入的结果文件
+ *@param option 流水线运行参数
+ *@return 0：正确或输出管道的读端已关闭，-1：出错
+ */
+int run_verify(struct alg_desp *desp, PwdReader &file_in, CipherWriter &file_out, const struct pipeline_option *option)
+{
+	if (desp->parse_cipher == NULL)
+	{
+		std::cout << "error: " << desp->alg_name << " does not support verify mode!" << std::endl;
+		return -1;
+	}
+	struct stage_stats stats;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	int ret = run_stages(desp, file_in, file_out, option, NULL, &verify_stage, CHECKPOINT_VERIFY, &stats);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "verify: " << stats.records << " pairs in " << seconds << " s, " << (seconds > 0 ? stats.records / seconds : 0) << " pairs/s, "
+		<< stats.verified[0] << " match, " << stats.verified[1] << " mismatch, " << stats.verified[2] << " invalid, "
+		<< stats.tasks << " tasks, " << stats.steals << " stolen" << std::endl;
+	return ret;
+}
+
+/**
+ *@brief 读取每行"口令[\t盐[\t迭代次数标识]]"的记录文件，每条记录使用自己的盐和迭代次数，多线程计算密文并按输入顺序写入密文文件
+ *@param desp 已初始化的算法描述，附加信息的当前值为省略盐、迭代次数标识时的缺省值
+ *@param file_in 已映射或流式读取的记录文件
+ *@param file_out 缓冲写入的密文文件
+ *@param option 流水线运行参数
+ *@return 0：正确或输出管道的读端已关闭，-1：出错
+ */
+int run_records(struct alg_desp *desp, PwdReader &file_in, CipherWriter &file_out, const struct pipeline_option *option)
+{
+	struct stage_stats stats;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	int ret = run_stages(desp, file_in, file_out, option, NULL, &records_stage, CHECKPOINT_RECORDS, &stats);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "records: " << stats.records << " records in " << seconds << " s, " << (seconds > 0 ? stats.records / seconds : 0)
+		<< " records/s, " << stats.tasks << " tasks, " << stats.steals << " stolen" << std::endl;
+	return ret;
+}
@@ -0,0 +1,337 @@
+/**
+ *@file pwd_reader.cpp
+ *@brief 基于mmap的零拷贝口令文件读取实现文件
+ *@version 0.1
+ */
+#include "include/pwd_reader.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+PwdReader::PwdReader()
+	: fd(-1), data(NULL), size(0), pos(0), begin_pos(0), end_pos(0), max_pwd_len(0), truncated_num(0),
+	  stream_buf(NULL), stream_cap(0), stream_begin(0), stream_end(0), stream_eof(false), stream_skip(false), read_error(false)
+{
+}
+
+PwdReader::~PwdReader()
+{
+	close();
+}
+
+/**
+ *@brief 打开并映射口令文件
+ *@param path 口令文件路径，"-"表示标准输入
+ *@param max_len 口令最大长度，0表示不限制
+ *@return 0：正确，-1：出错
+ */
+int PwdReader::open(const char *path, int max_len)
+{
+	close();
+	max_pwd_len = max_len;
+	truncated_num = 0;
+	pos = 0;
+
+	//! 1. 打开文件，取得文件大小
+	fd = strcmp(path, "-") == 0 ? dup(STDIN_FILENO) : ::open(path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+	{
+		close();
+		return -1;
+	}
+
+	//! 1.1 标准输入、管道等不是普通文件时流式读取，内存占用只有一个缓冲区
+	if (!S_ISREG(st.st_mode))
+	{
+		stream_buf = (char *)malloc(STREAM_BUFFER_SIZE);
+		if (stream_buf == NULL)
+		{
+			close();
+			return -1;
+		}
+		stream_cap = STREAM_BUFFER_SIZE;
+		return 0;
+	}
+	size = st.st_size;
+	begin_pos = 0;
+	end_pos = size;
+	if (size == 0)
+		return 0;
+
+	//! 2. 只读映射整个文件，并告诉内核按顺序访问、尽量使用大页
+	void *addr = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (addr == MAP_FAILED)
+	{
+		close();
+		return -1;
+	}
+	data = (const char *)addr;
+	madvise(addr, size, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+	madvise(addr, size, MADV_HUGEPAGE);
+#endif
+	return 0;
+}
+
+/**
+ *@brief 在[p, end)中查找第一个'\n'，SSE2每次比较16个字节
+ *@return '\n'的位置，没有找到返回end
+ */
+const char *find_newline(const char *p, const char *end)
+{
+#ifdef __SSE2__
+	const __m128i newline = _mm_set1_epi8('\n');
+	while (p + 16 <= end)
+	{
+		int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)p), newline));
+		if (mask != 0)
+			return p + __builtin_ctz(mask);
+		p += 16;
+	}
+#endif
+	while (p < end && *p != '\n')
+		++p;
+	return p;
+}
+
+/**
+ *@brief 读取下一行口令，返回指向映射内存的视图
+ *@param line 输出口令起始地址
+ *@param len 输出口令长度，已去掉行尾的"\r"
+ *@return true：读到一行，false：到达文件末尾
+ */
+bool PwdReader::next(const char *&line, int &len)
+{
+	if (stream_buf != NULL)
+		return next_stream(line, len);
+	if (pos >= end_pos)
+		return false;
+
+	const char *begin = data + pos;
+	const char *end = data + end_pos;
+	const char *newline = find_newline(begin, end);
+
+	pos = newline - data + (newline < end ? 1 : 0);
+	if (newline > begin && newline[-1] == '\r')
+		--newline;
+
+	line = begin;
+	len = newline - begin;
+	if (max_pwd_len > 0 && len > max_pwd_len)
+	{
+		len = max_pwd_len;
+		++truncated_num;
+	}
+	return true;
+}
+
+/**
+ *@brief 把缓冲区中未读的部分移到开头，再read一次，调用时缓冲区不能是满的
+ *@return true：读到了数据，false：到达输入末尾或出错
+ */
+bool PwdReader::fill_stream()
+{
+	if (stream_begin > 0)
+	{
+		memmove(stream_buf, stream_buf + stream_begin, stream_end - stream_begin);
+		stream_end -= stream_begin;
+		stream_begin = 0;
+	}
+	ssize_t n;
+	do {
+		n = read(fd, stream_buf + stream_end, stream_cap - stream_end);
+	} while (n < 0 && errno == EINTR);
+	if (n <= 0)
+	{
+		stream_eof = true;
+		read_error = (n < 0);
+		return false;
+	}
+	stream_end += n;
+	return true;
+}
+
+/**
+ *@brief 流式读取下一行口令，返回指向缓冲区的视图，下一次调用后失效
+ * 缓冲区中没有完整的一行时才read，最后一行没有"\n"时也返回；
+ * 一行占满整个缓冲区时返回缓冲区中的部分，该行其余的字节在下一次调用时丢弃
+ */
+bool PwdReader::next_stream(const char *&line, int &len)
+{
+	//! 1. 丢弃上一次被截断的行的剩余部分
+	while (stream_skip)
+	{
+		const char *end = stream_buf + stream_end;
+		const char *newline = find_newline(stream_buf + stream_begin, end);
+		size_t skipped = newline - (stream_buf + stream_begin) + (newline < end ? 1 : 0);
+		stream_begin += skipped;
+		pos += skipped;
+		if (newline < end)
+			stream_skip = false;
+		else if (stream_eof || !fill_stream())
+			return false;
+	}
+
+	//! 2. 找到下一个'\n'，缓冲区满时截断
+	const char *newline;
+	bool overflow = false;
+	for (;;)
+	{
+		newline = find_newline(stream_buf + stream_begin, stream_buf + stream_end);
+		if (newline < stream_buf + stream_end)
+			break;
+		if (stream_begin == 0 && stream_end == stream_cap)
+		{
+			overflow = true;
+			stream_skip = true;
+			break;
+		}
+		if (stream_eof || !fill_stream())
+		{
+			if (stream_begin == stream_end)
+				return false;
+			newline = stream_buf + stream_end;
+			break;
+		}
+	}
+
+	const char *begin = stream_buf + stream_begin;
+	size_t consumed = newline - begin + (newline < stream_buf + stream_end ? 1 : 0);
+	stream_begin += consumed;
+	pos += consumed;
+	if (newline > begin && newline[-1] == '\r')
+		--newline;
+
+	line = begin;
+	len = newline - begin;
+	if (max_pwd_len > 0 && len > max_pwd_len)
+	{
+		len = max_pwd_len;
+		++truncated_num;
+	}
+	else if (overflow)
+		++truncated_num;
+	return true;
+}
+
+/**
+ *@brief 读取最多n行口令。映射文件时视图指向映射内存，不复制；
+ * 流式读取时各行依次复制到store中，视图指向store，在store下次修改之前有效
+ *@param line 输出口令起始地址
+ *@param len 输出口令长度
+ *@param n 最多读取的行数
+ *@param store 流式读取时保存口令的缓冲区，先清空
+ *@return 读到的行数，小于n表示到达文件末尾
+ */
+int PwdReader::next_batch(const char **line, int *len, int n, std::string &store)
+{
+	int count = 0;
+	if (stream_buf == NULL)
+	{
+		while (count < n && next(line[count], len[count]))
+			++count;
+		return count;
+	}
+
+	//复制过程中store可能重新分配，全部复制完后再按长度依次设置视图
+	store.clear();
+	while (count < n && next_stream(line[count], len[count]))
+	{
+		store.append(line[count], len[count]);
+		++count;
+	}
+	const char *p = store.data();
+	for (int i = 0; i < count; ++i)
+	{
+		line[i] = p;
+		p += len[i];
+	}
+	return count;
+}
+
+/**
+ *@brief 从文件中的字节偏移offset继续读取
+ *@param offset 之前某次next()之后offset()的值，即某一行的开头或文件末尾
+ *@return 0：正确，-1：offset超出文件或不在行首
+ */
+int PwdReader::seek(size_t offset)
+{
+	if (stream_buf != NULL || offset < begin_pos || offset > end_pos || (offset > begin_pos && offset < end_pos && data[offset - 1] != '\n'))
+		return -1;
+	pos = offset;
+	return 0;
+}
+
+//! 把字节偏移offset移到它所在行的下一行开头，offset已经是行首时不变
+size_t PwdReader::line_start(size_t offset) const
+{
+	if (offset == 0 || offset >= size || data[offset - 1] == '\n')
+		return offset < size ? offset : size;
+	const char *newline = find_newline(data + offset, data + size);
+	return newline < data + size ? newline - data + 1 : size;
+}
+
+/**
+ *@brief 只读取第k片：按字节把文件均分为n段，每段的边界移到下一行的开头，各片互不重叠并且覆盖整个文件
+ * 只按字节定位，不读取本片之前的内容
+ *@param k 片号，从1开始
+ *@param n 总片数
+ *@return 0：正确，-1：参数错误
+ */
+int PwdReader::shard(int k, int n)
+{
+	if (stream_buf != NULL || n < 1 || k < 1 || k > n)
+		return -1;
+	begin_pos = line_start((size_t)((unsigned long long)size * (k - 1) / n));
+	end_pos = line_start((size_t)((unsigned long long)size * k / n));
+	pos = begin_pos;
+	return 0;
+}
+
+/**
+ *@brief 统计[begin, end)中的行数，即从begin开始next()会返回的口令个数
+ */
+long long PwdReader::count_lines(size_t begin, size_t end) const
+{
+	long long lines = 0;
+	const char *p = data + begin, *last = data + end;
+	while (p < last)
+	{
+		p = find_newline(p, last) + 1;
+		++lines;
+	}
+	return lines;
+}
+
+//! 取消映射并关闭文件
+void PwdReader::close()
+{
+	if (data != NULL)
+		munmap((void *)data, size);
+	free(stream_buf);
+	if (fd >= 0)
+		::close(fd);
+	data = NULL;
+	fd = -1;
+	size = 0;
+	pos = 0;
+	begin_pos = 0;
+	end_pos = 0;
+	stream_buf = NULL;
+	stream_cap = 0;
+	stream_begin = 0;
+	stream_end = 0;
+	stream_eof = false;
+	read_error = false;
+}
@@ -0,0 +1,122 @@
+/**
+ *@file rng.cpp
+ *@brief 可设定种子、线程安全的随机盐产生器实现文件
+ *
+ * 使用xoshiro256**，状态由splitmix64从(种子, 计数器)展开，
+ * 因此可以按记录序号或批次序号直接构造产生器，不需要在线程间共享随机数状态
+ *@version 0.1
+ */
+#include "include/rng.h"
+#include <atomic>
+#include <random>
+
+//! splitmix64，用于把种子展开成产生器状态
+static uint64_t splitmix64(uint64_t &x)
+{
+	uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+static inline uint64_t rotl64(uint64_t x, int k)
+{
+	return (x << k) | (x >> (64 - k));
+}
+
+/**
+ *@brief 由(种子, 计数器)初始化产生器
+ *@param rng 产生器状态
+ *@param seed 种子
+ *@param counter 计数器，如记录序号、批次第一条记录序号、线程序号
+ */
+void rng_seed(struct rng_state *rng, uint64_t seed, uint64_t counter)
+{
+	uint64_t x = seed;
+	uint64_t key = splitmix64(x) ^ counter * 0xd1342543de82ef95ULL;
+	for (int i = 0; i < 4; ++i)
+		rng->s[i] = splitmix64(key);
+}
+
+//! xoshiro256**产生下一个64位随机数
+uint64_t rng_next(struct rng_state *rng)
+{
+	uint64_t *s = rng->s;
+	uint64_t result = rotl64(s[1] * 5, 7) * 9;
+	uint64_t t = s[1] << 17;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotl64(s[3], 45);
+	return result;
+}
+
+/**
+ *@brief 用拒绝采样从charset中无偏地选取len个字符
+ * 每个随机字节r只在r < 256 - 256 % charset_size时使用r % charset_size，
+ * 对任意大小的字符集都是均匀分布，一个64位随机数提供8个字节
+ *@param rng 产生器状态
+ *@param out 输出len个字符
+ *@param len 字符个数
+ *@param charset 字符集
+ *@param charset_size 字符集大小，1..256
+ */
+void rng_fill_charset(struct rng_state *rng, unsigned char *out, int len, const char *charset, int charset_size)
+{
+	unsigned limit = 256 - 256 % charset_size;
+	uint64_t bits = 0;
+	int bytes_left = 0;
+	int i = 0;
+	while (i < len)
+	{
+		if (bytes_left == 0)
+		{
+			bits = rng_next(rng);
+			bytes_left = 8;
+		}
+		unsigned r = bits & 0xff;
+		bits >>= 8;
+		--bytes_left;
+		if (r < limit)
+			out[i++] = charset[r % charset_size];
+	}
+}
+
+//! 进程种子，第一次使用时取随机值，可以由rng_set_process_seed()改为固定值；
+//! 用函数内的静态对象，嵌入libmyjtr的程序在自己的静态构造函数中调用时也已初始化
+static uint64_t &process_seed()
+{
+	static uint64_t seed = ((uint64_t)std::random_device()() << 32) | std::random_device()();
+	return seed;
+}
+
+//! 已经初始化产生器的线程个数，作为线程产生器的计数器
+static std::atomic<uint64_t> thread_counter(0);
+
+void rng_set_process_seed(uint64_t seed)
+{
+	process_seed() = seed;
+}
+
+uint64_t rng_process_seed()
+{
+	return process_seed();
+}
+
+/**
+ *@brief 当前线程的产生器
+ * 第一次使用时由(进程种子, 线程序号)初始化，之后只被本线程访问，不需要加锁
+ */
+struct rng_state *rng_thread_state()
+{
+	static thread_local struct rng_state rng;
+	static thread_local bool seeded = false;
+	if (!seeded)
+	{
+		rng_seed(&rng, process_seed(), ~thread_counter++);
+		seeded = true;
+	}
+	return &rng;
+}
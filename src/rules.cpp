@@ -0,0 +1,553 @@
+/**
+ *@file rules.cpp
+ *@brief 破解模式的字典变形规则实现文件
+ *@version 0.1
+ */
+#include "include/rules.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+/**
+ *@brief 规则字节码的操作码，操作数紧跟在操作码之后，位置和字符各占一个字节
+ */
+enum rule_op {
+	RULE_OP_END = 0,
+	RULE_OP_LOWER,        //l
+	RULE_OP_UPPER,        //u
+	RULE_OP_CAPITAL,      //c
+	RULE_OP_INVCAP,       //C
+	RULE_OP_TOGGLE,       //t
+	RULE_OP_TOGGLE_AT,    //TN
+	RULE_OP_REVERSE,      //r
+	RULE_OP_DUPLICATE,    //d
+	RULE_OP_REFLECT,      //f
+	RULE_OP_ROTATE_L,     //{
+	RULE_OP_ROTATE_R,     //}
+	RULE_OP_APPEND,       //$X
+	RULE_OP_PREPEND,      //^X
+	RULE_OP_DEL_FIRST,    //[
+	RULE_OP_DEL_LAST,     //]
+	RULE_OP_DEL_AT,       //DN
+	RULE_OP_TRUNCATE,     //'N
+	RULE_OP_EXTRACT,      //xNM
+	RULE_OP_INSERT,       //iNX
+	RULE_OP_OVERWRITE,    //oNX
+	RULE_OP_REPLACE,      //sXY
+	RULE_OP_PURGE,        //@X
+	RULE_OP_INSERT_STR,   //AN"str"，操作数为位置、长度和字符串
+	RULE_OP_REJECT_GE,    //<N
+	RULE_OP_REJECT_LE,    //>N
+	RULE_OP_REJECT_HAS,   //!X
+	RULE_OP_REJECT_NOT    ///X
+};
+
+#define RULE_POS_END 255    //AN中的z，表示口令末尾
+
+//! 位置字符0-9、A-Z转换为0-35，不是位置字符返回-1
+static int rule_position(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'A' && c <= 'Z')
+		return c - 'A' + 10;
+	return -1;
+}
+
+static inline char to_lower(char c)
+{
+	return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+static inline char to_upper(char c)
+{
+	return (c >= 'a' && c <= 'z') ? c - ('a' - 'A') : c;
+}
+
+static inline char toggle_case(char c)
+{
+	if (c >= 'a' && c <= 'z')
+		return c - ('a' - 'A');
+	if (c >= 'A' && c <= 'Z')
+		return c + ('a' - 'A');
+	return c;
+}
+
+/**
+ *@brief 读取并编译规则文件
+ *@param path 规则文件路径
+ *@return 0：正确，-1：文件不能读取或某一行规则错误
+ */
+int RuleSet::load(const char *path)
+{
+	FILE *fp = fopen(path, "r");
+	if (fp == NULL)
+	{
+		error_msg = std::string("can not open rules file ") + path;
+		return -1;
+	}
+	std::string line;
+	char buf[4096];
+	int line_no = 0;
+	int ret = 0;
+	while (ret == 0 && fgets(buf, sizeof(buf), fp) != NULL)
+	{
+		//! 1.拼接超过缓冲区的长行，去掉行尾的换行符
+		line += buf;
+		if (line[line.size() - 1] != '\n' && !feof(fp))
+			continue;
+		++line_no;
+		line.erase(line.find_last_not_of("\r\n") + 1);
+		//! 2.跳过空行和注释
+		if (!line.empty() && line[0] != '#' && add(line) != 0)
+		{
+			error_msg = std::string(path) + ":" + std::to_string(line_no) + ": " + error_msg;
+			ret = -1;
+		}
+		line.clear();
+	}
+	fclose(fp);
+	if (ret == 0 && entry.empty())
+	{
+		error_msg = std::string("no rule in ") + path;
+		ret = -1;
+	}
+	return ret;
+}
+
+/**
+ *@brief 展开一行规则中的[...]，再逐条编译
+ *@param line 一行规则
+ *@return 0：正确，-1：格式错误或展开后条数超过RULE_MAX_EXPAND
+ */
+int RuleSet::add(const std::string &line)
+{
+	//! 1.把规则切分为若干位置，每个位置是一组候选字符，普通字符和\转义的字符只有一个候选
+	std::vector<std::string> choices;
+	unsigned long long expand = 1;
+	for (size_t p = 0; p < line.size(); ++p)
+	{
+		std::string set;
+		if (line[p] == '\\' && p + 1 < line.size())
+			set = line.substr(++p, 1);
+		else if (line[p] == '[')
+		{
+			for (++p; p < line.size() && line[p] != ']'; ++p)
+			{
+				if (line[p] == '\\' && p + 1 < line.size())
+					++p;
+				else if (p + 2 < line.size() && line[p + 1] == '-' && line[p + 2] != ']')
+				{
+					for (unsigned c = (unsigned char)line[p]; c <= (unsigned char)line[p + 2]; ++c)
+					{
+						if (set.find((char)c) == std::string::npos)
+							set.push_back((char)c);
+					}
+					p += 2;
+					continue;
+				}
+				if (set.find(line[p]) == std::string::npos)
+					set.push_back(line[p]);
+			}
+			if (p >= line.size() || set.empty())
+			{
+				error_msg = "invalid [...] in rule " + line;
+				return -1;
+			}
+		}
+		else
+			set = line.substr(p, 1);
+		expand *= set.size();
+		if (expand > RULE_MAX_EXPAND)
+		{
+			error_msg = "rule " + line + " expands to more than " + std::to_string(RULE_MAX_EXPAND) + " rules";
+			return -1;
+		}
+		choices.push_back(set);
+	}
+	//! 2.按里程表顺序枚举每个位置的候选字符，最后一个位置变化最快
+	std::vector<int> digit(choices.size(), 0);
+	std::string rule(choices.size(), ' ');
+	for (unsigned long long k = 0; k < expand; ++k)
+	{
+		for (size_t i = 0; i < choices.size(); ++i)
+			rule[i] = choices[i][digit[i]];
+		if (compile(rule) != 0)
+			return -1;
+		for (int i = (int)choices.size() - 1; i >= 0; --i)
+		{
+			if (++digit[i] < (int)choices[i].size())
+				break;
+			digit[i] = 0;
+		}
+	}
+	return 0;
+}
+
+/**
+ *@brief 把一条已展开的规则编译为字节码，追加到code
+ *@param rule 规则
+ *@return 0：正确，-1：未知命令或缺少操作数
+ */
+int RuleSet::compile(const std::string &rule)
+{
+	size_t start = code.size();
+	size_t p = 0;
+	size_t n = rule.size();
+	while (p < n)
+	{
+		char cmd = rule[p++];
+		int pos = 0, pos2 = 0;
+		switch (cmd)
+		{
+			case ' ': case '\t': case ':':
+				continue;
+			case 'l': code.push_back(RULE_OP_LOWER); continue;
+			case 'u': code.push_back(RULE_OP_UPPER); continue;
+			case 'c': code.push_back(RULE_OP_CAPITAL); continue;
+			case 'C': code.push_back(RULE_OP_INVCAP); continue;
+			case 't': code.push_back(RULE_OP_TOGGLE); continue;
+			case 'r': code.push_back(RULE_OP_REVERSE); continue;
+			case 'd': code.push_back(RULE_OP_DUPLICATE); continue;
+			case 'f': code.push_back(RULE_OP_REFLECT); continue;
+			case '{': code.push_back(RULE_OP_ROTATE_L); continue;
+			case '}': code.push_back(RULE_OP_ROTATE_R); continue;
+			case '[': code.push_back(RULE_OP_DEL_FIRST); continue;
+			case ']': code.push_back(RULE_OP_DEL_LAST); continue;
+			case '$': case '^': case '@': case '!': case '/':
+				//! 一个字符操作数
+				if (p >= n)
+					break;
+				code.push_back(cmd == '$' ? RULE_OP_APPEND : cmd == '^' ? RULE_OP_PREPEND : cmd == '@' ? RULE_OP_PURGE
+					: cmd == '!' ? RULE_OP_REJECT_HAS : RULE_OP_REJECT_NOT);
+				code.push_back((unsigned char)rule[p++]);
+				continue;
+			case 's':
+				if (p + 1 >= n)
+					break;
+				code.push_back(RULE_OP_REPLACE);
+				code.push_back((unsigned char)rule[p++]);
+				code.push_back((unsigned char)rule[p++]);
+				continue;
+			case 'T': case 'D': case '\'': case '<': case '>':
+				//! 一个位置操作数
+				if (p >= n || (pos = rule_position(rule[p++])) < 0)
+					break;
+				code.push_back(cmd == 'T' ? RULE_OP_TOGGLE_AT : cmd == 'D' ? RULE_OP_DEL_AT : cmd == '\'' ? RULE_OP_TRUNCATE
+					: cmd == '<' ? RULE_OP_REJECT_GE : RULE_OP_REJECT_LE);
+				code.push_back((unsigned char)pos);
+				continue;
+			case 'x':
+				if (p + 1 >= n || (pos = rule_position(rule[p])) < 0 || (pos2 = rule_position(rule[p + 1])) < 0)
+					break;
+				p += 2;
+				code.push_back(RULE_OP_EXTRACT);
+				code.push_back((unsigned char)pos);
+				code.push_back((unsigned char)pos2);
+				continue;
+			case 'i': case 'o':
+				if (p + 1 >= n || (pos = rule_position(rule[p])) < 0)
+					break;
+				code.push_back(cmd == 'i' ? RULE_OP_INSERT : RULE_OP_OVERWRITE);
+				code.push_back((unsigned char)pos);
+				code.push_back((unsigned char)rule[p + 1]);
+				p += 2;
+				continue;
+			case 'A':
+			{
+				//! AN"str"，分隔符为N之后的第一个字符
+				if (p + 1 >= n || ((pos = rule_position(rule[p])) < 0 && rule[p] != 'z'))
+					break;
+				size_t close = rule.find(rule[p + 1], p + 2);
+				if (close == std::string::npos || close - (p + 2) > 255)
+					break;
+				code.push_back(RULE_OP_INSERT_STR);
+				code.push_back(rule[p] == 'z' ? RULE_POS_END : (unsigned char)pos);
+				code.push_back((unsigned char)(close - (p + 2)));
+				code.insert(code.end(), rule.begin() + p + 2, rule.begin() + close);
+				p = close + 1;
+				continue;
+			}
+			default:
+				break;
+		}
+		code.resize(start);
+		error_msg = "invalid command '" + std::string(1, cmd) + "' in rule " + rule;
+		return -1;
+	}
+	code.push_back(RULE_OP_END);
+	entry.push_back((int)start);
+	return 0;
+}
+
+/**
+ *@brief 执行一条规则的字节码
+ *@param rule 规则序号
+ *@param in 口令
+ *@param len 口令长度，超过RULE_BUF_LEN的部分被忽略
+ *@param out 输出缓冲区，至少RULE_BUF_LEN字节
+ *@return 结果长度，被拒绝返回-1
+ */
+int RuleSet::apply(int rule, const char *in, int len, char *out) const
+{
+	if (len > RULE_BUF_LEN)
+		len = RULE_BUF_LEN;
+	memcpy(out, in, len);
+	const unsigned char *pc = &code[entry[rule]];
+	for (;;)
+	{
+		int op = *pc++;
+		int a, b, i;
+		switch (op)
+		{
+			case RULE_OP_END:
+				return len;
+			case RULE_OP_LOWER:
+				for (i = 0; i < len; ++i)
+					out[i] = to_lower(out[i]);
+				break;
+			case RULE_OP_UPPER:
+				for (i = 0; i < len; ++i)
+					out[i] = to_upper(out[i]);
+				break;
+			case RULE_OP_CAPITAL:
+				for (i = 0; i < len; ++i)
+					out[i] = i == 0 ? to_upper(out[i]) : to_lower(out[i]);
+				break;
+			case RULE_OP_INVCAP:
+				for (i = 0; i < len; ++i)
+					out[i] = i == 0 ? to_lower(out[i]) : to_upper(out[i]);
+				break;
+			case RULE_OP_TOGGLE:
+				for (i = 0; i < len; ++i)
+					out[i] = toggle_case(out[i]);
+				break;
+			case RULE_OP_TOGGLE_AT:
+				a = *pc++;
+				if (a < len)
+					out[a] = toggle_case(out[a]);
+				break;
+			case RULE_OP_REVERSE:
+				std::reverse(out, out + len);
+				break;
+			case RULE_OP_DUPLICATE:
+				a = std::min(len, RULE_BUF_LEN - len);
+				memcpy(out + len, out, a);
+				len += a;
+				break;
+			case RULE_OP_REFLECT:
+				a = std::min(len, RULE_BUF_LEN - len);
+				for (i = 0; i < a; ++i)
+					out[len + i] = out[len - 1 - i];
+				len += a;
+				break;
+			case RULE_OP_ROTATE_L:
+				if (len > 1)
+					std::rotate(out, out + 1, out + len);
+				break;
+			case RULE_OP_ROTATE_R:
+				if (len > 1)
+					std::rotate(out, out + len - 1, out + len);
+				break;
+			case RULE_OP_APPEND:
+				a = *pc++;
+				if (len < RULE_BUF_LEN)
+					out[len++] = (char)a;
+				break;
+			case RULE_OP_PREPEND:
+				a = *pc++;
+				if (len == RULE_BUF_LEN)
+					--len;
+				memmove(out + 1, out, len++);
+				out[0] = (char)a;
+				break;
+			case RULE_OP_DEL_FIRST:
+				if (len > 0)
+					memmove(out, out + 1, --len);
+				break;
+			case RULE_OP_DEL_LAST:
+				if (len > 0)
+					--len;
+				break;
+			case RULE_OP_DEL_AT:
+				a = *pc++;
+				if (a < len)
+				{
+					memmove(out + a, out + a + 1, len - a - 1);
+					--len;
+				}
+				break;
+			case RULE_OP_TRUNCATE:
+				a = *pc++;
+				if (len > a)
+					len = a;
+				break;
+			case RULE_OP_EXTRACT:
+				a = *pc++;
+				b = *pc++;
+				if (a >= len)
+					len = 0;
+				else
+				{
+					len = std::min(b, len - a);
+					memmove(out, out + a, len);
+				}
+				break;
+			case RULE_OP_INSERT:
+				a = *pc++;
+				b = *pc++;
+				if (len < RULE_BUF_LEN)
+				{
+					if (a > len)
+						a = len;
+					memmove(out + a + 1, out + a, len - a);
+					out[a] = (char)b;
+					++len;
+				}
+				break;
+			case RULE_OP_OVERWRITE:
+				a = *pc++;
+				b = *pc++;
+				if (a < len)
+					out[a] = (char)b;
+				break;
+			case RULE_OP_REPLACE:
+				a = *pc++;
+				b = *pc++;
+				for (i = 0; i < len; ++i)
+				{
+					if (out[i] == (char)a)
+						out[i] = (char)b;
+				}
+				break;
+			case RULE_OP_PURGE:
+				a = *pc++;
+				b = 0;
+				for (i = 0; i < len; ++i)
+				{
+					if (out[i] != (char)a)
+						out[b++] = out[i];
+				}
+				len = b;
+				break;
+			case RULE_OP_INSERT_STR:
+				a = *pc++;
+				b = *pc++;
+				if (a > len)
+					a = len;
+				i = std::min(b, RULE_BUF_LEN - len);
+				memmove(out + a + i, out + a, len - a);
+				memcpy(out + a, pc, i);
+				len += i;
+				pc += b;
+				break;
+			case RULE_OP_REJECT_GE:
+				if (len >= *pc++)
+					return -1;
+				break;
+			case RULE_OP_REJECT_LE:
+				if (len <= *pc++)
+					return -1;
+				break;
+			case RULE_OP_REJECT_HAS:
+				if (memchr(out, *pc++, len) != NULL)
+					return -1;
+				break;
+			case RULE_OP_REJECT_NOT:
+				if (memchr(out, *pc++, len) == NULL)
+					return -1;
+				break;
+			default:
+				return -1;
+		}
+	}
+}
+
+RuleBatch::RuleBatch(const RuleSet &rules, int max_len)
+	: rules(rules), max_len(max_len), rule_index(rules.size()), word_index(0), rejected_num(0), duplicate_num(0)
+{
+	word_begin.push_back(0);
+}
+
+/**
+ *@brief 设置一组基础口令
+ *@param word 基础口令
+ *@param len 基础口令长度
+ *@param n 基础口令个数
+ */
+void RuleBatch::set_words(const char *const *word, const int *len, int n)
+{
+	//! 1.复制到连续内存，跳过空行
+	words.clear();
+	word_begin.clear();
+	for (int i = 0; i < n; ++i)
+	{
+		if (len[i] == 0)
+			continue;
+		word_begin.push_back((int)words.size());
+		words.append(word[i], len[i]);
+	}
+	word_begin.push_back((int)words.size());
+	int word_num = (int)word_begin.size() - 1;
+	rule_index = word_num > 0 ? 0 : rules.size();
+	word_index = 0;
+	//! 2.去重表的槽数至少为本组候选口令数的2倍，不超过RULE_DEDUP_MAX_SLOTS
+	size_t want = (size_t)word_num * rules.size() * 2;
+	size_t slots = 1024;
+	while (slots < want && slots < RULE_DEDUP_MAX_SLOTS)
+		slots <<= 1;
+	seen.assign(slots, 0);
+}
+
+//! 64位FNV-1a指纹，0保留为空槽
+static inline uint64_t rule_fingerprint(const char *p, int len)
+{
+	uint64_t h = 0xcbf29ce484222325ULL ^ (uint64_t)len;
+	for (int i = 0; i < len; ++i)
+		h = (h ^ (unsigned char)p[i]) * 0x100000001b3ULL;
+	h ^= h >> 29;
+	return h == 0 ? 1 : h;
+}
+
+/**
+ *@brief 按规则优先的顺序产生候选口令：第rule_index条规则依次作用于本组每个基础口令
+ *@param arena 本批的分配器，候选口令复制到其中
+ *@param pwd 输出每个候选口令的地址
+ *@param len 输出每个候选口令的长度
+ *@param n 最多产生的个数
+ *@return 产生的个数
+ */
+int RuleBatch::generate(BatchArena &arena, const char **pwd, int *len, int n)
+{
+	char buf[RULE_BUF_LEN];
+	int word_num = (int)word_begin.size() - 1;
+	size_t slot_mask = seen.size() - 1;
+	int count = 0;
+	while (count < n && rule_index < rules.size())
+	{
+		const char *word = words.data() + word_begin[word_index];
+		int out_len = rules.apply(rule_index, word, word_begin[word_index + 1] - word_begin[word_index], buf);
+		if (++word_index == word_num)
+		{
+			word_index = 0;
+			++rule_index;
+		}
+		if (out_len <= 0 || out_len > max_len)
+		{
+			++rejected_num;
+			continue;
+		}
+		uint64_t fp = rule_fingerprint(buf, out_len);
+		uint64_t &slot = seen[fp & slot_mask];
+		if (slot == fp)
+		{
+			++duplicate_num;
+			continue;
+		}
+		slot = fp;
+		pwd[count] = (const char *)arena.copy((const Byte *)buf, out_len).getByte_p();
+		len[count] = out_len;
+		++count;
+	}
+	return count;
+}
@@ -0,0 +1,241 @@
+/**
+ *@file shard.cpp
+ *@brief 按字节范围把口令文件分给多台机器计算，以及合并各片密文的实现文件
+ *
+ * 第k片(共n片)处理口令文件中[(k-1)*size/n, k*size/n)的字节，两端都移到下一行的开头，
+ * 各片互不重叠并且覆盖整个文件，每台机器只读取自己的一片。
+ * 每片的密文按输入顺序输出，所以按片号顺序拼接各片的密文文件就恢复了整个口令文件的顺序；
+ * 每片的记录序号从本片的起始行号开始，所以按记录序号产生的随机盐也与不分片运行相同
+ *@version 0.1
+ */
+#include "include/shard.h"
+#include "include/cipher_writer.h"
+#include "include/state_file.h"
+#include <openssl/evp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#define SHARD_COPY_BUFFER_SIZE (4 << 20)    //合并时每次读取4MB
+
+/**
+ *@brief 解析"k/n"形式的分片参数
+ *@param spec 分片参数字符串
+ *@param k 输出片号，1 <= k <= n
+ *@param n 输出总片数，1 <= n <= MAX_SHARD_NUM
+ *@return 0：正确，-1：格式错误
+ */
+int parse_shard(const char *spec, int &k, int &n)
+{
+	char end;
+	if (sscanf(spec, "%d/%d%c", &k, &n, &end) != 2 || n < 1 || n > MAX_SHARD_NUM || k < 1 || k > n)
+		return -1;
+	return 0;
+}
+
+/**
+ *@brief 把SHA-256摘要转换为十六进制字符串
+ */
+static std::string digest_hex(const unsigned char *digest, unsigned int len)
+{
+	static const char hex[] = "0123456789abcdef";
+	std::string s;
+	for (unsigned int i = 0; i < len; ++i)
+	{
+		s += hex[digest[i] >> 4];
+		s += hex[digest[i] & 0xf];
+	}
+	return s;
+}
+
+/**
+ *@brief 流式读取文件，计算字节数和SHA-256，out不为NULL时同时写入out
+ *@param path 文件路径
+ *@param out 合并输出的文件，可以为NULL
+ *@param bytes 输出文件字节数
+ *@param sha256 输出SHA-256的十六进制字符串
+ *@return 0：正确，-1：读取或写入出错
+ */
+static int stream_file(const char *path, CipherWriter *out, long long &bytes, std::string &sha256)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+	posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	std::vector<char> buffer(SHARD_COPY_BUFFER_SIZE);
+	EVP_MD_CTX *md = EVP_MD_CTX_new();
+	int ret = (md != NULL && EVP_DigestInit_ex(md, EVP_sha256(), NULL) == 1) ? 0 : -1;
+	bytes = 0;
+	while (ret == 0)
+	{
+		ssize_t n = read(fd, &buffer[0], buffer.size());
+		if (n == 0)
+			break;
+		if (n < 0 || EVP_DigestUpdate(md, &buffer[0], n) != 1 || (out != NULL && out->write(&buffer[0], n) != 0))
+			ret = -1;
+		else
+			bytes += n;
+	}
+	unsigned char digest[EVP_MAX_MD_SIZE];
+	unsigned int len = 0;
+	if (ret == 0 && EVP_DigestFinal_ex(md, digest, &len) != 1)
+		ret = -1;
+	if (ret == 0)
+		sha256 = digest_hex(digest, len);
+	EVP_MD_CTX_free(md);
+	close(fd);
+	return ret;
+}
+
+//! 写清单文件的各行
+static int write_manifest_fields(FILE *fp, const void *arg)
+{
+	const struct shard_manifest *manifest = (const struct shard_manifest *)arg;
+	fprintf(fp, "%s\nshard=%d/%d\nalg_name=%s\ninput_size=%lld\nbyte_begin=%lld\nbyte_end=%lld\nline_begin=%lld\nline_end=%lld\noutput_bytes=%lld\nsha256=%s\n",
+		SHARD_MAGIC, manifest->k, manifest->n, manifest->alg_name.c_str(), manifest->input_size,
+		manifest->byte_begin, manifest->byte_end, manifest->line_begin, manifest->line_end,
+		manifest->output_bytes, manifest->sha256.c_str());
+	return 0;
+}
+
+/**
+ *@brief 计算密文文件的字节数和SHA-256，写清单文件，先写临时文件再改名
+ *@param cipher_path 本片的密文文件，已经关闭
+ *@param manifest 本片的清单，output_bytes和sha256在这里填写
+ *@return 0：正确，-1：出错
+ */
+int write_shard_manifest(const char *cipher_path, struct shard_manifest *manifest)
+{
+	if (stream_file(cipher_path, NULL, manifest->output_bytes, manifest->sha256) != 0)
+		return -1;
+	std::string path = std::string(cipher_path) + SHARD_MANIFEST_SUFFIX;
+	return write_file_atomic(path.c_str(), write_manifest_fields, manifest, 1);
+}
+
+//! 读取清单文件的一个字段
+static int read_manifest_field(const char *name, const char *value, void *arg)
+{
+	struct shard_manifest *manifest = (struct shard_manifest *)arg;
+	std::string field = name;
+	if (field == "shard")
+		return parse_shard(value, manifest->k, manifest->n) == 0 ? 1 : -1;
+	else if (field == "alg_name")
+		manifest->alg_name = value;
+	else if (field == "input_size")
+		manifest->input_size = atoll(value);
+	else if (field == "byte_begin")
+		manifest->byte_begin = atoll(value);
+	else if (field == "byte_end")
+		manifest->byte_end = atoll(value);
+	else if (field == "line_begin")
+		manifest->line_begin = atoll(value);
+	else if (field == "line_end")
+		manifest->line_end = atoll(value);
+	else if (field == "output_bytes")
+		manifest->output_bytes = atoll(value);
+	else if (field == "sha256")
+		manifest->sha256 = value;
+	else
+		return 0;
+	return 1;
+}
+
+/**
+ *@brief 读取密文文件对应的清单文件，缺少任何一项都认为清单无效
+ *@return 0：正确，-1：出错
+ */
+static int read_shard_manifest(const char *cipher_path, struct shard_manifest *manifest)
+{
+	std::string path = std::string(cipher_path) + SHARD_MANIFEST_SUFFIX;
+	return read_state_file(path.c_str(), SHARD_MAGIC, read_manifest_field, manifest) == 9 ? 0 : -1;
+}
+
+/**
+ *@brief 按片号顺序流式合并各片的密文文件
+ * 先检查所有清单：片数一致、片号1..n各出现一次、字节范围和行号范围首尾相接并覆盖整个口令文件，
+ * 再逐片复制到输出文件，复制时校验长度和SHA-256，不把整片读入内存
+ *@param out_path 合并后的密文文件
+ *@param shard_paths 各片的密文文件，顺序任意
+ *@param shard_num 文件个数
+ *@return 0：正确，-1：出错，出错时删除合并文件
+ */
+int merge_shards(const char *out_path, char **shard_paths, int shard_num)
+{
+	//! 1. 读取清单并按片号排序
+	std::vector<std::pair<struct shard_manifest, const char *> > shards(shard_num);
+	for (int i = 0; i < shard_num; ++i)
+	{
+		if (read_shard_manifest(shard_paths[i], &shards[i].first) != 0)
+		{
+			std::cout << "error: read manifest of " << shard_paths[i] << " failed!" << std::endl;
+			return -1;
+		}
+		shards[i].second = shard_paths[i];
+	}
+	std::sort(shards.begin(), shards.end(),
+		[](const std::pair<struct shard_manifest, const char *> &a, const std::pair<struct shard_manifest, const char *> &b) {
+			return a.first.k < b.first.k;
+		});
+
+	//! 2. 检查各片是否属于同一个任务、完整并且首尾相接
+	for (int i = 0; i < shard_num; ++i)
+	{
+		const struct shard_manifest &m = shards[i].first;
+		const struct shard_manifest &first = shards[0].first;
+		if (m.n != shard_num || m.k != i + 1)
+		{
+			std::cout << "error: need shards 1.." << m.n << " exactly once, got " << shard_num << " files!" << std::endl;
+			return -1;
+		}
+		if (m.alg_name != first.alg_name || m.input_size != first.input_size
+			|| m.byte_begin != (i == 0 ? 0 : shards[i - 1].first.byte_end)
+			|| m.line_begin != (i == 0 ? 0 : shards[i - 1].first.line_end)
+			|| m.line_end < m.line_begin
+			|| (i == shard_num - 1 && m.byte_end != m.input_size))
+		{
+			std::cout << "error: shard " << m.k << "/" << m.n << " in " << shards[i].second << " does not continue the previous shard!" << std::endl;
+			return -1;
+		}
+	}
+
+	//! 3. 逐片复制，校验长度和SHA-256
+	CipherWriter out;
+	if (out.open(out_path) != 0)
+	{
+		std::cout << "error: open merged file " << out_path << " failed!" << std::endl;
+		return -1;
+	}
+	for (int i = 0; i < shard_num; ++i)
+	{
+		const struct shard_manifest &m = shards[i].first;
+		long long bytes;
+		std::string sha256;
+		if (stream_file(shards[i].second, &out, bytes, sha256) != 0)
+		{
+			std::cout << "error: copy " << shards[i].second << " failed!" << std::endl;
+			out.close();
+			unlink(out_path);
+			return -1;
+		}
+		if (bytes != m.output_bytes || sha256 != m.sha256)
+		{
+			std::cout << "error: " << shards[i].second << " does not match its manifest!" << std::endl;
+			out.close();
+			unlink(out_path);
+			return -1;
+		}
+		std::cout << "merge: shard " << m.k << "/" << m.n << " lines [" << m.line_begin << ", " << m.line_end << "), "
+			<< bytes << " bytes" << std::endl;
+	}
+	if (out.close() != 0)
+	{
+		std::cout << "error: write merged file " << out_path << " failed!" << std::endl;
+		return -1;
+	}
+	std::cout << "merge: " << shard_num << " shards, " << shards[shard_num - 1].first.line_end << " lines, " << out.bytes_written() << " bytes" << std::endl;
+	return 0;
+}
@@ -0,0 +1,73 @@
+/**
+ *@file state_file.cpp
+ *@brief 检查点、分片清单、统计文件等状态文件的原子写入和"名称=值"格式读取实现文件
+ *@version 0.1
+ */
+#include "include/state_file.h"
+#include <string.h>
+#include <unistd.h>
+#include <string>
+
+/**
+ *@brief 原子地写一个文件，先写path.tmp，再rename为path，出错时删除临时文件
+ *@param path 文件路径
+ *@param write 写入内容，返回0：正确，-1：出错
+ *@param arg 传给write的参数
+ *@param sync 非0时rename之前fsync，断电后path也是完整的文件
+ *@return 0：正确，-1：出错
+ */
+int write_file_atomic(const char *path, int (*write)(FILE *fp, const void *arg), const void *arg, int sync)
+{
+	std::string tmp_path = std::string(path) + ".tmp";
+	FILE *fp = fopen(tmp_path.c_str(), "w");
+	if (fp == NULL)
+		return -1;
+	int ret = write(fp, arg);
+	if (ret == 0 && (fflush(fp) != 0 || (sync && fsync(fileno(fp)) != 0)))
+		ret = -1;
+	if (fclose(fp) != 0)
+		ret = -1;
+	if (ret == 0 && rename(tmp_path.c_str(), path) != 0)
+		ret = -1;
+	if (ret != 0)
+		unlink(tmp_path.c_str());
+	return ret;
+}
+
+/**
+ *@brief 读取状态文件，第一行必须是magic，之后每行一个"名称=值"
+ *@param path 文件路径
+ *@param magic 第一行的内容，不含换行符
+ *@param field 处理一个字段，返回1：已识别，0：不认识的名称，忽略，-1：值不对
+ *@param arg 传给field的参数
+ *@return 已识别的字段个数，-1：文件不存在、第一行不对、有不是"名称=值"的行或值不对
+ */
+int read_state_file(const char *path, const char *magic, int (*field)(const char *name, const char *value, void *arg), void *arg)
+{
+	FILE *fp = fopen(path, "r");
+	if (fp == NULL)
+		return -1;
+	char line[256];
+	size_t magic_len = strlen(magic);
+	int fields = 0;
+	if (fgets(line, sizeof(line), fp) == NULL || strncmp(line, magic, magic_len) != 0 || line[magic_len] != '\n')
+		fields = -1;
+	while (fields >= 0 && fgets(line, sizeof(line), fp) != NULL)
+	{
+		line[strcspn(line, "\r\n")] = '\0';
+		char *value = strchr(line, '=');
+		if (value == NULL)
+		{
+			fields = -1;
+			break;
+		}
+		*value++ = '\0';
+		int ret = field(line, value, arg);
+		if (ret < 0)
+			fields = -1;
+		else
+			fields += ret;
+	}
+	fclose(fp);
+	return fields;
+}
@@ -0,0 +1,458 @@
+/**
+ *@file target_store.cpp
+ *@brief 破解模式的紧凑密文库实现文件
+ *
+ * 每个密文只保存hash值和盐(wordpress为16 + 8 = 24字节)，参数相同的连续密文共用一个段记录，
+ * 密文较多的组另有bloom过滤器。建立时先在临时数组中解析、排序、去重，再一次性生成内存映像
+ *@version 0.1
+ */
+#include "include/target_store.h"
+#include "include/pwd_reader.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <map>
+#include <vector>
+
+//! 向上对齐到TARGET_SECTION_ALIGN
+static uint64_t align_section(uint64_t offset)
+{
+	return (offset + TARGET_SECTION_ALIGN - 1) / TARGET_SECTION_ALIGN * TARGET_SECTION_ALIGN;
+}
+
+TargetStore::TargetStore()
+	: image(NULL), mapped_size(0), header(NULL), hashes(NULL), salts(NULL),
+	segments(NULL), values(NULL), blooms(NULL), bloom_words(NULL)
+{
+}
+
+TargetStore::~TargetStore()
+{
+	close();
+}
+
+/**
+ *@brief 根据内存映像的文件头设置各数组的指针
+ *@param image_p 密文库的内存映像
+ *@return 0：正确，-1：文件头不合法
+ */
+int TargetStore::attach(char *image_p)
+{
+	const struct target_index_header *h = (const struct target_index_header *)image_p;
+	if (memcmp(h->magic, TARGET_INDEX_MAGIC, 8) != 0 || h->param_num > 32)
+		return -1;
+	image = image_p;
+	header = h;
+	hashes = (const unsigned char *)(image + h->hash_offset);
+	salts = (const unsigned char *)(image + h->salt_offset);
+	segments = (const struct target_segment *)(image + h->segment_offset);
+	values = (const union extra_data *)(image + h->value_offset);
+	blooms = (const struct target_bloom *)(image + h->bloom_offset);
+	bloom_words = (const uint64_t *)(image + h->bloom_word_offset);
+	return 0;
+}
+
+//! 释放内存映像或取消映射
+void TargetStore::close()
+{
+	if (image != NULL)
+	{
+		if (mapped_size > 0)
+			munmap(image, mapped_size);
+		else
+			free(image);
+	}
+	image = NULL;
+	mapped_size = 0;
+	header = NULL;
+}
+
+/**
+ *@brief 解析密文文件建立密文库
+ *@param desp 已初始化的算法描述，必须提供parse_cipher
+ *@param cipher_path 密文文件路径
+ *@return 0：正确，-1：出错或没有有效的密文
+ */
+int TargetStore::build(struct alg_desp *desp, const char *cipher_path)
+{
+	close();
+	PwdReader cipher_in;
+	struct stat st;
+	if (cipher_in.open(cipher_path) != 0 || stat(cipher_path, &st) != 0)
+	{
+		std::cout << "error: open cipher_file " << cipher_path << " failed!" << std::endl;
+		return -1;
+	}
+
+	//! 1. 在算法描述的副本上解析，只有算法声明的密文自带参数作为每段的参数，
+	//     seed等每次运行都不同的附加信息不能保存到索引文件中，否则以后的运行中lookup()找不到已破解的密文
+	struct alg_desp parse_desp = *desp;
+	std::vector<int> param_index(desp->cipher_params, desp->cipher_params + desp->cipher_param_num);
+
+	//! 2. 解析每个密文到临时数组，参数和盐长度相同的密文属于同一段
+	std::map<std::string, uint32_t> segment_map;
+	std::vector<union extra_data> segment_values;
+	std::vector<int> segment_salt_len;
+	std::vector<uint32_t> rec_segment;
+	std::vector<unsigned char> rec_salt, rec_hash;
+	int salt_size = 1, hash_size = 0;
+	unsigned char salt[CIPHER_MAX_SALT], hash[CIPHER_MAX_HASH];
+	int salt_len, hash_len;
+	long long invalid = 0;
+	const char *line;
+	int len;
+	while (cipher_in.next(line, len))
+	{
+		if (len == 0)
+			continue;
+		if (desp->parse_cipher(line, len, salt, salt_len, hash, hash_len, parse_desp.extra) != 0
+			|| (hash_size != 0 && hash_len != hash_size))
+		{
+			++invalid;
+			continue;
+		}
+		hash_size = hash_len;
+
+		std::string key((const char *)&salt_len, sizeof(salt_len));
+		for (size_t k = 0; k < param_index.size(); ++k)
+			key.append((const char *)&parse_desp.extra[param_index[k]].cur_value, sizeof(union extra_data));
+		std::map<std::string, uint32_t>::iterator it = segment_map.find(key);
+		if (it == segment_map.end())
+		{
+			it = segment_map.insert(std::make_pair(key, (uint32_t)segment_salt_len.size())).first;
+			segment_salt_len.push_back(salt_len);
+			for (size_t k = 0; k < param_index.size(); ++k)
+				segment_values.push_back(parse_desp.extra[param_index[k]].cur_value);
+		}
+
+		//! 2.1 出现更长的盐时按新的元素大小重新排列盐数组，wordpress最多发生一次
+		if (salt_len > salt_size)
+		{
+			std::vector<unsigned char> wider(rec_segment.size() * salt_len, 0);
+			for (size_t i = 0; i < rec_segment.size(); ++i)
+				memcpy(&wider[i * salt_len], &rec_salt[i * salt_size], salt_size);
+			rec_salt.swap(wider);
+			salt_size = salt_len;
+		}
+		rec_segment.push_back(it->second);
+		rec_salt.resize(rec_salt.size() + salt_size, 0);
+		memcpy(&rec_salt[rec_salt.size() - salt_size], salt, salt_len);
+		rec_hash.insert(rec_hash.end(), hash, hash + hash_len);
+	}
+	cipher_in.close();
+	if (rec_segment.empty())
+	{
+		std::cout << "error: no valid cipher for " << desp->alg_name << " in " << cipher_path << "!" << std::endl;
+		return -1;
+	}
+
+	//! 3. 按(段, 盐, hash值)排序，去掉重复的密文
+	size_t n = rec_segment.size();
+	std::vector<uint32_t> order(n);
+	for (size_t i = 0; i < n; ++i)
+		order[i] = i;
+	std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+		if (rec_segment[a] != rec_segment[b])
+			return rec_segment[a] < rec_segment[b];
+		int c = memcmp(&rec_salt[a * salt_size], &rec_salt[b * salt_size], salt_size);
+		if (c != 0)
+			return c < 0;
+		return memcmp(&rec_hash[a * hash_size], &rec_hash[b * hash_size], hash_size) < 0;
+	});
+	size_t unique = 0;
+	for (size_t i = 0; i < n; ++i)
+	{
+		uint32_t a = order[i];
+		if (unique > 0)
+		{
+			uint32_t b = order[unique - 1];
+			if (rec_segment[a] == rec_segment[b]
+				&& memcmp(&rec_salt[a * salt_size], &rec_salt[b * salt_size], salt_size) == 0
+				&& memcmp(&rec_hash[a * hash_size], &rec_hash[b * hash_size], hash_size) == 0)
+				continue;
+		}
+		order[unique++] = a;
+	}
+	n = unique;
+
+	//! 4. 统计段的起始下标和需要bloom过滤器的组
+	std::vector<struct target_segment> segment_list;
+	std::vector<union extra_data> value_list;
+	std::vector<struct target_bloom> bloom_list;
+	std::vector<size_t> bloom_end;
+	uint64_t bloom_word_num = 0;
+	for (size_t i = 0; i < n; )
+	{
+		uint32_t seg = rec_segment[order[i]];
+		if (i == 0 || seg != rec_segment[order[i - 1]])
+		{
+			struct target_segment segment = {i, segment_salt_len[seg], 0};
+			segment_list.push_back(segment);
+			value_list.insert(value_list.end(), segment_values.begin() + seg * param_index.size(),
+				segment_values.begin() + (seg + 1) * param_index.size());
+		}
+		size_t end = i + 1;
+		while (end < n && rec_segment[order[end]] == seg
+			&& memcmp(&rec_salt[order[end] * salt_size], &rec_salt[order[i] * salt_size], salt_size) == 0)
+			++end;
+		if (end - i >= TARGET_BLOOM_MIN && hash_size >= 8)
+		{
+			uint32_t bits = 64;
+			while (bits < (end - i) * TARGET_BLOOM_BITS)
+				bits <<= 1;
+			struct target_bloom bloom = {i, (uint32_t)bloom_word_num, bits - 1};
+			bloom_list.push_back(bloom);
+			bloom_end.push_back(end);
+			bloom_word_num += bits / 64;
+		}
+		i = end;
+	}
+
+	//! 5. 计算各数组的偏移，生成与索引文件相同的内存映像
+	struct target_index_header h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, TARGET_INDEX_MAGIC, 8);
+	strncpy(h.alg_name, desp->alg_name.c_str(), sizeof(h.alg_name) - 1);
+	h.source_size = st.st_size;
+	h.source_mtime = st.st_mtime;
+	h.hash_size = hash_size;
+	h.salt_size = salt_size;
+	h.target_num = n;
+	h.param_num = param_index.size();
+	for (size_t k = 0; k < param_index.size(); ++k)
+		h.param_index[k] = param_index[k];
+	h.segment_num = segment_list.size();
+	h.bloom_num = bloom_list.size();
+	h.bloom_word_num = bloom_word_num;
+	h.hash_offset = align_section(sizeof(h));
+	h.salt_offset = align_section(h.hash_offset + n * hash_size);
+	h.segment_offset = align_section(h.salt_offset + n * salt_size);
+	h.value_offset = align_section(h.segment_offset + segment_list.size() * sizeof(struct target_segment));
+	h.bloom_offset = align_section(h.value_offset + value_list.size() * sizeof(union extra_data));
+	h.bloom_word_offset = align_section(h.bloom_offset + bloom_list.size() * sizeof(struct target_bloom));
+	h.file_size = h.bloom_word_offset + bloom_word_num * sizeof(uint64_t);
+
+	char *image_p = (char *)calloc(1, h.file_size);
+	if (image_p == NULL)
+	{
+		std::cout << "error: no memory for " << n << " targets!" << std::endl;
+		return -1;
+	}
+	memcpy(image_p, &h, sizeof(h));
+	for (size_t i = 0; i < n; ++i)
+	{
+		memcpy(image_p + h.hash_offset + i * hash_size, &rec_hash[order[i] * hash_size], hash_size);
+		memcpy(image_p + h.salt_offset + i * salt_size, &rec_salt[order[i] * salt_size], salt_size);
+	}
+	memcpy(image_p + h.segment_offset, segment_list.data(), segment_list.size() * sizeof(struct target_segment));
+	memcpy(image_p + h.value_offset, value_list.data(), value_list.size() * sizeof(union extra_data));
+	memcpy(image_p + h.bloom_offset, bloom_list.data(), bloom_list.size() * sizeof(struct target_bloom));
+
+	//! 6. 每个密文在所在组的过滤器中置两位，位置取自hash值的前两个32位字
+	uint64_t *words = (uint64_t *)(image_p + h.bloom_word_offset);
+	for (size_t b = 0; b < bloom_list.size(); ++b)
+	{
+		for (size_t i = bloom_list[b].first; i < bloom_end[b]; ++i)
+		{
+			const unsigned char *p = &rec_hash[order[i] * hash_size];
+			uint32_t w0, w1;
+			memcpy(&w0, p, 4);
+			memcpy(&w1, p + 4, 4);
+			w0 &= bloom_list[b].bit_mask;
+			w1 &= bloom_list[b].bit_mask;
+			words[bloom_list[b].word_off + (w0 >> 6)] |= 1ull << (w0 & 63);
+			words[bloom_list[b].word_off + (w1 >> 6)] |= 1ull << (w1 & 63);
+		}
+	}
+
+	if (invalid > 0)
+		std::cout << "warning: skip " << invalid << " invalid lines in " << cipher_path << std::endl;
+	return attach(image_p);
+}
+
+/**
+ *@brief 把密文库写成二进制索引文件
+ *@param index_path 索引文件路径，先写index_path.tmp再改名，中途失败不会留下不完整的索引
+ *@return 0：正确，-1：出错
+ */
+int TargetStore::save(const char *index_path)
+{
+	if (header == NULL)
+		return -1;
+	std::string tmp_path = std::string(index_path) + ".tmp";
+	int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return -1;
+	const char *p = image;
+	size_t left = header->file_size;
+	while (left > 0)
+	{
+		ssize_t ret = ::write(fd, p, left);
+		if (ret < 0)
+		{
+			::close(fd);
+			unlink(tmp_path.c_str());
+			return -1;
+		}
+		p += ret;
+		left -= ret;
+	}
+	if (::close(fd) != 0 || rename(tmp_path.c_str(), index_path) != 0)
+	{
+		unlink(tmp_path.c_str());
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ *@brief mmap二进制索引文件
+ *@param index_path 索引文件路径
+ *@param alg_name 当前算法名，必须与生成索引的算法相同
+ *@param cipher_path 密文文件路径，文件存在时大小和修改时间必须与生成索引时相同
+ *@return 0：正确，-1：索引文件不存在或不可用
+ */
+int TargetStore::load(const char *index_path, const std::string &alg_name, const char *cipher_path)
+{
+	close();
+	int fd = ::open(index_path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(struct target_index_header))
+	{
+		::close(fd);
+		return -1;
+	}
+	void *addr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (addr == MAP_FAILED)
+		return -1;
+
+	//! 1. 检查魔数、算法名和文件大小
+	const struct target_index_header *h = (const struct target_index_header *)addr;
+	bool valid = memcmp(h->magic, TARGET_INDEX_MAGIC, 8) == 0
+		&& strncmp(h->alg_name, alg_name.c_str(), sizeof(h->alg_name)) == 0
+		&& h->file_size == (uint64_t)st.st_size;
+	//! 2. 密文文件存在时检查它在生成索引之后没有改变
+	struct stat source;
+	if (valid && cipher_path != NULL && stat(cipher_path, &source) == 0)
+		valid = (h->source_size == source.st_size && h->source_mtime == source.st_mtime);
+	if (!valid || attach((char *)addr) != 0)
+	{
+		munmap(addr, st.st_size);
+		return -1;
+	}
+	mapped_size = st.st_size;
+	return 0;
+}
+
+/**
+ *@brief 下标i所在的段，段数很少，二分查找
+ */
+int TargetStore::segment_of(long long i) const
+{
+	int lo = 0, hi = header->segment_num - 1;
+	while (lo < hi)
+	{
+		int mid = (lo + hi + 1) / 2;
+		if ((long long)segments[mid].first <= i)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+	return lo;
+}
+
+/**
+ *@brief 组[first, end)的bloom过滤器，按组的起始下标二分查找
+ */
+const struct target_bloom *TargetStore::bloom_of(long long first, long long end) const
+{
+	if (end - first < TARGET_BLOOM_MIN || header->bloom_num == 0)
+		return NULL;
+	const struct target_bloom *p = std::lower_bound(blooms, blooms + header->bloom_num, first,
+		[](const struct target_bloom &b, long long v) { return (long long)b.first < v; });
+	if (p == blooms + header->bloom_num || (long long)p->first != first)
+		return NULL;
+	return p;
+}
+
+/**
+ *@brief 在组[first, end)中查找hash值，组内hash值有序，较大的组二分查找
+ */
+long long TargetStore::find(long long first, long long end, const unsigned char *h) const
+{
+	int size = header->hash_size;
+	if (end - first < TARGET_BLOOM_MIN)
+	{
+		for (long long i = first; i < end; ++i)
+		{
+			if (memcmp(hash(i), h, size) == 0)
+				return i;
+		}
+		return -1;
+	}
+	long long lo = first, hi = end;
+	while (lo < hi)
+	{
+		long long mid = lo + (hi - lo) / 2;
+		int c = memcmp(hash(mid), h, size);
+		if (c == 0)
+			return mid;
+		if (c < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return -1;
+}
+
+/**
+ *@brief 查找参数、盐、hash值都相同的密文，用于从匹配结果文件恢复已破解的密文
+ * 先按盐长度和参数值找到段，段内按补0到salt_size的盐二分查找组，再在组内查找hash值
+ *@param extra 附加信息，各参数的当前值来自parse_cipher
+ *@param salt 盐
+ *@param salt_len 盐的字节数
+ *@param h hash值
+ *@return 密文下标，没有找到返回-1
+ */
+long long TargetStore::lookup(const struct extra_info *extra, const unsigned char *salt, int salt_len, const unsigned char *h) const
+{
+	if (header == NULL || salt_len > (int)header->salt_size || header->salt_size > CIPHER_MAX_SALT)
+		return -1;
+	unsigned char key[CIPHER_MAX_SALT] = {0};    //加载potfile时每行查找一次，不分配内存
+	memcpy(key, salt, salt_len);
+	for (int s = 0; s < (int)header->segment_num; ++s)
+	{
+		if (segments[s].salt_len != salt_len)
+			continue;
+		const union extra_data *seg_values = segment_values(s);
+		int k = 0;
+		while (k < (int)header->param_num
+			&& memcmp(&extra[header->param_index[k]].cur_value, &seg_values[k], sizeof(union extra_data)) == 0)
+			++k;
+		if (k < (int)header->param_num)
+			continue;
+
+		long long lo = segments[s].first, hi = segment_end(s);
+		while (lo < hi)
+		{
+			long long mid = lo + (hi - lo) / 2;
+			if (memcmp(this->salt(mid), key, header->salt_size) < 0)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		if (lo == segment_end(s) || memcmp(this->salt(lo), key, header->salt_size) != 0)
+			continue;
+		long long t = find(lo, group_end(lo, segment_end(s)), h);
+		if (t >= 0)
+			return t;
+	}
+	return -1;
+}
@@ -0,0 +1,57 @@
+#!/bin/sh
+# 破解模式的回归检查
+# 1. 使用索引文件-I和检查点时中断，--restore时从重新加载的索引标记匹配结果文件中已破解的密文，
+#    恢复后只计算剩余的盐，最终全部破解且每个密文只输出一次
+# 2. 使用potfile时再次运行，potfile中的密文都标记为已破解，不再向potfile追加
+# 用法：sh tests/check_crack.sh [getcipher路径]
+G=${1:-./getcipher}
+D=$(mktemp -d)
+trap 'rm -rf "$D"' EXIT
+
+fail()
+{
+	echo "check_crack: FAIL: $*"
+	exit 1
+}
+
+# 字典4000个口令，每100个取一个作为目标口令，共40个不同的盐
+i=0
+while [ $i -lt 4000 ]; do echo "word$i"; i=$((i + 1)); done > "$D/words"
+awk 'NR % 100 == 0' "$D/words" > "$D/pwds"
+"$G" wordpress "$D/pwds" "$D/targets" iter_pos=B seed=7 > /dev/null || fail "generate targets"
+
+# 1. 第一次运行建立索引，每秒写的检查点中已有破解的密文时用SIGTERM中断，退出前写最后一个检查点
+"$G" crack -t 1 -b 10 -c "$D/ckpt" -C 1 -I "$D/idx" wordpress "$D/targets" "$D/words" "$D/found" > "$D/log1" 2>&1 &
+pid=$!
+n=0
+while [ $n -lt 600 ] && kill -0 $pid 2> /dev/null; do
+	grep -q "^found=[1-9]" "$D/ckpt" 2> /dev/null && break
+	sleep 0.05
+	n=$((n + 1))
+done
+kill -TERM $pid 2> /dev/null || fail "crack finished before it could be interrupted: $(cat "$D/log1")"
+wait $pid
+[ -f "$D/ckpt" ] && [ -f "$D/idx" ] || fail "no checkpoint or index after interrupt"
+found1=$(wc -l < "$D/found")
+[ "$found1" -lt 40 ] || fail "all targets cracked before the interrupt"
+
+# 2. 恢复：从索引加载密文库，匹配结果文件中的密文全部标记为已破解，不再计算它们的盐
+"$G" crack -t 1 -b 10 -c "$D/ckpt" --restore -I "$D/idx" wordpress "$D/targets" "$D/words" "$D/found" > "$D/log2" 2>&1 \
+	|| fail "restore run failed: $(cat "$D/log2")"
+grep -q "load 40 targets from index" "$D/log2" || fail "index not reloaded: $(cat "$D/log2")"
+restored=$(sed -n 's/.*restore \([0-9]*\) cracked targets.*/\1/p' "$D/log2")
+[ -n "$restored" ] && [ "$restored" -ge "$found1" ] && [ "$restored" -gt 0 ] || fail "restored $restored of $found1 found targets"
+grep -q "x $((40 - restored)) salts" "$D/log2" || fail "cracked salts are hashed again: $(cat "$D/log2")"
+grep -q "cracked 40/40" "$D/log2" || fail "not all targets cracked: $(cat "$D/log2")"
+[ "$(cut -d: -f1 "$D/found" | sort -u | wc -l)" -eq 40 ] && [ "$(wc -l < "$D/found")" -eq 40 ] || fail "found_file has duplicate or missing lines"
+
+# 3. 同一个potfile运行两次，第二次全部标记为已破解，potfile的行数不变
+"$G" crack -t 1 -b 10 -I "$D/idx" --pot "$D/pot" wordpress "$D/targets" "$D/words" "$D/found2" > "$D/log3" 2>&1 \
+	|| fail "potfile run failed: $(cat "$D/log3")"
+[ "$(wc -l < "$D/pot")" -eq 40 ] || fail "potfile has $(wc -l < "$D/pot") lines after the first run"
+"$G" crack -t 1 -b 10 -I "$D/idx" --pot "$D/pot" wordpress "$D/targets" "$D/words" "$D/found3" > "$D/log4" 2>&1 \
+	|| fail "potfile rerun failed: $(cat "$D/log4")"
+grep -q "40 targets already cracked" "$D/log4" || fail "potfile not marked: $(cat "$D/log4")"
+[ "$(wc -l < "$D/pot")" -eq 40 ] || fail "potfile has $(wc -l < "$D/pot") lines after the second run"
+
+echo "check_crack: OK"
@@ -0,0 +1,36 @@
+#!/bin/sh
+# 掩码破解的回归检查
+# 1. 掩码?1?d[p-q]枚举2*10*2个候选口令，匹配结果文件必须恰好是掩码空间内目标口令对应的"密文:口令"行
+# 2. 按下标分为3片分别运行，合并后的匹配结果与不分片运行相同
+# 用法：sh tests/check_mask.sh [getcipher路径]
+G=${1:-./getcipher}
+D=$(mktemp -d)
+trap 'rm -rf "$D"' EXIT
+
+fail()
+{
+	echo "check_mask: FAIL: $*"
+	exit 1
+}
+
+# 掩码空间内的口令：第一个和最后一个下标，以及中间的几个
+printf 'a0p\nb9q\na5q\nb0p\n' > "$D/expected"
+# 不在掩码空间内的口令：字符集之外的字符、长度不同
+printf 'c0p\na0r\na00p\nA0p\nb9\n' > "$D/decoys"
+cat "$D/expected" "$D/decoys" > "$D/pwds"
+"$G" wordpress "$D/pwds" "$D/targets" iter_pos=7 seed=13 > /dev/null || fail "generate targets"
+head -n "$(wc -l < "$D/expected")" "$D/targets" | paste -d: - "$D/expected" | sort > "$D/want"
+
+# 1. 不分片运行
+"$G" crack -t 2 -b 4 --mask '?1?d[p-q]' -1 ab wordpress "$D/targets" "$D/found" > "$D/log" 2>&1 \
+	|| fail "mask run failed: $(cat "$D/log")"
+sort "$D/found" | cmp -s - "$D/want" || fail "found_file differs: $(sort "$D/found" | diff - "$D/want")"
+
+# 2. 分3片运行，各片的下标范围不重叠并且覆盖整个口令空间
+for k in 1 2 3; do
+	"$G" crack -t 1 -b 4 --shard $k/3 --mask '?1?d[p-q]' -1 ab wordpress "$D/targets" "$D/found$k" > "$D/log$k" 2>&1 \
+		|| fail "shard $k/3 failed: $(cat "$D/log$k")"
+done
+sort "$D/found1" "$D/found2" "$D/found3" | cmp -s - "$D/want" || fail "merged shard results differ from the unsharded run"
+
+echo "check_mask: OK"
@@ -0,0 +1,58 @@
+#!/bin/sh
+# 规则破解的回归检查
+# 字典中的每个口令按规则文件变形，目标口令取各条规则的预期变形结果，另加几个不应产生的口令，
+# 匹配结果文件必须恰好是预期口令对应的"密文:口令"行
+# 用法：sh tests/check_rules.sh [getcipher路径]
+G=${1:-./getcipher}
+D=$(mktemp -d)
+trap 'rm -rf "$D"' EXIT
+
+fail()
+{
+	echo "check_rules: FAIL: $*"
+	exit 1
+}
+
+printf 'password\nadmin\nletmein123\n' > "$D/words"
+cat > "$D/rules" << 'EOF'
+# 首字母大写其余小写再追加1
+c $1
+sa@
+$[0-2]
+<6
+x13
+i9Q
+EOF
+
+# 预期的候选口令：c $1、sa@(没有a时不变)、$[0-2]展开为$0 $1 $2、<6只保留长度小于6的口令、
+# x13取第1个字符开始的3个字符、i9Q在第9个位置插入Q(超过长度时追加在末尾)
+cat > "$D/expected" << 'EOF'
+Password1
+Admin1
+Letmein1231
+p@ssword
+@dmin
+letmein123
+password0
+password2
+admin1
+letmein1230
+admin
+ass
+dmi
+etm
+passwordQ
+adminQ
+letmein12Q3
+EOF
+# 不应产生的口令：原口令(长度不小于6被<6拒绝)、只大写不追加、$3超出范围、x13取错位置
+printf 'password\nPassword\nadmin3\nadm\n' > "$D/decoys"
+cat "$D/expected" "$D/decoys" > "$D/pwds"
+"$G" wordpress "$D/pwds" "$D/targets" iter_pos=7 seed=11 > /dev/null || fail "generate targets"
+head -n "$(wc -l < "$D/expected")" "$D/targets" | paste -d: - "$D/expected" | sort > "$D/want"
+
+"$G" crack -t 2 -b 4 -r "$D/rules" wordpress "$D/targets" "$D/words" "$D/found" > "$D/log" 2>&1 \
+	|| fail "rules run failed: $(cat "$D/log")"
+sort "$D/found" | cmp -s - "$D/want" || fail "found_file differs: $(sort "$D/found" | diff - "$D/want")"
+
+echo "check_rules: OK"
@@ -0,0 +1,40 @@
+#!/bin/sh
+# 校验模式的回归检查
+# "密文:口令"文件中有匹配、不匹配、格式不对的行，口令可以含':'，空行被忽略，
+# 结果文件按输入顺序每行一个"密文:match|mismatch|invalid"
+# 用法：sh tests/check_verify.sh [getcipher路径]
+G=${1:-./getcipher}
+D=$(mktemp -d)
+trap 'rm -rf "$D"' EXIT
+
+fail()
+{
+	echo "check_verify: FAIL: $*"
+	exit 1
+}
+
+# 第一个密文是phpass的公开测试向量，其余由phpass参考实现计算
+cat > "$D/pairs" << 'EOF'
+$P$9IQRaTwmfeRo7ud9Fh4E2PdI0S3r.L0:test12345
+$P$9IQRaTwmfeRo7ud9Fh4E2PdI0S3r.L0:test1234
+
+$P$7Zy9.xw/AfT7B.e/U3wNJICEIJcijX.:a:b
+$P$!Zy9.xw/AfT7B.e/U3wNJICEIJcijX.:a:b
+$P$8Q1w2E3r41a9i5w5KAF8c88FBm3ZL3.:secret
+not a cipher
+$P$8Q1w2E3r41a9i5w5KAF8c88FBm3ZL3.:Secret
+EOF
+cat > "$D/want" << 'EOF'
+$P$9IQRaTwmfeRo7ud9Fh4E2PdI0S3r.L0:match
+$P$9IQRaTwmfeRo7ud9Fh4E2PdI0S3r.L0:mismatch
+$P$7Zy9.xw/AfT7B.e/U3wNJICEIJcijX.:match
+$P$!Zy9.xw/AfT7B.e/U3wNJICEIJcijX.:invalid
+$P$8Q1w2E3r41a9i5w5KAF8c88FBm3ZL3.:match
+not a cipher:invalid
+$P$8Q1w2E3r41a9i5w5KAF8c88FBm3ZL3.:mismatch
+EOF
+
+"$G" verify -t 2 -b 2 wordpress "$D/pairs" "$D/result" > "$D/log" 2>&1 || fail "verify run failed: $(cat "$D/log")"
+cmp -s "$D/result" "$D/want" || fail "result_file differs: $(diff "$D/result" "$D/want")"
+
+echo "check_verify: OK"
@@ -0,0 +1,158 @@
+/**
+ *@file verify.cpp
+ *@brief 批量校验(口令, 密文)对的实现文件
+ *
+ * 每个密文自带盐和参数(wordpress为迭代次数标识和盐长度)，不能像破解模式那样按盐分组。
+ * 一批记录先逐个解析密文，再按参数排序，参数相同的一段记录共用同一组参数，
+ * 一次交给算法的批量hash接口，由多缓冲内核同步推进迭代次数相同的链，
+ * 最后与密文中的hash值做常数时间比较。流水线把排序后的记录切分为任务，由工作窃取线程池按代价调度
+ *@version 0.1
+ */
+#include "include/verify.h"
+#include <string.h>
+#include <new>
+#include <algorithm>
+
+/**
+ *@brief 常数时间比较，逐字节累积差异，不提前返回
+ *@param a 摘要
+ *@param b 摘要
+ *@param len 字节数
+ *@return 相同返回true
+ */
+bool verify_digest_equal(const unsigned char *a, const unsigned char *b, int len)
+{
+	volatile unsigned char diff = 0;
+	for (int i = 0; i < len; ++i)
+		diff = diff | (a[i] ^ b[i]);
+	return diff == 0;
+}
+
+/**
+ *@brief 切分一行"密文:口令"，密文中不含':'，口令可以含':'
+ *@param line 一行
+ *@param len 行的字节数
+ *@param cipher_len 输出密文的字节数，密文从line开始
+ *@param pwd 输出口令
+ *@param pwd_len 输出口令的字节数
+ *@return 0：正确，-1：没有':'
+ */
+int split_verify_line(const char *line, int len, int &cipher_len, const char *&pwd, int &pwd_len)
+{
+	const char *colon = (const char *)memchr(line, ':', len);
+	if (colon == NULL)
+		return -1;
+	cipher_len = colon - line;
+	pwd = colon + 1;
+	pwd_len = len - cipher_len - 1;
+	return 0;
+}
+
+/**
+ *@brief 解析n个密文，保存盐、hash值和参数，预处理口令，能解析的记录按参数排序
+ *@param desp 已初始化的算法描述，必须提供parse_cipher，只读，解析时使用副本
+ *@param layout 参数布局
+ *@param pwd n个口令
+ *@param pwd_len n个口令的字节数
+ *@param cipher n个密文
+ *@param cipher_len n个密文的字节数
+ *@param n 记录个数
+ *@param result 不能解析的记录设为VERIFY_INVALID
+ *@param order 输出按param_record_less排序的记录，至少n个元素
+ *@param arena 本批的分配器，记录、参数和预处理后的口令都从中分配
+ *@return 能解析的记录个数，prepare_pwd出错返回-1
+ */
+int verify_prepare(struct alg_desp *desp, const struct param_layout *layout, const char *const *pwd, const int *pwd_len,
+	const char *const *cipher, const int *cipher_len, int n, int *result, struct param_record **order, BatchArena &arena)
+{
+	//! 1. 密文自带的参数写入本次调用的算法描述副本，不改写多个线程共享的desp
+	struct alg_desp local = *desp;
+	struct param_record *rec = (struct param_record *)arena.alloc(sizeof(struct param_record) * n);
+	int valid = 0;
+	for (int i = 0; i < n; ++i)
+	{
+		struct param_record *r = &rec[valid];
+		if (local.parse_cipher(cipher[i], cipher_len[i], r->salt, r->salt_len, r->hash, r->hash_len, local.extra) != 0)
+		{
+			result[i] = VERIFY_INVALID;
+			continue;
+		}
+		//! 2. 预处理口令，复制到arena中
+		ByteVector bv_pwd = local.prepare_pwd(pwd[i], pwd_len[i]);
+		if (bv_pwd.isEmpty() && pwd_len[i] > 0)
+			return -1;
+		new (&r->pwd) ByteView(arena.copy(bv_pwd.getByte_p(), bv_pwd.size()));
+		r->index = i;
+		save_param_values(&local, layout, r, arena);
+		order[valid++] = r;
+	}
+	//! 3. 按(盐长度, 参数)排序，wordpress即按迭代次数标识分段
+	param_record_less less = {layout->num};
+	std::stable_sort(order, order + valid, less);
+	return valid;
+}
+
+/**
+ *@brief 校验n条参数相同的记录：整段一次计算hash值，再逐个做常数时间比较
+ *@param local 调用者自己的算法描述副本
+ *@param layout 参数布局
+ *@param order n条参数相同的记录
+ *@param n 记录个数
+ *@param result 输出VERIFY_MATCH或VERIFY_MISMATCH，下标为记录的index
+ *@param arena 分配器，口令和盐的视图、迭代链和hash值都从中分配
+ *@return 0：正确，-1：hash_pwd出错
+ */
+int verify_records(struct alg_desp *local, const struct param_layout *layout, struct param_record *const *order, int n,
+	int *result, BatchArena &arena)
+{
+	ByteView *hash = (ByteView *)arena.alloc(sizeof(ByteView) * n);
+	for (int i = 0; i < n; ++i)
+		new (&hash[i]) ByteView();
+	if (hash_param_records(local, layout, order, n, hash, arena) != 0)
+		return -1;
+	for (int i = 0; i < n; ++i)
+	{
+		const struct param_record *r = order[i];
+		bool equal = hash[i].size() == r->hash_len && verify_digest_equal(hash[i].getByte_p(), r->hash, r->hash_len);
+		result[r->index] = equal ? VERIFY_MATCH : VERIFY_MISMATCH;
+	}
+	return 0;
+}
+
+/**
+ *@brief 校验n对(口令, 密文)
+ *@param desp 已初始化的算法描述，必须提供parse_cipher，多个线程可以同时使用，不被改写
+ *@param pwd n个口令
+ *@param pwd_len n个口令的字节数
+ *@param cipher n个密文
+ *@param cipher_len n个密文的字节数
+ *@param n 记录个数
+ *@param result 输出n个校验结果VERIFY_MATCH、VERIFY_MISMATCH或VERIFY_INVALID
+ *@param arena 本批的分配器，解析结果、预处理后的口令和hash值都从中分配
+ *@return 0：正确，-1：prepare_pwd或hash_pwd出错
+ */
+int verify_batch(struct alg_desp *desp, const char *const *pwd, const int *pwd_len, const char *const *cipher, const int *cipher_len,
+	int n, int *result, BatchArena &arena)
+{
+	if (desp->parse_cipher == NULL)
+		return -1;
+	//! 1. 解析并按参数排序
+	struct param_layout layout;
+	init_param_layout(desp, &layout);
+	struct param_record **order = (struct param_record **)arena.alloc(sizeof(struct param_record *) * n);
+	int valid = verify_prepare(desp, &layout, pwd, pwd_len, cipher, cipher_len, n, result, order, arena);
+	if (valid < 0)
+		return -1;
+
+	//! 2. 参数相同的每一段一起校验
+	struct alg_desp local = *desp;
+	param_record_less less = {layout.num};
+	for (int first = 0, end; first < valid; first = end)
+	{
+		for (end = first + 1; end < valid && !less(order[first], order[end]); ++end)
+			;
+		if (verify_records(&local, &layout, order + first, end - first, result, arena) != 0)
+			return -1;
+	}
+	return 0;
+}
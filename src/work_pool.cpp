@@ -0,0 +1,173 @@
+/**
+ *@file work_pool.cpp
+ *@brief 按代价调度的工作窃取线程池实现文件
+ *@version 0.1
+ */
+#include "include/work_pool.h"
+#include <algorithm>
+
+//! 按代价从大到小排序
+static bool pool_task_more(const struct pool_task &a, const struct pool_task &b)
+{
+	return a.cost > b.cost;
+}
+
+WorkStealingPool::WorkStealingPool(int thread_num)
+	: queued_num(0), closed(false), steal_num(0)
+{
+	for (int i = 0; i < thread_num; ++i)
+	{
+		queues.push_back(new struct task_queue);
+		queues[i]->queued_cost = 0;
+		queues[i]->running_cost = 0;
+	}
+	for (int i = 0; i < thread_num; ++i)
+		threads.push_back(std::thread(&WorkStealingPool::worker_loop, this, i));
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+	close();
+	join();
+	for (size_t i = 0; i < queues.size(); ++i)
+		delete queues[i];
+}
+
+/**
+ *@brief 提交n个任务：按代价从大到小，每个任务放入当时负载(排队代价加正在执行的任务的代价)最小的队列，
+ * 贵任务不会排在另一个正在执行的贵任务之后。
+ * 队列按代价从大到小排列，后提交的贵任务排在先提交的便宜任务之前，代价相同时先提交的在前
+ *@param task 任务数组
+ *@param n 任务个数
+ */
+void WorkStealingPool::submit(const struct pool_task *task, int n)
+{
+	if (n <= 0)
+		return;
+	sorted.assign(task, task + n);
+	std::stable_sort(sorted.begin(), sorted.end(), pool_task_more);
+	for (int i = 0; i < n; ++i)
+	{
+		struct task_queue *target = NULL;
+		long long target_load = 0;
+		for (size_t k = 0; k < queues.size(); ++k)
+		{
+			long long load = queues[k]->queued_cost + queues[k]->running_cost;
+			if (target == NULL || load < target_load)
+			{
+				target = queues[k];
+				target_load = load;
+			}
+		}
+		std::lock_guard<std::mutex> lock(target->lock);
+		target->tasks.insert(std::upper_bound(target->tasks.begin(), target->tasks.end(), sorted[i], pool_task_more), sorted[i]);
+		target->queued_cost += sorted[i].cost;
+	}
+	//! 在idle_mutex中增加计数，等待中的线程不会错过唤醒
+	{
+		std::lock_guard<std::mutex> lock(idle_mutex);
+		queued_num += n;
+	}
+	idle_cond.notify_all();
+}
+
+void WorkStealingPool::close()
+{
+	{
+		std::lock_guard<std::mutex> lock(idle_mutex);
+		closed = true;
+	}
+	idle_cond.notify_all();
+}
+
+void WorkStealingPool::join()
+{
+	for (size_t i = 0; i < threads.size(); ++i)
+	{
+		if (threads[i].joinable())
+			threads[i].join();
+	}
+}
+
+/**
+ *@brief 取一个任务：先取自己队列的队首，没有时从排队代价最大的队列的队首窃取
+ *@param worker 线程序号
+ *@param task 输出取到的任务
+ *@return 取到返回true
+ */
+bool WorkStealingPool::take(int worker, struct pool_task &task)
+{
+	//! 1. 自己的队列
+	struct task_queue *own = queues[worker];
+	{
+		std::lock_guard<std::mutex> lock(own->lock);
+		if (!own->tasks.empty())
+		{
+			task = own->tasks.front();
+			own->tasks.pop_front();
+			own->queued_cost -= task.cost;
+			--queued_num;
+			return true;
+		}
+	}
+	//! 2. 窃取剩余代价最大的队列中最贵的任务，其余线程同时窃取时可能落空，再选下一个
+	for (size_t attempt = 0; attempt < queues.size(); ++attempt)
+	{
+		struct task_queue *victim = NULL;
+		for (size_t k = 0; k < queues.size(); ++k)
+		{
+			if (k != (size_t)worker && queues[k]->queued_cost > 0 && (victim == NULL || queues[k]->queued_cost > victim->queued_cost))
+				victim = queues[k];
+		}
+		if (victim == NULL)
+			break;
+		std::lock_guard<std::mutex> lock(victim->lock);
+		if (!victim->tasks.empty())
+		{
+			task = victim->tasks.front();
+			victim->tasks.pop_front();
+			victim->queued_cost -= task.cost;
+			--queued_num;
+			++steal_num;
+			return true;
+		}
+	}
+	//! 3. 代价为0的任务不计入queued_cost，逐个队列查找
+	for (size_t k = 0; k < queues.size(); ++k)
+	{
+		std::lock_guard<std::mutex> lock(queues[k]->lock);
+		if (!queues[k]->tasks.empty())
+		{
+			task = queues[k]->tasks.front();
+			queues[k]->tasks.pop_front();
+			queues[k]->queued_cost -= task.cost;
+			--queued_num;
+			if (k != (size_t)worker)
+				++steal_num;
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ *@brief 线程主循环：有任务就执行，没有任务时等待提交或关闭
+ */
+void WorkStealingPool::worker_loop(int worker)
+{
+	struct pool_task task;
+	while (true)
+	{
+		if (take(worker, task))
+		{
+			queues[worker]->running_cost = task.cost;
+			task.run(task.arg, worker);
+			queues[worker]->running_cost = 0;
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(idle_mutex);
+		idle_cond.wait(lock, [this] { return closed || queued_num > 0; });
+		if (closed && queued_num <= 0)
+			return;
+	}
+}